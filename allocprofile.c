@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <malloc.h>
+#include "value.h"
+#include "talloc.h"
+#include "profiler.h"
+
+#ifndef _ALLOCPROFILE
+#define _ALLOCPROFILE
+
+// Rows printed for each table
+#define REPORT_ROWS 25
+
+// Bytes and count of allocations under one key
+typedef struct AllocationCount {
+    const void *key;
+    long count;
+    long bytes;
+} AllocationCount;
+
+// An open-addressing table of counts keyed by pointer
+typedef struct CountTable {
+    AllocationCount *slots;
+    size_t capacity;
+    size_t used;
+} CountTable;
+
+// Names of the value types, in valueType order
+static const char *typeNames[] = {
+    "INT", "DOUBLE", "STR", "CONS", "NULL", "PTR",
+    "OPEN", "CLOSE", "BOOL", "SYMBOL", "VOID", "CLOSURE", "PRIMITIVE",
+    "UNSPECIFIED", "VECTOR", "HASHTABLE", "FUTURE",
+    "THREAD", "CHANNEL", "ERROR", "BIGNUM",
+    "F64VECTOR", "S64VECTOR", "STRINGPORT", "PROMISE",
+    "OPENBRACKET", "CLOSEBRACKET", "DOT", "SINGLEQUOTE",
+    "OPENVECTOR"
+};
+#define TYPE_COUNT (int)(sizeof(typeNames) / sizeof(typeNames[0]))
+
+// Rows of the by-type table past the value types
+#define FRAME_ROW TYPE_COUNT
+#define OTHER_ROW (TYPE_COUNT + 1)
+
+// Everything below is shared by all threads and guarded by countsLock
+static pthread_mutex_t countsLock = PTHREAD_MUTEX_INITIALIZER;
+static AllocationCount typeCounts[TYPE_COUNT + 2];
+static CountTable siteCounts;
+static CountTable procedureCounts;
+static long totalCount = 0;
+static long totalBytes = 0;
+static long liveBytes = 0;
+static long peakLiveBytes = 0;
+
+// A Value-sized block is given its type just after talloc returns it, so its
+// type is read on the thread's next allocation or free instead
+_Thread_local void *pendingBlock = NULL;
+_Thread_local size_t pendingSize = 0;
+
+// Returns the count for key in table, adding a zero one if needed
+AllocationCount *countIn(CountTable *table, const void *key){
+    if((table->used + 1) * 2 > table->capacity){
+        AllocationCount *old = table->slots;
+        size_t oldCapacity = table->capacity;
+        table->capacity = oldCapacity == 0 ? 256 : oldCapacity * 2;
+        table->slots = calloc(table->capacity, sizeof(AllocationCount));
+        table->used = 0;
+        for(size_t i = 0; i < oldCapacity; i++){
+            if(old[i].key != NULL){
+                *countIn(table, old[i].key) = old[i];
+            }
+        }
+        free(old);
+    }
+    uintptr_t hash = (uintptr_t)key;
+    hash ^= hash >> 15;
+    hash *= 0x9e3779b97f4a7c15ULL;
+    size_t index = (hash >> 32) & (table->capacity - 1);
+    while(table->slots[index].key != NULL && table->slots[index].key != key){
+        index = (index + 1) & (table->capacity - 1);
+    }
+    if(table->slots[index].key == NULL){
+        table->slots[index].key = key;
+        table->used++;
+    }
+    return &table->slots[index];
+}
+
+// Counts the thread's pending Value-sized block under the type it now has.
+// Must hold countsLock.
+void settlePending(){
+    if(pendingBlock == NULL){
+        return;
+    }
+    int row = ((Value *)pendingBlock)->type;
+    if(row < 0 || row >= TYPE_COUNT){
+        row = OTHER_ROW;
+    }
+    typeCounts[row].count++;
+    typeCounts[row].bytes += pendingSize;
+    pendingBlock = NULL;
+}
+
+// talloc hook recording one allocation
+void recordAllocation(void *block, size_t size, const char *site){
+    Value *procedure = profileCurrentProcedure();
+    size_t usable = malloc_usable_size(block);
+
+    pthread_mutex_lock(&countsLock);
+    settlePending();
+    if(size == sizeof(Value)){
+        pendingBlock = block;
+        pendingSize = size;
+    } else {
+        int row = size == sizeof(Frame) ? FRAME_ROW : OTHER_ROW;
+        typeCounts[row].count++;
+        typeCounts[row].bytes += size;
+    }
+    AllocationCount *count = countIn(&siteCounts, site);
+    count->count++;
+    count->bytes += size;
+    // Top-level allocations are counted under the table itself
+    count = countIn(&procedureCounts, procedure != NULL ? (void *)procedure : (void *)&procedureCounts);
+    count->count++;
+    count->bytes += size;
+    totalCount++;
+    totalBytes += size;
+    liveBytes += usable;
+    if(liveBytes > peakLiveBytes){
+        peakLiveBytes = liveBytes;
+    }
+    pthread_mutex_unlock(&countsLock);
+}
+
+// talloc hook recording one free
+void recordFree(void *block){
+    size_t usable = malloc_usable_size(block);
+    pthread_mutex_lock(&countsLock);
+    settlePending();
+    liveBytes -= usable;
+    pthread_mutex_unlock(&countsLock);
+}
+
+// Start recording every talloc: its size, the C function that called talloc
+// (or cons or makeNull), the Scheme procedure running at the time and, for
+// Value-sized blocks, the type the Value is given. Frees through tfree and
+// trelease are tracked too, for the peak live heap.
+void allocProfileStart(){
+    profileTrackProcedures();
+    tsetHooks(recordAllocation, recordFree);
+}
+
+// Orders counts by bytes, most first
+int compareBytes(const void *a, const void *b){
+    const AllocationCount *x = a;
+    const AllocationCount *y = b;
+    return (x->bytes < y->bytes) - (x->bytes > y->bytes);
+}
+
+// Writes the heading of one table
+void writeHeading(FILE *stream, const char *title){
+    fprintf(stream, "\n%s:\n%12s %7s %12s  %s\n", title, "bytes", "%", "count", "name");
+}
+
+// Writes one row of a table
+void writeRow(FILE *stream, AllocationCount *count){
+    fprintf(stream, "%12ld %6.2f%% %12ld  ", count->bytes,
+        totalBytes > 0 ? 100.0 * count->bytes / totalBytes : 0.0, count->count);
+}
+
+// Copies the used slots of table into a new array sorted by bytes, and
+// stores how many there are in n
+AllocationCount *sortedCounts(CountTable *table, size_t *n){
+    AllocationCount *sorted = malloc(sizeof(AllocationCount) * (table->used + 1));
+    *n = 0;
+    for(size_t i = 0; i < table->capacity; i++){
+        if(table->slots[i].key != NULL){
+            sorted[(*n)++] = table->slots[i];
+        }
+    }
+    qsort(sorted, *n, sizeof(AllocationCount), compareBytes);
+    return sorted;
+}
+
+// Print the totals by value type, by C call site and by Scheme procedure to
+// stream, largest first, with the peak live heap.
+void allocProfileReport(FILE *stream){
+    pthread_mutex_lock(&countsLock);
+    settlePending();
+
+    fprintf(stream, "Allocations: %ld blocks, %ld bytes requested\n", totalCount, totalBytes);
+    fprintf(stream, "Active list: %ld bytes more, one %zu-byte node per block\n",
+        totalCount * (long)sizeof(Value), sizeof(Value));
+    fprintf(stream, "Peak live heap: %ld bytes as allocated by malloc\n", peakLiveBytes);
+
+    AllocationCount rows[TYPE_COUNT + 2];
+    memcpy(rows, typeCounts, sizeof(rows));
+    for(int i = 0; i < TYPE_COUNT + 2; i++){
+        rows[i].key = i < TYPE_COUNT ? typeNames[i] : i == FRAME_ROW ? "Frame" : "other blocks";
+    }
+    qsort(rows, TYPE_COUNT + 2, sizeof(AllocationCount), compareBytes);
+    writeHeading(stream, "By type");
+    for(int i = 0; i < TYPE_COUNT + 2 && rows[i].count > 0; i++){
+        writeRow(stream, &rows[i]);
+        fprintf(stream, "%s\n", (const char *)rows[i].key);
+    }
+
+    size_t n;
+    AllocationCount *sorted = sortedCounts(&siteCounts, &n);
+    writeHeading(stream, "By C function");
+    for(size_t i = 0; i < n && i < REPORT_ROWS; i++){
+        writeRow(stream, &sorted[i]);
+        fprintf(stream, "%s\n", (const char *)sorted[i].key);
+    }
+    free(sorted);
+
+    sorted = sortedCounts(&procedureCounts, &n);
+    writeHeading(stream, "By Scheme procedure");
+    for(size_t i = 0; i < n && i < REPORT_ROWS; i++){
+        writeRow(stream, &sorted[i]);
+        if(sorted[i].key == &procedureCounts){
+            fprintf(stream, "[top level]\n");
+        } else if(profileProcedureName((Value *)sorted[i].key) != NULL){
+            fprintf(stream, "%s\n", profileProcedureName((Value *)sorted[i].key));
+        } else {
+            fprintf(stream, "lambda@%p\n", sorted[i].key);
+        }
+    }
+    free(sorted);
+    pthread_mutex_unlock(&countsLock);
+}
+
+#endif
@@ -0,0 +1,16 @@
+#include <stdio.h>
+
+#ifndef _ALLOCPROFILE
+#define _ALLOCPROFILE
+
+// Start recording every talloc: its size, the C function that called talloc
+// (or cons or makeNull), the Scheme procedure running at the time and, for
+// Value-sized blocks, the type the Value is given. Frees through tfree and
+// trelease are tracked too, for the peak live heap.
+void allocProfileStart();
+
+// Print the totals by value type, by C call site and by Scheme procedure to
+// stream, largest first, with the peak live heap.
+void allocProfileReport(FILE *stream);
+
+#endif
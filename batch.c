@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "value.h"
+#include "context.h"
+
+#ifndef _BATCH
+#define _BATCH
+
+// One script of a batch and what happened when it ran
+typedef struct BatchScript {
+    char *path;
+    char *outputPath;
+    // Whether path was allocated here, for scripts found in a directory
+    bool ownsPath;
+    // Status returned by runInterpreter, or -1 if the files could not be opened
+    int status;
+    double seconds;
+} BatchScript;
+
+// Work shared by the workers of a batch. Workers claim scripts in order by
+// bumping next, so there is no lock.
+typedef struct Batch {
+    BatchScript *scripts;
+    int count;
+    atomic_int next;
+} Batch;
+
+// Returns the current time in seconds, for measuring wall time
+double wallSeconds(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Runs one script in a new interpreter instance on the calling thread
+void runBatchScript(BatchScript *script){
+    double start = wallSeconds();
+    FILE *input = fopen(script->path, "r");
+    FILE *output = fopen(script->outputPath, "w");
+    if(input == NULL || output == NULL){
+        if(input != NULL){
+            fclose(input);
+        }
+        if(output != NULL){
+            fclose(output);
+        }
+        script->status = -1;
+        return;
+    }
+    Interpreter *interpreter = makeInterpreter(input, output);
+    script->status = runInterpreter(interpreter);
+    destroyInterpreter(interpreter);
+    fclose(input);
+    fclose(output);
+    script->seconds = wallSeconds() - start;
+}
+
+// Worker thread: runs scripts until none are left
+void *batchWorker(void *arg){
+    Batch *batch = arg;
+    int index;
+    while((index = atomic_fetch_add(&batch->next, 1)) < batch->count){
+        runBatchScript(&batch->scripts[index]);
+    }
+    return NULL;
+}
+
+// Returns a newly allocated copy of path with its extension replaced by
+// .out, placed in outputDir if it is not NULL
+char *batchOutputPath(char *path, char *outputDir){
+    char *name = path;
+    if(outputDir != NULL && strrchr(path, '/') != NULL){
+        name = strrchr(path, '/') + 1;
+    }
+    char *outputPath = malloc(strlen(name) + (outputDir ? strlen(outputDir) : 0) + 6);
+    if(outputDir != NULL){
+        sprintf(outputPath, "%s/%s", outputDir, name);
+    } else {
+        strcpy(outputPath, name);
+    }
+    char *dot = strrchr(outputPath, '.');
+    char *slash = strrchr(outputPath, '/');
+    if(dot != NULL && (slash == NULL || dot > slash)){
+        *dot = '\0';
+    }
+    strcat(outputPath, ".out");
+    return outputPath;
+}
+
+// Adds a script to the batch, growing the array as needed
+void addBatchScript(Batch *batch, int *capacity, char *path, bool ownsPath, char *outputDir){
+    if(batch->count == *capacity){
+        *capacity = *capacity * 2 + 16;
+        batch->scripts = realloc(batch->scripts, sizeof(BatchScript) * *capacity);
+    }
+    BatchScript *script = &batch->scripts[batch->count++];
+    script->path = path;
+    script->ownsPath = ownsPath;
+    script->outputPath = batchOutputPath(path, outputDir);
+    script->status = 0;
+    script->seconds = 0;
+}
+
+// Orders directory entries by name, so batches run and report in a stable order
+int compareNames(const void *a, const void *b){
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+// Adds every .scm file in a directory to the batch, in name order
+void addBatchDirectory(Batch *batch, int *capacity, char *dirPath, char *outputDir){
+    DIR *dir = opendir(dirPath);
+    if(dir == NULL){
+        return;
+    }
+    char **names = NULL;
+    int count = 0;
+    struct dirent *entry;
+    while((entry = readdir(dir)) != NULL){
+        size_t length = strlen(entry->d_name);
+        if(length > 4 && !strcmp(entry->d_name + length - 4, ".scm")){
+            names = realloc(names, sizeof(char *) * (count + 1));
+            names[count] = malloc(strlen(dirPath) + length + 2);
+            sprintf(names[count], "%s/%s", dirPath, entry->d_name);
+            count++;
+        }
+    }
+    closedir(dir);
+    qsort(names, count, sizeof(char *), compareNames);
+    for(int i = 0; i < count; i++){
+        addBatchScript(batch, capacity, names[i], true, outputDir);
+    }
+    free(names);
+}
+
+// Run every script named in paths on a pool of jobs worker threads, each
+// script in its own interpreter instance. A path naming a directory stands
+// for every .scm file in it. The output of script dir/name.scm is written to
+// outputDir/name.out, or to dir/name.out when outputDir is NULL. A report of
+// each script's status and wall time, followed by the aggregate throughput,
+// is printed to stdout. Returns 0 if every script ran without error.
+int runBatch(char **paths, int count, int jobs, char *outputDir){
+    Batch batch;
+    batch.scripts = NULL;
+    batch.count = 0;
+    atomic_init(&batch.next, 0);
+    int capacity = 0;
+    for(int i = 0; i < count; i++){
+        struct stat info;
+        if(stat(paths[i], &info) == 0 && S_ISDIR(info.st_mode)){
+            addBatchDirectory(&batch, &capacity, paths[i], outputDir);
+        } else {
+            addBatchScript(&batch, &capacity, paths[i], false, outputDir);
+        }
+    }
+    if(jobs < 1){
+        jobs = 1;
+    }
+    if(jobs > batch.count && batch.count > 0){
+        jobs = batch.count;
+    }
+
+    double start = wallSeconds();
+    pthread_t *workers = malloc(sizeof(pthread_t) * jobs);
+    for(int i = 0; i < jobs; i++){
+        pthread_create(&workers[i], NULL, batchWorker, &batch);
+    }
+    for(int i = 0; i < jobs; i++){
+        pthread_join(workers[i], NULL);
+    }
+    double elapsed = wallSeconds() - start;
+    free(workers);
+
+    int failures = 0;
+    for(int i = 0; i < batch.count; i++){
+        BatchScript *script = &batch.scripts[i];
+        if(script->status == -1){
+            printf("%s\tcannot open\n", script->path);
+        } else {
+            printf("%s\tstatus %d\t%.6f s\n", script->path, script->status, script->seconds);
+        }
+        if(script->status != 0){
+            failures++;
+        }
+        free(script->outputPath);
+        if(script->ownsPath){
+            free(script->path);
+        }
+    }
+    printf("%d scripts, %d failed, %d jobs, %.6f s, %.1f scripts/s\n", batch.count, failures,
+        jobs, elapsed, elapsed > 0 ? batch.count / elapsed : 0.0);
+    free(batch.scripts);
+    return failures != 0;
+}
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef _BATCH
+#define _BATCH
+
+// Run every script named in paths on a pool of jobs worker threads, each
+// script in its own interpreter instance. A path naming a directory stands
+// for every .scm file in it. The output of script dir/name.scm is written to
+// outputDir/name.out, or to dir/name.out when outputDir is NULL. A report of
+// each script's status and wall time, followed by the aggregate throughput,
+// is printed to stdout. Returns 0 if every script ran without error.
+int runBatch(char **paths, int count, int jobs, char *outputDir);
+
+#endif
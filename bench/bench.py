@@ -0,0 +1,169 @@
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+
+# Results that count as a regression when they grow by more than this
+# fraction over the baseline
+REGRESSION_THRESHOLD = 0.10
+
+
+def write_many_defines(path, count=3000):
+    '''Writes a workload of count top-level defines followed by a few calls,
+    standing in for a large helper library loaded before the real work.'''
+    with open(path, 'w') as script:
+        for i in range(count):
+            script.write('(define helper-%d (lambda (x) (if (= x 0) %d '
+                         '(+ x (helper-%d (- x 1))))))\n' % (i, i, i))
+        script.write('(helper-0 10)\n(helper-%d 10)\n' % (count - 1))
+
+
+def workloads(build_dir):
+    '''Returns (name, path) for every workload, generating the ones that
+    are not kept as files.'''
+    found = []
+    for entry in sorted(os.listdir(BENCH_DIR)):
+        if entry.endswith('.scm'):
+            found.append((entry[:-4], os.path.join(BENCH_DIR, entry)))
+    many_defines = os.path.join(build_dir, 'many-defines.scm')
+    write_many_defines(many_defines)
+    found.append(('many-defines', many_defines))
+    return found
+
+
+def timed_run(command, script_path):
+    '''Runs command with the script on stdin. Returns the wall time in
+    seconds and the peak resident set size in kilobytes.'''
+    with open(script_path) as script:
+        start = time.perf_counter()
+        process = subprocess.Popen(command, stdin=script,
+                                   stdout=subprocess.DEVNULL,
+                                   stderr=subprocess.DEVNULL)
+        _, status, usage = os.wait4(process.pid, 0)
+        elapsed = time.perf_counter() - start
+    process.returncode = os.waitstatus_to_exitcode(status)
+    if process.returncode != 0:
+        raise RuntimeError('%s exited with status %d'
+                           % (script_path, process.returncode))
+    return elapsed, usage.ru_maxrss
+
+
+def count_instructions(command, script_path):
+    '''Returns the user-space instructions retired by one run, or None if
+    perf is missing or the counter is not available.'''
+    if shutil.which('perf') is None:
+        return None
+    with open(script_path) as script:
+        result = subprocess.run(
+            ['perf', 'stat', '-x,', '-e', 'instructions:u', '--'] + command,
+            stdin=script, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    for line in result.stderr.decode('utf-8', 'replace').splitlines():
+        fields = line.split(',')
+        if len(fields) > 2 and fields[2].startswith('instructions'):
+            try:
+                return int(fields[0])
+            except ValueError:
+                return None
+    return None
+
+
+def count_allocations(interpreter, script_path):
+    '''Returns the number of talloc calls made by one run, from the
+    allocation profiler's report.'''
+    with open(script_path) as script:
+        result = subprocess.run([interpreter, '--alloc-profile'],
+                                stdin=script, stdout=subprocess.DEVNULL,
+                                stderr=subprocess.PIPE)
+    for line in result.stderr.decode('utf-8', 'replace').splitlines():
+        if line.startswith('Allocations:'):
+            return int(line.split()[1])
+    return None
+
+
+def run_benchmark(interpreter, name, path, repeat):
+    '''Measures one workload: the best wall time of repeat runs, the largest
+    peak RSS, and one run each for instructions and allocations.'''
+    command = [interpreter]
+    times = []
+    peak_rss = 0
+    for _ in range(repeat):
+        elapsed, rss = timed_run(command, path)
+        times.append(elapsed)
+        peak_rss = max(peak_rss, rss)
+    return {
+        'name': name,
+        'wall_seconds': round(min(times), 6),
+        'instructions': count_instructions(command, path),
+        'allocations': count_allocations(interpreter, path),
+        'peak_rss_kb': peak_rss,
+    }
+
+
+def compare(result, baseline):
+    '''Adds the ratio to the baseline of each measurement to result, and
+    whether any of them regressed.'''
+    old = baseline.get(result['name'])
+    if old is None:
+        return
+    regressed = False
+    for key in ['wall_seconds', 'instructions', 'allocations', 'peak_rss_kb']:
+        if result.get(key) is None or not old.get(key):
+            continue
+        ratio = result[key] / old[key]
+        result[key + '_ratio'] = round(ratio, 4)
+        if ratio > 1 + REGRESSION_THRESHOLD:
+            regressed = True
+    result['regressed'] = regressed
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Run the benchmark workloads and report one JSON object '
+                    'per benchmark on stdout.')
+    parser.add_argument('--interpreter', required=True)
+    parser.add_argument('--repeat', type=int, default=3)
+    parser.add_argument('--baseline',
+                        help='JSON results to compare against, if present')
+    parser.add_argument('--output', help='where to save all results as JSON')
+    parser.add_argument('names', nargs='*',
+                        help='run only these benchmarks')
+    args = parser.parse_args()
+
+    interpreter = os.path.abspath(args.interpreter)
+    build_dir = os.path.dirname(interpreter)
+    baseline = {}
+    if args.baseline and os.path.exists(args.baseline):
+        with open(args.baseline) as baseline_file:
+            for result in json.load(baseline_file):
+                baseline[result['name']] = result
+
+    results = []
+    for name, path in workloads(build_dir):
+        if args.names and name not in args.names:
+            continue
+        result = run_benchmark(interpreter, name, path, args.repeat)
+        compare(result, baseline)
+        results.append(result)
+        print(json.dumps(result), flush=True)
+
+    if args.output:
+        with open(args.output, 'w') as output:
+            json.dump(results, output, indent=2)
+            output.write('\n')
+
+    regressions = [r['name'] for r in results if r.get('regressed')]
+    if regressions:
+        print('Regressed by more than %d%%: %s'
+              % (REGRESSION_THRESHOLD * 100, ', '.join(regressions)),
+              file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
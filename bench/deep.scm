@@ -0,0 +1,14 @@
+; Non-tail recursion thousands of frames deep, repeated
+(define sum-to
+  (lambda (n)
+    (if (= n 0)
+        0
+        (+ n (sum-to (- n 1))))))
+
+(define repeat
+  (lambda (times total)
+    (if (= times 0)
+        total
+        (repeat (- times 1) (+ total (sum-to 5000))))))
+
+(repeat 20 0)
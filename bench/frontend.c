@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "value.h"
+#include "talloc.h"
+#include "linkedlist.h"
+#include "tokenizer.h"
+#include "parser.h"
+
+// Front-end throughput benchmark: generates synthetic sources in memory and
+// runs the real tokenizer and parser on them through fmemopen, timing each
+// stage on its own. Prints one JSON object per input on stdout.
+
+// A growable buffer of generated source text
+typedef struct Source {
+    char *text;
+    size_t length;
+    size_t capacity;
+} Source;
+
+// Appends a null-terminated string to the source
+void append(Source *source, const char *text) {
+    size_t length = strlen(text);
+    if (source->length + length + 1 > source->capacity) {
+        while (source->length + length + 1 > source->capacity) {
+            source->capacity *= 2;
+        }
+        source->text = realloc(source->text, source->capacity);
+    }
+    memcpy(source->text + source->length, text, length + 1);
+    source->length += length;
+}
+
+// Returns an empty source
+Source newSource() {
+    Source source;
+    source.capacity = 1 << 16;
+    source.text = malloc(source.capacity);
+    source.text[0] = '\0';
+    source.length = 0;
+    return source;
+}
+
+// One very long list of integers
+Source flatList(int count) {
+    Source source = newSource();
+    char number[32];
+    append(&source, "(quote (");
+    for (int i = 0; i < count; i++) {
+        snprintf(number, sizeof(number), "%d ", i);
+        append(&source, number);
+    }
+    append(&source, "))\n");
+    return source;
+}
+
+// Forms nested depth levels deep, repeated
+Source deeplyNested(int depth, int repeat) {
+    Source source = newSource();
+    for (int r = 0; r < repeat; r++) {
+        for (int i = 0; i < depth; i++) {
+            append(&source, "(f ");
+        }
+        append(&source, "x");
+        for (int i = 0; i < depth; i++) {
+            append(&source, ")");
+        }
+        append(&source, "\n");
+    }
+    return source;
+}
+
+// Many small top-level forms
+Source smallForms(int count) {
+    Source source = newSource();
+    char form[96];
+    for (int i = 0; i < count; i++) {
+        snprintf(form, sizeof(form), "(define name-%d (+ %d (car lst)))\n", i, i);
+        append(&source, form);
+    }
+    return source;
+}
+
+// Many string literals near the tokenizer's 300 character limit
+Source longStrings(int count) {
+    Source source = newSource();
+    char text[300];
+    memset(text, 'x', 250);
+    text[250] = '\0';
+    for (int i = 0; i < count; i++) {
+        append(&source, "(quote \"");
+        append(&source, text);
+        append(&source, "\")\n");
+    }
+    return source;
+}
+
+// Lists of integers and decimals
+Source numericData(int rows) {
+    Source source = newSource();
+    char row[256];
+    for (int i = 0; i < rows; i++) {
+        snprintf(row, sizeof(row), "(quote (%d -%d %d.25 -%d.5 %d.125 %d 0.0078125 %d))\n",
+            i, i * 7, i, i * 3, i * 11, i * 13, i * 17);
+        append(&source, row);
+    }
+    return source;
+}
+
+// Returns the current time in seconds
+double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Returns the bytes talloc has handed out on this thread so far
+long allocatedBytes() {
+    long count;
+    long bytes;
+    tstats(&count, &bytes);
+    return bytes;
+}
+
+// Tokenizes and parses the source repeat times, keeping the fastest time of
+// each stage, and prints the results as one JSON object
+void measure(const char *name, Source source, int repeat) {
+    double bestTokenize = 0;
+    double bestParse = 0;
+    long tokens = 0;
+    long tokenizeBytes = 0;
+    long parseBytes = 0;
+
+    for (int r = 0; r < repeat; r++) {
+        void *mark = tmark();
+        FILE *input = fmemopen(source.text, source.length, "r");
+
+        long startBytes = allocatedBytes();
+        double start = now();
+        Value *tokenList = tokenizeStream(input);
+        double tokenized = now();
+        long tokenizedBytes = allocatedBytes();
+        parse(tokenList);
+        double parsed = now();
+        long parsedBytes = allocatedBytes();
+        fclose(input);
+
+        if (r == 0 || tokenized - start < bestTokenize) {
+            bestTokenize = tokenized - start;
+        }
+        if (r == 0 || parsed - tokenized < bestParse) {
+            bestParse = parsed - tokenized;
+        }
+        tokens = length(tokenList);
+        tokenizeBytes = tokenizedBytes - startBytes;
+        parseBytes = parsedBytes - tokenizedBytes;
+        trelease(mark);
+    }
+
+    double megabytes = source.length / 1e6;
+    printf("{\"name\": \"%s\", \"input_bytes\": %zu, \"tokens\": %ld, "
+        "\"tokenize_seconds\": %.6f, \"tokenize_mb_per_s\": %.3f, "
+        "\"tokenize_tokens_per_s\": %.0f, \"tokenize_bytes_per_token\": %.2f, "
+        "\"parse_seconds\": %.6f, \"parse_mb_per_s\": %.3f, "
+        "\"parse_tokens_per_s\": %.0f, \"parse_bytes_per_token\": %.2f}\n",
+        name, source.length, tokens,
+        bestTokenize, megabytes / bestTokenize, tokens / bestTokenize,
+        (double)tokenizeBytes / tokens,
+        bestParse, megabytes / bestParse, tokens / bestParse,
+        (double)parseBytes / tokens);
+    fflush(stdout);
+    free(source.text);
+}
+
+// Usage: frontend [repeat]
+int main(int argc, char *argv[]) {
+    int repeat = argc > 1 ? atoi(argv[1]) : 3;
+    if (repeat < 1) {
+        repeat = 1;
+    }
+    measure("flat-list", flatList(200000), repeat);
+    measure("deeply-nested", deeplyNested(2000, 20), repeat);
+    measure("small-forms", smallForms(50000), repeat);
+    measure("long-strings", longStrings(5000), repeat);
+    measure("numeric-data", numericData(30000), repeat);
+    tfree();
+    return 0;
+}
@@ -0,0 +1,27 @@
+; Counts the solutions to the 8 queens problem by backtracking over lists
+(define safe?
+  (lambda (row distance placed)
+    (if (null? placed)
+        #t
+        (let ((other (car placed)))
+          (if (= other row)
+              #f
+              (if (= (- other row) distance)
+                  #f
+                  (if (= (- row other) distance)
+                      #f
+                      (safe? row (+ distance 1) (cdr placed)))))))))
+
+(define place
+  (lambda (size column placed)
+    (if (= column size)
+        1
+        (let loop ((row 0) (count 0))
+          (if (= row size)
+              count
+              (loop (+ row 1)
+                    (if (safe? row 1 placed)
+                        (+ count (place size (+ column 1) (cons row placed)))
+                        count)))))))
+
+(place 8 0 (quote ()))
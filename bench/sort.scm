@@ -0,0 +1,39 @@
+; Merge sort of a pseudo-random list of integers
+(define random-list
+  (lambda (n seed acc)
+    (if (= n 0)
+        acc
+        (let ((next (modulo (+ (* seed 75) 74) 65537)))
+          (random-list (- n 1) next (cons next acc))))))
+
+; Every other element, starting with the first or the second
+(define evens
+  (lambda (lst)
+    (if (null? lst)
+        lst
+        (cons (car lst) (odds (cdr lst))))))
+
+(define odds
+  (lambda (lst)
+    (if (null? lst)
+        lst
+        (evens (cdr lst)))))
+
+(define merge
+  (lambda (a b)
+    (cond ((null? a) b)
+          ((null? b) a)
+          ((< (car b) (car a)) (cons (car b) (merge a (cdr b))))
+          (else (cons (car a) (merge (cdr a) b))))))
+
+(define sort
+  (lambda (lst)
+    (if (null? lst)
+        lst
+        (if (null? (cdr lst))
+            lst
+            (merge (sort (evens lst)) (sort (odds lst)))))))
+
+(define sorted (sort (random-list 2000 42 (quote ()))))
+(length sorted)
+(car sorted)
@@ -0,0 +1,40 @@
+; Builds lines of text through string ports and takes them apart again.
+; Every loop recurses, so the work is split into short lines to keep the
+; recursion shallow.
+(define all (open-output-string))
+
+; Writes the numbers from i up to n, each followed by a comma
+(define write-numbers
+  (lambda (port i n)
+    (if (< i n)
+        (begin
+          (write-string (number->string i) port)
+          (write-string "," port)
+          (write-numbers port (+ i 1) n))
+        port)))
+
+; Sums the numbers in text, reading each one up to the next comma
+(define sum-numbers
+  (lambda (text start i sum)
+    (cond ((= i (string-length text)) sum)
+          ((string=? (string-ref text i) ",")
+           (sum-numbers text (+ i 1) (+ i 1)
+                        (+ sum (string->number (substring text start i)))))
+          (else (sum-numbers text start (+ i 1) sum)))))
+
+; Builds line after line of 100 numbers, adding up their numbers, counting
+; the lines that sort after the one before, and copying each into all
+(define run-lines
+  (lambda (line lines previous sum ordered)
+    (if (= line lines)
+        (cons sum (cons ordered (quote ())))
+        (let ((text (get-output-string
+                     (write-numbers (open-output-string) (* line 100) (* (+ line 1) 100)))))
+          (write-string text all)
+          (run-lines (+ line 1) lines text
+                     (+ sum (sum-numbers text 0 0 0))
+                     (if (string<? previous text) (+ ordered 1) ordered))))))
+
+(run-lines 0 100 "" 0 0)
+(string-length (get-output-string all))
+(string-length (string-append (get-output-string all) (get-output-string all)))
@@ -0,0 +1,476 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "value.h"
+#include "talloc.h"
+#include "output.h"
+#include "error.h"
+
+#ifndef _BIGNUM
+#define _BIGNUM
+
+// Operands at least this many digits long on both sides are multiplied with
+// Karatsuba's method; below it schoolbook multiplication is faster
+#define KARATSUBA_THRESHOLD 32
+
+// Largest power of ten that fits in a digit, for converting to and from
+// decimal nine decimal digits at a time
+#define DECIMAL_BASE 1000000000u
+
+// An integer operand seen as a sign and magnitude, whether it is a fixnum or
+// a bignum. Magnitudes are arrays of base 2^32 digits, least significant
+// first, as in struct Bignum.
+typedef struct Operand {
+    bool negative;
+    int size;
+    const uint32_t *digits;
+    // Digits of a fixnum operand
+    uint32_t small[2];
+} Operand;
+
+// Fills in operand for an INT_TYPE or BIGNUM_TYPE Value
+void readOperand(Value *value, Operand *operand){
+    if(value->type == BIGNUM_TYPE){
+        operand->negative = value->b->negative;
+        operand->size = value->b->size;
+        operand->digits = value->b->digits;
+        return;
+    }
+    uint64_t magnitude = value->i < 0 ? 0u - (uint64_t)value->i : (uint64_t)value->i;
+    operand->negative = value->i < 0;
+    operand->small[0] = (uint32_t)magnitude;
+    operand->small[1] = (uint32_t)(magnitude >> 32);
+    operand->size = operand->small[1] != 0 ? 2 : operand->small[0] != 0 ? 1 : 0;
+    operand->digits = operand->small;
+}
+
+// Returns the size of a magnitude without its leading zero digits
+int trimMagnitude(const uint32_t *digits, int size){
+    while(size > 0 && digits[size - 1] == 0){
+        size--;
+    }
+    return size;
+}
+
+// Returns the integer with the given sign and magnitude as a fixnum if it
+// fits and as a newly allocated bignum otherwise
+Value *makeInteger(bool negative, const uint32_t *digits, int size){
+    size = trimMagnitude(digits, size);
+    Value *result = talloc(sizeof(Value));
+    if(size <= 2){
+        uint64_t magnitude = size == 0 ? 0 : digits[0];
+        if(size == 2){
+            magnitude |= (uint64_t)digits[1] << 32;
+        }
+        if(magnitude <= (uint64_t)INT64_MAX){
+            result->type = INT_TYPE;
+            result->i = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+            return result;
+        }
+        if(negative && magnitude == (uint64_t)INT64_MAX + 1){
+            result->type = INT_TYPE;
+            result->i = INT64_MIN;
+            return result;
+        }
+    }
+    Bignum *bignum = talloc(sizeof(Bignum) + sizeof(uint32_t) * size);
+    bignum->negative = negative;
+    bignum->size = size;
+    memcpy(bignum->digits, digits, sizeof(uint32_t) * size);
+    result->type = BIGNUM_TYPE;
+    result->b = bignum;
+    return result;
+}
+
+// Compares two magnitudes, returning -1, 0 or 1
+int compareMagnitudes(const uint32_t *a, int aSize, const uint32_t *b, int bSize){
+    if(aSize != bSize){
+        return aSize < bSize ? -1 : 1;
+    }
+    for(int i = aSize - 1; i >= 0; i--){
+        if(a[i] != b[i]){
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// Adds the magnitude a into out, which has outSize digits and must be large
+// enough to hold the sum
+void addIntoMagnitude(uint32_t *out, int outSize, const uint32_t *a, int aSize){
+    uint64_t carry = 0;
+    int i = 0;
+    for(; i < aSize; i++){
+        uint64_t sum = (uint64_t)out[i] + a[i] + carry;
+        out[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+    for(; carry != 0 && i < outSize; i++){
+        uint64_t sum = (uint64_t)out[i] + carry;
+        out[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+}
+
+// Subtracts the magnitude a from out, which has outSize digits and must be
+// at least as large as a
+void subtractFromMagnitude(uint32_t *out, int outSize, const uint32_t *a, int aSize){
+    int64_t borrow = 0;
+    int i = 0;
+    for(; i < aSize; i++){
+        int64_t difference = (int64_t)out[i] - a[i] - borrow;
+        out[i] = (uint32_t)difference;
+        borrow = difference < 0;
+    }
+    for(; borrow != 0 && i < outSize; i++){
+        int64_t difference = (int64_t)out[i] - borrow;
+        out[i] = (uint32_t)difference;
+        borrow = difference < 0;
+    }
+}
+
+// Multiplies magnitudes a and b into out, which has aSize + bSize digits
+void multiplySchoolbook(const uint32_t *a, int aSize, const uint32_t *b, int bSize, uint32_t *out){
+    memset(out, 0, sizeof(uint32_t) * (aSize + bSize));
+    for(int i = 0; i < bSize; i++){
+        uint64_t carry = 0;
+        for(int j = 0; j < aSize; j++){
+            uint64_t product = (uint64_t)a[j] * b[i] + out[i + j] + carry;
+            out[i + j] = (uint32_t)product;
+            carry = product >> 32;
+        }
+        out[i + aSize] = (uint32_t)carry;
+    }
+}
+
+// Multiplies magnitudes a and b into out, which has aSize + bSize digits.
+// Splitting each operand in halves at m digits, a = a1 B^m + a0 and
+// b = b1 B^m + b0, Karatsuba's method gets the product from three half-size
+// products, a0 b0, a1 b1 and (a0 + a1)(b0 + b1), instead of four.
+void multiplyMagnitudes(const uint32_t *a, int aSize, const uint32_t *b, int bSize, uint32_t *out){
+    if(aSize < bSize){
+        const uint32_t *digits = a;
+        a = b;
+        b = digits;
+        int size = aSize;
+        aSize = bSize;
+        bSize = size;
+    }
+    if(bSize < KARATSUBA_THRESHOLD){
+        multiplySchoolbook(a, aSize, b, bSize, out);
+        return;
+    }
+    int m = (aSize + 1) / 2;
+    int size = aSize + bSize;
+    if(bSize <= m){
+        // b is much shorter: a0 b + a1 b B^m, each part recursing on its own
+        uint32_t *part = malloc(sizeof(uint32_t) * (aSize - m + bSize));
+        multiplyMagnitudes(a, m, b, bSize, out);
+        memset(out + m + bSize, 0, sizeof(uint32_t) * (size - m - bSize));
+        multiplyMagnitudes(a + m, aSize - m, b, bSize, part);
+        addIntoMagnitude(out + m, size - m, part, aSize - m + bSize);
+        free(part);
+        return;
+    }
+
+    int a1Size = aSize - m;
+    int b1Size = bSize - m;
+    // a0 + a1 and b0 + b1 each fit in m + 1 digits
+    uint32_t *aSum = calloc(m + 1, sizeof(uint32_t));
+    uint32_t *bSum = calloc(m + 1, sizeof(uint32_t));
+    memcpy(aSum, a, sizeof(uint32_t) * m);
+    addIntoMagnitude(aSum, m + 1, a + m, a1Size);
+    memcpy(bSum, b, sizeof(uint32_t) * m);
+    addIntoMagnitude(bSum, m + 1, b + m, b1Size);
+    uint32_t *middle = malloc(sizeof(uint32_t) * (2 * m + 2));
+    multiplyMagnitudes(aSum, m + 1, bSum, m + 1, middle);
+
+    // a0 b0 goes in the low 2m digits of out and a1 b1 in the rest
+    multiplyMagnitudes(a, m, b, m, out);
+    multiplyMagnitudes(a + m, a1Size, b + m, b1Size, out + 2 * m);
+    subtractFromMagnitude(middle, 2 * m + 2, out, 2 * m);
+    subtractFromMagnitude(middle, 2 * m + 2, out + 2 * m, a1Size + b1Size);
+    addIntoMagnitude(out + m, size - m, middle, trimMagnitude(middle, 2 * m + 2));
+
+    free(aSum);
+    free(bSum);
+    free(middle);
+}
+
+// Divides a magnitude in place by a single digit, returning the remainder
+uint32_t divideMagnitudeByDigit(uint32_t *digits, int size, uint32_t divisor){
+    uint64_t remainder = 0;
+    for(int i = size - 1; i >= 0; i--){
+        uint64_t current = (remainder << 32) | digits[i];
+        digits[i] = (uint32_t)(current / divisor);
+        remainder = current % divisor;
+    }
+    return (uint32_t)remainder;
+}
+
+// Divides magnitude u by magnitude v, which has at least two digits and no
+// leading zero, with Knuth's algorithm D. Stores uSize - vSize + 1 quotient
+// digits in quotient and vSize remainder digits in remainder.
+void divideMagnitudes(const uint32_t *u, int uSize, const uint32_t *v, int vSize,
+    uint32_t *quotient, uint32_t *remainder){
+    // Shift both so the divisor's top digit has its high bit set, which
+    // keeps each estimated quotient digit at most two too large
+    int shift = __builtin_clz(v[vSize - 1]);
+    uint32_t *vn = malloc(sizeof(uint32_t) * vSize);
+    uint32_t *un = malloc(sizeof(uint32_t) * (uSize + 1));
+    for(int i = vSize - 1; i > 0; i--){
+        vn[i] = (uint32_t)((((uint64_t)v[i] << 32) | v[i - 1]) >> (32 - shift));
+    }
+    vn[0] = v[0] << shift;
+    un[uSize] = (uint32_t)((uint64_t)u[uSize - 1] >> (32 - shift));
+    for(int i = uSize - 1; i > 0; i--){
+        un[i] = (uint32_t)((((uint64_t)u[i] << 32) | u[i - 1]) >> (32 - shift));
+    }
+    un[0] = u[0] << shift;
+
+    const uint64_t base = (uint64_t)1 << 32;
+    for(int j = uSize - vSize; j >= 0; j--){
+        uint64_t top = ((uint64_t)un[j + vSize] << 32) | un[j + vSize - 1];
+        uint64_t estimate = top / vn[vSize - 1];
+        uint64_t rest = top % vn[vSize - 1];
+        while(estimate >= base ||
+            estimate * vn[vSize - 2] > ((rest << 32) | un[j + vSize - 2])){
+            estimate--;
+            rest += vn[vSize - 1];
+            if(rest >= base){
+                break;
+            }
+        }
+
+        // Subtract estimate times the divisor from the current window
+        int64_t borrow = 0;
+        int64_t difference;
+        for(int i = 0; i < vSize; i++){
+            uint64_t product = estimate * vn[i];
+            difference = (int64_t)un[i + j] - borrow - (int64_t)(product & 0xffffffffu);
+            un[i + j] = (uint32_t)difference;
+            borrow = (int64_t)(product >> 32) - (difference >> 32);
+        }
+        difference = (int64_t)un[j + vSize] - borrow;
+        un[j + vSize] = (uint32_t)difference;
+
+        quotient[j] = (uint32_t)estimate;
+        if(difference < 0){
+            // The estimate was one too large: add the divisor back
+            quotient[j]--;
+            uint64_t carry = 0;
+            for(int i = 0; i < vSize; i++){
+                uint64_t sum = (uint64_t)un[i + j] + vn[i] + carry;
+                un[i + j] = (uint32_t)sum;
+                carry = sum >> 32;
+            }
+            un[j + vSize] += (uint32_t)carry;
+        }
+    }
+
+    for(int i = 0; i < vSize; i++){
+        remainder[i] = (uint32_t)((un[i] >> shift) | ((uint64_t)un[i + 1] << (32 - shift)));
+    }
+    free(vn);
+    free(un);
+}
+
+// Returns the sum of two operands, with b's sign flipped if negateB
+Value *addOperands(Operand *a, Operand *b, bool negateB){
+    bool bNegative = b->negative != negateB;
+    int size = (a->size > b->size ? a->size : b->size) + 1;
+    uint32_t *digits = calloc(size, sizeof(uint32_t));
+    bool negative;
+    if(a->negative == bNegative){
+        memcpy(digits, a->digits, sizeof(uint32_t) * a->size);
+        addIntoMagnitude(digits, size, b->digits, b->size);
+        negative = a->negative;
+    } else if(compareMagnitudes(a->digits, a->size, b->digits, b->size) >= 0){
+        memcpy(digits, a->digits, sizeof(uint32_t) * a->size);
+        subtractFromMagnitude(digits, size, b->digits, b->size);
+        negative = a->negative;
+    } else {
+        memcpy(digits, b->digits, sizeof(uint32_t) * b->size);
+        subtractFromMagnitude(digits, size, a->digits, a->size);
+        negative = bNegative;
+    }
+    Value *result = makeInteger(negative, digits, size);
+    free(digits);
+    return result;
+}
+
+// Return a + b.
+Value *integerAdd(Value *a, Value *b){
+    Operand x, y;
+    readOperand(a, &x);
+    readOperand(b, &y);
+    return addOperands(&x, &y, false);
+}
+
+// Return a - b.
+Value *integerSubtract(Value *a, Value *b){
+    Operand x, y;
+    readOperand(a, &x);
+    readOperand(b, &y);
+    return addOperands(&x, &y, true);
+}
+
+// Return a * b. Large operands are multiplied with Karatsuba's method.
+Value *integerMultiply(Value *a, Value *b){
+    Operand x, y;
+    readOperand(a, &x);
+    readOperand(b, &y);
+    if(x.size == 0 || y.size == 0){
+        return makeInteger(false, NULL, 0);
+    }
+    int size = x.size + y.size;
+    uint32_t *digits = malloc(sizeof(uint32_t) * size);
+    multiplyMagnitudes(x.digits, x.size, y.digits, y.size, digits);
+    Value *result = makeInteger(x.negative != y.negative, digits, size);
+    free(digits);
+    return result;
+}
+
+// Divide a by b, truncating toward zero, storing the quotient in *quotient
+// and the remainder, which has the sign of a, in *remainder. Either may be
+// NULL if it is not needed. Raises an evaluation error if b is zero.
+void integerDivide(Value *a, Value *b, Value **quotient, Value **remainder){
+    Operand x, y;
+    readOperand(a, &x);
+    readOperand(b, &y);
+    if(y.size == 0){
+        evaluationError("division by zero");
+    }
+    int quotientSize = x.size >= y.size ? x.size - y.size + 1 : 0;
+    uint32_t *quotientDigits = calloc(quotientSize + 1, sizeof(uint32_t));
+    uint32_t *remainderDigits = calloc(y.size, sizeof(uint32_t));
+    int remainderSize = y.size;
+    if(quotientSize == 0){
+        // |a| < |b|: the quotient is zero and the remainder is a
+        free(remainderDigits);
+        remainderDigits = calloc(x.size + 1, sizeof(uint32_t));
+        memcpy(remainderDigits, x.digits, sizeof(uint32_t) * x.size);
+        remainderSize = x.size;
+    } else if(y.size == 1){
+        memcpy(quotientDigits, x.digits, sizeof(uint32_t) * x.size);
+        remainderDigits[0] = divideMagnitudeByDigit(quotientDigits, x.size, y.digits[0]);
+    } else {
+        divideMagnitudes(x.digits, x.size, y.digits, y.size, quotientDigits, remainderDigits);
+    }
+    if(quotient != NULL){
+        *quotient = makeInteger(x.negative != y.negative, quotientDigits, quotientSize);
+    }
+    if(remainder != NULL){
+        *remainder = makeInteger(x.negative, remainderDigits, remainderSize);
+    }
+    free(quotientDigits);
+    free(remainderDigits);
+}
+
+// Return a negative number, zero or a positive number as a is less than,
+// equal to or greater than b.
+int integerCompare(Value *a, Value *b){
+    if(a->type == INT_TYPE && b->type == INT_TYPE){
+        return (a->i > b->i) - (a->i < b->i);
+    }
+    Operand x, y;
+    readOperand(a, &x);
+    readOperand(b, &y);
+    bool xNegative = x.negative && x.size > 0;
+    bool yNegative = y.negative && y.size > 0;
+    if(xNegative != yNegative){
+        return xNegative ? -1 : 1;
+    }
+    int order = compareMagnitudes(x.digits, x.size, y.digits, y.size);
+    return xNegative ? -order : order;
+}
+
+// Return the double nearest to a.
+double integerToDouble(Value *a){
+    if(a->type == INT_TYPE){
+        return (double)a->i;
+    }
+    double result = 0;
+    for(int i = a->b->size - 1; i >= 0; i--){
+        result = result * 4294967296.0 + a->b->digits[i];
+    }
+    return a->b->negative ? -result : result;
+}
+
+// Write a in decimal to the current output.
+void writeInteger(Value *a){
+    if(a->type == INT_TYPE){
+        writeInt(a->i);
+        return;
+    }
+    // Peel off nine decimal digits at a time, least significant first. A
+    // bignum has at least one digit, so there is always at least one chunk.
+    int size = a->b->size;
+    uint32_t *digits = malloc(sizeof(uint32_t) * size);
+    memcpy(digits, a->b->digits, sizeof(uint32_t) * size);
+    int chunkCount = 0;
+    uint32_t *chunks = malloc(sizeof(uint32_t) * (size * 10 / 9 + 2));
+    do {
+        chunks[chunkCount++] = divideMagnitudeByDigit(digits, size, DECIMAL_BASE);
+        size = trimMagnitude(digits, size);
+    } while(size > 0);
+
+    char *text = malloc(chunkCount * 9 + 2);
+    int length = 0;
+    if(a->b->negative){
+        text[length++] = '-';
+    }
+    length += sprintf(text + length, "%u", chunks[chunkCount - 1]);
+    for(int i = chunkCount - 2; i >= 0; i--){
+        length += sprintf(text + length, "%09u", chunks[i]);
+    }
+    writeString(text);
+    free(text);
+    free(chunks);
+    free(digits);
+}
+
+// Return the integer written in decimal in text, an optional sign followed
+// by digits only.
+Value *parseInteger(const char *text){
+    bool negative = false;
+    if(*text == '-' || *text == '+'){
+        negative = *text == '-';
+        text++;
+    }
+    int length = strlen(text);
+    // Each digit of the result holds more than nine decimal digits
+    int capacity = length / 9 + 2;
+    uint32_t *digits = calloc(capacity, sizeof(uint32_t));
+    int size = 0;
+    int i = 0;
+    while(i < length){
+        // Take the next chunk of up to nine decimal digits
+        int chunkLength = (length - i) % 9 == 0 ? 9 : (length - i) % 9;
+        uint32_t chunk = 0;
+        uint32_t scale = 1;
+        for(int j = 0; j < chunkLength; j++){
+            chunk = chunk * 10 + (text[i + j] - '0');
+            scale *= 10;
+        }
+        i += chunkLength;
+
+        // digits = digits * scale + chunk
+        uint64_t carry = chunk;
+        for(int j = 0; j < size; j++){
+            uint64_t product = (uint64_t)digits[j] * scale + carry;
+            digits[j] = (uint32_t)product;
+            carry = product >> 32;
+        }
+        if(carry != 0){
+            digits[size++] = (uint32_t)carry;
+        }
+    }
+    Value *result = makeInteger(negative, digits, size);
+    free(digits);
+    return result;
+}
+
+#endif
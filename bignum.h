@@ -0,0 +1,41 @@
+#include <stdint.h>
+#include "value.h"
+
+#ifndef _BIGNUM
+#define _BIGNUM
+
+// Integer arithmetic past the fixnum range. Each function takes INT_TYPE or
+// BIGNUM_TYPE Values and returns an INT_TYPE Value whenever the result fits
+// in an int64_t and a BIGNUM_TYPE one otherwise, so an integer has exactly
+// one representation. The evaluator tries fixnum arithmetic first and calls
+// these only when it overflows or an operand is already a bignum.
+
+// Return a + b.
+Value *integerAdd(Value *a, Value *b);
+
+// Return a - b.
+Value *integerSubtract(Value *a, Value *b);
+
+// Return a * b. Large operands are multiplied with Karatsuba's method.
+Value *integerMultiply(Value *a, Value *b);
+
+// Divide a by b, truncating toward zero, storing the quotient in *quotient
+// and the remainder, which has the sign of a, in *remainder. Either may be
+// NULL if it is not needed. Raises an evaluation error if b is zero.
+void integerDivide(Value *a, Value *b, Value **quotient, Value **remainder);
+
+// Return a negative number, zero or a positive number as a is less than,
+// equal to or greater than b.
+int integerCompare(Value *a, Value *b);
+
+// Return the double nearest to a.
+double integerToDouble(Value *a);
+
+// Write a in decimal to the current output.
+void writeInteger(Value *a);
+
+// Return the integer written in decimal in text, an optional sign followed
+// by digits only.
+Value *parseInteger(const char *text);
+
+#endif
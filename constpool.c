@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "value.h"
+#include "talloc.h"
+#include "bignum.h"
+#include "text.h"
+
+#ifndef _CONSTPOOL
+#define _CONSTPOOL
+
+// Slots a pool starts with; always a power of two
+#define POOL_CAPACITY 256
+
+// Prepare an empty pool.
+void initConstantPool(ConstantPool *pool){
+    pool->entries = calloc(POOL_CAPACITY, sizeof(PoolEntry));
+    pool->capacity = POOL_CAPACITY;
+    pool->count = 0;
+}
+
+// Free the pool's table. The constants themselves stay.
+void freeConstantPool(ConstantPool *pool){
+    free(pool->entries);
+    pool->entries = NULL;
+}
+
+// Mixes length bytes into an FNV-1a hash
+uint64_t hashBytes(uint64_t hash, const void *bytes, size_t length){
+    const unsigned char *b = bytes;
+    for(size_t i = 0; i < length; i++){
+        hash ^= b[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Returns the hash of a pooled atom. Doubles hash by their bits, so 0.0 and
+// -0.0 stay apart.
+uint64_t hashAtom(Value *atom){
+    uint64_t hash = hashBytes(14695981039346656037ULL, &atom->type, sizeof(atom->type));
+    switch(atom->type){
+        case INT_TYPE:
+        case BOOL_TYPE:
+            return hashBytes(hash, &atom->i, sizeof(atom->i));
+        case DOUBLE_TYPE:
+            return hashBytes(hash, &atom->d, sizeof(atom->d));
+        case BIGNUM_TYPE:
+            return hashBytes(hash, atom->b->digits, sizeof(uint32_t) * atom->b->size) ^ atom->b->negative;
+        case STR_TYPE:
+            return hashBytes(hash, atom->s, atom->length);
+        default:
+            return hashBytes(hash, atom->s, strlen(atom->s));
+    }
+}
+
+// Returns the hash of a list with the given elements, from their addresses.
+// Mixes in a whole address per step; the final fold brings the high bits,
+// which the aligned addresses' zero low bits leave the only varied ones, down
+// to where the table's slot index is taken from.
+uint64_t hashItems(Value **items, int count){
+    uint64_t hash = 14695981039346656037ULL ^ (uint64_t)count;
+    for(int i = 0; i < count; i++){
+        hash = (hash ^ (uint64_t)(uintptr_t)items[i]) * 1099511628211ULL;
+    }
+    return hash ^ (hash >> 32);
+}
+
+// Returns whether two atoms are the same constant
+bool atomsEqual(Value *a, Value *b){
+    if(a->type != b->type){
+        return false;
+    }
+    switch(a->type){
+        case INT_TYPE:
+        case BOOL_TYPE:
+            return a->i == b->i;
+        case DOUBLE_TYPE:
+            return !memcmp(&a->d, &b->d, sizeof(double));
+        case BIGNUM_TYPE:
+            return integerCompare(a, b) == 0;
+        case STR_TYPE:
+            return compareStrings(a, b) == 0;
+        case SYMBOL_TYPE:
+            return !strcmp(a->s, b->s);
+        default:
+            return false;
+    }
+}
+
+// Returns whether a pooled list has exactly the given elements
+bool listHasItems(Value *list, Value **items, int count){
+    for(int i = 0; i < count; i++){
+        if(list->type != CONS_TYPE || list->c.car != items[i]){
+            return false;
+        }
+        list = list->c.cdr;
+    }
+    return list->type == NULL_TYPE;
+}
+
+// Puts a constant into the first free slot of its probe sequence
+void placeConstant(PoolEntry *entries, int capacity, Value *constant, uint64_t hash){
+    int slot = hash & (capacity - 1);
+    while(entries[slot].value != NULL){
+        slot = (slot + 1) & (capacity - 1);
+    }
+    entries[slot].value = constant;
+    entries[slot].hash = hash;
+}
+
+// Adds a constant with the given hash, doubling the table when it is half
+// full
+void addConstant(ConstantPool *pool, Value *constant, uint64_t hash){
+    if((pool->count + 1) * 2 > pool->capacity){
+        int capacity = pool->capacity * 2;
+        PoolEntry *entries = calloc(capacity, sizeof(PoolEntry));
+        for(int i = 0; i < pool->capacity; i++){
+            if(pool->entries[i].value != NULL){
+                placeConstant(entries, capacity, pool->entries[i].value, pool->entries[i].hash);
+            }
+        }
+        free(pool->entries);
+        pool->entries = entries;
+        pool->capacity = capacity;
+    }
+    placeConstant(pool->entries, pool->capacity, constant, hash);
+    pool->count++;
+}
+
+// Return the pooled number, string, symbol or boolean equal to candidate,
+// adding a copy of candidate if there is none. Candidate may live on the C
+// stack and its text may be temporary; the copy has text of its own.
+Value *internConstant(ConstantPool *pool, Value *candidate){
+    uint64_t hash = hashAtom(candidate);
+    int slot = hash & (pool->capacity - 1);
+    for(; pool->entries[slot].value != NULL; slot = (slot + 1) & (pool->capacity - 1)){
+        if(pool->entries[slot].hash == hash && atomsEqual(pool->entries[slot].value, candidate)){
+            return pool->entries[slot].value;
+        }
+    }
+    Value *constant;
+    if(candidate->type == STR_TYPE){
+        constant = makeString(candidate->s, candidate->length);
+    } else {
+        constant = talloc(sizeof(Value));
+        *constant = *candidate;
+        if(candidate->type == SYMBOL_TYPE){
+            constant->s = talloc(strlen(candidate->s) + 1);
+            strcpy(constant->s, candidate->s);
+        }
+    }
+    addConstant(pool, constant, hash);
+    return constant;
+}
+
+// Return the pooled list whose elements are the count values in items, the
+// same pointers in the same order, or NULL if there is none. Stores the
+// hash of such a list in *hash, for adding one with addConstantList.
+Value *findConstantList(ConstantPool *pool, Value **items, int count, uint64_t *hash){
+    *hash = hashItems(items, count);
+    int slot = *hash & (pool->capacity - 1);
+    for(; pool->entries[slot].value != NULL; slot = (slot + 1) & (pool->capacity - 1)){
+        Value *constant = pool->entries[slot].value;
+        if(pool->entries[slot].hash == *hash && listHasItems(constant, items, count)){
+            return constant;
+        }
+    }
+    return NULL;
+}
+
+// Add a list to the pool, with the hash findConstantList gave for its
+// elements. No list with the same elements may be pooled already. Elements
+// are compared by address, so a list is only ever shared when its elements
+// are pooled too.
+void addConstantList(ConstantPool *pool, Value *list, uint64_t hash){
+    addConstant(pool, list, hash);
+}
+
+#endif
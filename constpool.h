@@ -0,0 +1,35 @@
+#include <stdint.h>
+#include "value.h"
+
+#ifndef _CONSTPOOL
+#define _CONSTPOOL
+
+// Constant pools hash-cons the literals of a program: the tokenizer pools
+// numbers, strings, symbols and booleans, and the parser pools the lists
+// inside quote forms, which hold only pooled elements. Identical constants
+// then share one Value, so comparisons of them succeed on pointer equality.
+// Pooled constants must never be mutated.
+
+// Prepare an empty pool.
+void initConstantPool(ConstantPool *pool);
+
+// Free the pool's table. The constants themselves stay.
+void freeConstantPool(ConstantPool *pool);
+
+// Return the pooled number, string, symbol or boolean equal to candidate,
+// adding a copy of candidate if there is none. Candidate may live on the C
+// stack and its text may be temporary; the copy has text of its own.
+Value *internConstant(ConstantPool *pool, Value *candidate);
+
+// Return the pooled list whose elements are the count values in items, the
+// same pointers in the same order, or NULL if there is none. Stores the
+// hash of such a list in *hash, for adding one with addConstantList.
+Value *findConstantList(ConstantPool *pool, Value **items, int count, uint64_t *hash);
+
+// Add a list to the pool, with the hash findConstantList gave for its
+// elements. No list with the same elements may be pooled already. Elements
+// are compared by address, so a list is only ever shared when its elements
+// are pooled too.
+void addConstantList(ConstantPool *pool, Value *list, uint64_t hash);
+
+#endif
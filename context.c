@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include "value.h"
+#include "talloc.h"
+#include "tokenizer.h"
+#include "parser.h"
+#include "interpreter.h"
+#include "output.h"
+#include "scheduler.h"
+#include "greenthread.h"
+
+#ifndef _CONTEXT
+#define _CONTEXT
+
+// Create a new instance reading its program from input and writing results
+// to output. The streams stay owned by the caller.
+Interpreter *makeInterpreter(FILE *input, FILE *output){
+    Interpreter *interpreter = malloc(sizeof(Interpreter));
+    interpreter->input = input;
+    interpreter->output = output;
+    // Fully buffered even for pipes and terminals; stdio sizes the buffer
+    setvbuf(output, NULL, _IOFBF, 0);
+    interpreter->status = 0;
+
+    void *previous = tswap(NULL);
+    interpreter->globalFrame = makeGlobalFrame();
+    interpreter->heap = tswap(previous);
+    return interpreter;
+}
+
+// Tokenize, parse and evaluate everything on the instance's input, in its
+// global frame, on the calling thread. A syntax error stops the program and
+// an evaluation error ends only the form that raised it; after either, 1 is
+// returned. The instance keeps its global frame and can be run again. If
+// texit is called, the instance ends: its heap is freed, the exit status is
+// returned and it cannot be run again. Returns 0 otherwise. Futures the
+// program started are finished before this returns, touched or not; green
+// threads it spawned that have not finished by the end never run.
+int runInterpreter(Interpreter *interpreter){
+    if(interpreter->globalFrame == NULL){
+        return interpreter->status;
+    }
+    void *previousHeap = tswap(interpreter->heap);
+    FILE *previousOutput = currentOutput();
+    outputSetStream(interpreter->output);
+
+    jmp_buf handler;
+    int exitCode = setjmp(handler);
+    if(exitCode == 0){
+        setExitHandler(&handler);
+        interpreter->status = interpretStream(interpreter->input, interpreter->globalFrame);
+        // Nothing the program started may outlive the run, since the heap
+        // can be destroyed and the output closed once it returns
+        waitForSubmittedTasks();
+        discardGreenThreads();
+    } else {
+        // texit already freed the heap
+        interpreter->globalFrame = NULL;
+        interpreter->status = exitCode - 1;
+    }
+    setExitHandler(NULL);
+    fflush(interpreter->output);
+
+    outputSetStream(previousOutput);
+    interpreter->heap = tswap(previousHeap);
+    return interpreter->status;
+}
+
+// Free the instance and everything it allocated.
+void destroyInterpreter(Interpreter *interpreter){
+    void *previous = tswap(interpreter->heap);
+    tfree();
+    tswap(previous);
+    fflush(interpreter->output);
+    free(interpreter);
+}
+
+#endif
@@ -0,0 +1,24 @@
+#include <stdio.h>
+#include "value.h"
+
+#ifndef _CONTEXT
+#define _CONTEXT
+
+// Create a new instance reading its program from input and writing results
+// to output. The streams stay owned by the caller.
+Interpreter *makeInterpreter(FILE *input, FILE *output);
+
+// Tokenize, parse and evaluate everything on the instance's input, in its
+// global frame, on the calling thread. A syntax error stops the program and
+// an evaluation error ends only the form that raised it; after either, 1 is
+// returned. The instance keeps its global frame and can be run again. If
+// texit is called, the instance ends: its heap is freed, the exit status is
+// returned and it cannot be run again. Returns 0 otherwise. Futures the
+// program started are finished before this returns, touched or not; green
+// threads it spawned that have not finished by the end never run.
+int runInterpreter(Interpreter *interpreter);
+
+// Free the instance and everything it allocated.
+void destroyInterpreter(Interpreter *interpreter);
+
+#endif
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include "value.h"
+#include "talloc.h"
+#include "output.h"
+#include "interpreter.h"
+
+#ifndef _ERROR
+#define _ERROR
+
+// Innermost error handler on this thread, or NULL
+_Thread_local ErrorHandler *errorHandlers = NULL;
+
+// Make handler the innermost error handler on this thread. The caller must
+// then call setjmp on handler->jump: it returns 0 at first, and nonzero when
+// an error is raised while the handler is innermost, with the raised value
+// in handler->raised and the handler already removed. If evaluation
+// finishes without an error, the caller removes the handler with
+// popErrorHandler.
+void pushErrorHandler(ErrorHandler *handler){
+    handler->raised = NULL;
+    handler->outer = errorHandlers;
+    errorHandlers = handler;
+}
+
+// Remove handler, which must be the innermost error handler on this thread.
+void popErrorHandler(ErrorHandler *handler){
+    errorHandlers = handler->outer;
+}
+
+// Print a raised value that no handler took, as an "Evaluation error" or
+// "Syntax error" line.
+void printError(Value *raised){
+    if(raised->type == ERROR_TYPE){
+        writeFormat("%s error: %s\n", raised->e.syntax ? "Syntax" : "Evaluation", raised->e.message);
+    } else {
+        writeString("Evaluation error: uncaught exception ");
+        printValue(raised);
+    }
+}
+
+// Unwind to the innermost error handler on this thread, handing it value.
+// With no handler, the error is printed and the process exits with status 1.
+// Does not return.
+void raiseValue(Value *value){
+    ErrorHandler *handler = errorHandlers;
+    if(handler == NULL){
+        printError(value);
+        texit(1);
+    }
+    errorHandlers = handler->outer;
+    handler->raised = value;
+    longjmp(handler->jump, 1);
+}
+
+// Create an ERROR_TYPE Value with the given message, which is copied.
+Value *makeError(const char *message, bool syntax){
+    Value *error = talloc(sizeof(Value));
+    error->type = ERROR_TYPE;
+    error->e.message = talloc(strlen(message) + 1);
+    strcpy(error->e.message, message);
+    error->e.syntax = syntax;
+    error->e.limit = false;
+    return error;
+}
+
+// Raises an error with a message formatted from format and arguments
+void raiseFormatted(bool syntax, const char *format, va_list arguments){
+    char message[512];
+    vsnprintf(message, sizeof(message), format, arguments);
+    raiseValue(makeError(message, syntax));
+}
+
+// Raise an ERROR_TYPE Value whose message is built from format and the
+// arguments after it, as with printf. Does not return.
+void evaluationError(const char *format, ...){
+    va_list arguments;
+    va_start(arguments, format);
+    raiseFormatted(false, format, arguments);
+    va_end(arguments);
+}
+
+// Like evaluationError, for malformed source found by the tokenizer or
+// parser. Does not return.
+void syntaxError(const char *format, ...){
+    va_list arguments;
+    va_start(arguments, format);
+    raiseFormatted(true, format, arguments);
+    va_end(arguments);
+}
+
+// Make handlers, a value earlier returned by this function, the error
+// handler stack on this thread, and return the one that was in place.
+// Passing NULL leaves the thread with no handlers. Green threads keep one
+// stack each this way.
+void *swapErrorHandlers(void *handlers){
+    ErrorHandler *previous = errorHandlers;
+    errorHandlers = handlers;
+    return previous;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include "value.h"
+
+#ifndef _ERROR
+#define _ERROR
+
+// Make handler the innermost error handler on this thread. The caller must
+// then call setjmp on handler->jump: it returns 0 at first, and nonzero when
+// an error is raised while the handler is innermost, with the raised value
+// in handler->raised and the handler already removed. If evaluation
+// finishes without an error, the caller removes the handler with
+// popErrorHandler.
+void pushErrorHandler(ErrorHandler *handler);
+
+// Remove handler, which must be the innermost error handler on this thread.
+void popErrorHandler(ErrorHandler *handler);
+
+// Unwind to the innermost error handler on this thread, handing it value.
+// With no handler, the error is printed and the process exits with status 1.
+// Does not return.
+void raiseValue(Value *value);
+
+// Raise an ERROR_TYPE Value whose message is built from format and the
+// arguments after it, as with printf. Does not return.
+void evaluationError(const char *format, ...);
+
+// Like evaluationError, for malformed source found by the tokenizer or
+// parser. Does not return.
+void syntaxError(const char *format, ...);
+
+// Create an ERROR_TYPE Value with the given message, which is copied.
+Value *makeError(const char *message, bool syntax);
+
+// Print a raised value that no handler took, as an "Evaluation error" or
+// "Syntax error" line.
+void printError(Value *raised);
+
+// Make handlers, a value earlier returned by this function, the error
+// handler stack on this thread, and return the one that was in place.
+// Passing NULL leaves the thread with no handlers. Green threads keep one
+// stack each this way.
+void *swapErrorHandlers(void *handlers);
+
+#endif
@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "value.h"
+#include "talloc.h"
+#include "linkedlist.h"
+#include "tokenizer.h"
+#include "parser.h"
+#include "interpreter.h"
+#include "output.h"
+
+#ifndef _FORKSERVER
+#define _FORKSERVER
+
+// Returns the current time on the monotonic clock in microseconds. The clock
+// is shared by every process, so a child can compare against a time its
+// parent read before forking.
+long long microseconds(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// Returns how long it takes to start a new interpreter process, load the
+// prelude and evaluate an empty program, in microseconds, or -1 if the
+// interpreter cannot be launched
+long long measureColdLaunch(char *preludePath){
+    long long start = microseconds();
+    pid_t child = fork();
+    if(child < 0){
+        return -1;
+    }
+    if(child == 0){
+        int devNull = open("/dev/null", O_RDWR);
+        dup2(devNull, STDIN_FILENO);
+        dup2(devNull, STDOUT_FILENO);
+        if(preludePath != NULL){
+            execl("/proc/self/exe", "interpreter", "--prelude", preludePath, (char *)NULL);
+        } else {
+            execl("/proc/self/exe", "interpreter", (char *)NULL);
+        }
+        _exit(127);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) == 127){
+        return -1;
+    }
+    return microseconds() - start;
+}
+
+// Runs one job in the child process: evaluates the program on input in
+// globalFrame, writing results to stdout, and reports its timing. forkTime is
+// when the parent began forking this child. Never returns.
+void runForkedJob(int job, FILE *input, Frame *globalFrame, long long forkTime){
+    long long readyTime = microseconds();
+
+    // An error ends only this child, but still gets reported
+    jmp_buf handler;
+    int status = setjmp(handler);
+    if(status == 0){
+        setExitHandler(&handler);
+        status = interpretStream(input, globalFrame);
+    }
+    outputFlush();
+
+    long long doneTime = microseconds();
+    fprintf(stderr, "job %d: startup %lld us, total %lld us%s\n",
+        job, readyTime - forkTime, doneTime - forkTime,
+        status == 0 ? "" : ", failed");
+    // Skip tfree and the exit handlers: freeing would touch, and so copy,
+    // every page of the inherited heap just before it is thrown away, and
+    // closing inherited streams could move file offsets the parent shares
+    _exit(status == 0 ? 0 : 1);
+}
+
+// Forks a child to run the script at path and waits for it to finish
+void forkScript(int job, char *path, Frame *globalFrame){
+    fflush(stdout);
+    long long forkTime = microseconds();
+    pid_t child = fork();
+    if(child < 0){
+        perror("Fork server error: fork");
+        return;
+    }
+    if(child == 0){
+        FILE *input = fopen(path, "r");
+        if(input == NULL){
+            fprintf(stderr, "job %d: cannot open %s\n", job, path);
+            _exit(1);
+        }
+        runForkedJob(job, input, globalFrame, forkTime);
+    }
+    waitpid(child, NULL, 0);
+}
+
+// Forks a child to answer the request on one accepted connection, without
+// waiting for it
+void forkRequest(int job, int client, Frame *globalFrame){
+    fflush(stdout);
+    long long forkTime = microseconds();
+    pid_t child = fork();
+    if(child < 0){
+        perror("Fork server error: fork");
+        close(client);
+        return;
+    }
+    if(child == 0){
+        FILE *input = fdopen(dup(client), "r");
+        dup2(client, STDOUT_FILENO);
+        close(client);
+        if(input == NULL){
+            _exit(1);
+        }
+        runForkedJob(job, input, globalFrame, forkTime);
+    }
+    close(client);
+}
+
+// Opens a listening Unix domain socket at socketPath, or returns -1
+int listenOn(char *socketPath){
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(strlen(socketPath) >= sizeof(address.sun_path)){
+        fprintf(stderr, "Fork server error: socket path too long\n");
+        return -1;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listener < 0){
+        perror("Fork server error: socket");
+        return -1;
+    }
+    unlink(socketPath);
+    if(bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0
+            || listen(listener, 64) < 0){
+        perror("Fork server error: bind");
+        close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+// Run jobs in forked children of this process, so every job starts from a
+// copy-on-write image of globalFrame and the heap behind it, with the prelude
+// already parsed and evaluated. Jobs come from a Unix domain socket at
+// socketPath, one request per connection as with runServer, or, when
+// socketPath is NULL, from jobsPath, a file naming one script per line that
+// are run in order with their output on stdout. Since each child has its own
+// copy of the heap, jobs may define and set! globals freely without affecting
+// later ones. On stderr, the time to launch a fresh interpreter process that
+// loads preludePath (which may be NULL) is reported first, followed by each
+// job's startup latency (from just before the fork until the child is ready
+// to evaluate) and total time. Returns nonzero if the jobs cannot be read.
+int runForkServer(char *socketPath, char *jobsPath, Frame *globalFrame,
+        char *preludePath){
+    long long cold = measureColdLaunch(preludePath);
+    if(cold < 0){
+        fprintf(stderr, "cold launch: unavailable\n");
+    } else {
+        fprintf(stderr, "cold launch: %lld us\n", cold);
+    }
+
+    int job = 1;
+    if(socketPath == NULL){
+        FILE *jobs = fopen(jobsPath, "r");
+        if(jobs == NULL){
+            fprintf(stderr, "Fork server error: cannot open %s\n", jobsPath);
+            return 1;
+        }
+        // Read every path before forking, so no child shares a half-read
+        // stream with the parent
+        int count = 0;
+        int capacity = 16;
+        char **paths = malloc(sizeof(char *) * capacity);
+        char line[4096];
+        while(fgets(line, sizeof(line), jobs) != NULL){
+            line[strcspn(line, "\r\n")] = '\0';
+            if(line[0] == '\0'){
+                continue;
+            }
+            if(count == capacity){
+                capacity *= 2;
+                paths = realloc(paths, sizeof(char *) * capacity);
+            }
+            paths[count++] = strdup(line);
+        }
+        fclose(jobs);
+        for(int i = 0; i < count; i++){
+            forkScript(job++, paths[i], globalFrame);
+            free(paths[i]);
+        }
+        free(paths);
+        return 0;
+    }
+
+    int listener = listenOn(socketPath);
+    if(listener < 0){
+        return 1;
+    }
+    // Children are never waited for, so have the kernel reap them, and a
+    // client that hangs up early should not take its child down with it
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+
+    while(1){
+        int client = accept(listener, NULL, NULL);
+        if(client < 0){
+            continue;
+        }
+        forkRequest(job++, client, globalFrame);
+    }
+    return 0;
+}
+
+#endif
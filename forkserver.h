@@ -0,0 +1,20 @@
+#include "value.h"
+
+#ifndef _FORKSERVER
+#define _FORKSERVER
+
+// Run jobs in forked children of this process, so every job starts from a
+// copy-on-write image of globalFrame and the heap behind it, with the prelude
+// already parsed and evaluated. Jobs come from a Unix domain socket at
+// socketPath, one request per connection as with runServer, or, when
+// socketPath is NULL, from jobsPath, a file naming one script per line that
+// are run in order with their output on stdout. Since each child has its own
+// copy of the heap, jobs may define and set! globals freely without affecting
+// later ones. On stderr, the time to launch a fresh interpreter process that
+// loads preludePath (which may be NULL) is reported first, followed by each
+// job's startup latency (from just before the fork until the child is ready
+// to evaluate) and total time. Returns nonzero if the jobs cannot be read.
+int runForkServer(char *socketPath, char *jobsPath, Frame *globalFrame,
+    char *preludePath);
+
+#endif
@@ -0,0 +1,297 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include "value.h"
+#include "talloc.h"
+#include "linkedlist.h"
+#include "interpreter.h"
+#include "output.h"
+#include "error.h"
+#include "seal.h"
+#include "profiler.h"
+
+#ifndef _GREENTHREAD
+#define _GREENTHREAD
+
+// Stack size of each green thread, the same as a usual main thread stack.
+// Stacks are mapped without reserving memory up front, so only the pages a
+// thread actually touches cost anything and thousands of threads fit easily.
+#define GREEN_STACK_SIZE (8 * 1024 * 1024)
+
+// Deepest evaluation a green thread may reach. Past it the thread gets an
+// evaluation error rather than running into its guard page and crashing the
+// process. A level of evaluation takes at most about 500 bytes of stack even
+// in unoptimized builds, so this stays well inside GREEN_STACK_SIZE.
+#define GREEN_DEPTH_LIMIT 10000
+
+// A green thread and the state of its evaluation while it is switched out
+typedef struct GreenThread {
+    ucontext_t context;
+    // Mapped stack including its guard page, or NULL for the main program
+    char *stack;
+    Value *thunk;
+    Value *result;
+    bool finished;
+    // Evaluation depth of the thread while it is switched out, and the
+    // deepest its stack allows, see swapEvalDepth
+    long depth;
+    long depthLimit;
+    // Error handlers of the thread while it is switched out, see
+    // swapErrorHandlers, and the one a limit unwinds to, see swapFormHandler
+    void *errorHandlers;
+    ErrorHandler *formHandler;
+    // Profiler shadow stack of the thread while it is switched out, see
+    // profileSwapStack
+    Value **shadowStack;
+    int shadowDepth;
+    // Next thread in whichever queue this one waits in
+    struct GreenThread *next;
+    // Next thread spawned before this one on the same OS thread
+    struct GreenThread *nextSpawned;
+} GreenThread;
+
+// A first-in first-out list of green threads
+typedef struct GreenQueue {
+    GreenThread *head;
+    GreenThread *tail;
+} GreenQueue;
+
+// A bounded channel: a ring buffer of values plus the threads waiting on it
+typedef struct Channel {
+    Value **values;
+    int capacity;
+    int first;
+    int count;
+    GreenQueue putters;
+    GreenQueue getters;
+} Channel;
+
+// Scheduler state; each OS thread schedules its own green threads
+_Thread_local GreenThread mainThread;
+_Thread_local GreenThread *currentThread = NULL;
+_Thread_local GreenQueue runQueue = {NULL, NULL};
+// A finished thread whose stack is freed once we are off it
+_Thread_local GreenThread *deadThread = NULL;
+// Every thread spawned since the last discardGreenThreads, newest first
+_Thread_local GreenThread *spawnedThreads = NULL;
+
+// Adds a thread to the back of a queue
+void enqueue(GreenQueue *queue, GreenThread *thread){
+    thread->next = NULL;
+    if(queue->tail == NULL){
+        queue->head = thread;
+    } else {
+        queue->tail->next = thread;
+    }
+    queue->tail = thread;
+}
+
+// Removes the thread at the front of a queue, or returns NULL if empty
+GreenThread *dequeue(GreenQueue *queue){
+    GreenThread *thread = queue->head;
+    if(thread != NULL){
+        queue->head = thread->next;
+        if(queue->head == NULL){
+            queue->tail = NULL;
+        }
+    }
+    return thread;
+}
+
+// Returns the running green thread, treating the main program as one
+GreenThread *runningThread(){
+    if(currentThread == NULL){
+        mainThread.stack = NULL;
+        mainThread.finished = false;
+        mainThread.depthLimit = LONG_MAX;
+        currentThread = &mainThread;
+    }
+    return currentThread;
+}
+
+// Frees the stacks of a thread that finished, now that nothing runs on it
+void releaseDeadThread(){
+    if(deadThread != NULL){
+        munmap(deadThread->stack, GREEN_STACK_SIZE);
+        deadThread->stack = NULL;
+        profileFreeStack(deadThread->shadowStack);
+        deadThread->shadowStack = NULL;
+        deadThread = NULL;
+    }
+}
+
+// Switches from the running thread, which must already be queued somewhere
+// or finished, to the next runnable one
+void switchToNext(){
+    GreenThread *from = runningThread();
+    GreenThread *to = dequeue(&runQueue);
+    if(to == NULL){
+        evaluationError("every green thread is blocked");
+    }
+    if(to == from){
+        return;
+    }
+    currentThread = to;
+    from->errorHandlers = swapErrorHandlers(to->errorHandlers);
+    from->formHandler = swapFormHandler(to->formHandler);
+    from->depth = swapEvalDepth(to->depth, to->depthLimit);
+    profileSwapStack(&to->shadowStack, &to->shadowDepth);
+    from->shadowStack = to->shadowStack;
+    from->shadowDepth = to->shadowDepth;
+    to->shadowStack = NULL;
+    to->shadowDepth = 0;
+    swapcontext(&from->context, &to->context);
+    releaseDeadThread();
+}
+
+// Entry point of every green thread; it never returns, since a finished
+// thread switches away for good. An error the thunk does not handle, or a
+// limit it runs past, is printed and ends only this thread.
+void greenThreadStart(){
+    releaseDeadThread();
+    GreenThread *self = currentThread;
+    Value *raised;
+    self->result = applyCatchingLimits(self->thunk, makeNull(), &raised);
+    if(raised != NULL){
+        printError(raised);
+        self->result = raised;
+    }
+    self->finished = true;
+    deadThread = self;
+    switchToNext();
+}
+
+// Create a green thread that will apply thunk (a procedure of no arguments)
+// and return a THREAD_TYPE Value for it. Green threads are scheduled
+// cooperatively on the OS thread that created them, in the order they become
+// runnable; the new thread first runs when the current one yields or blocks.
+// Each evaluates on its own stack allocated apart from the C stack, and gets
+// an evaluation error instead of overflowing it when it recurses too deeply.
+Value *spawnGreenThread(Value *thunk){
+    runningThread();
+    GreenThread *thread = talloc(sizeof(GreenThread));
+    thread->thunk = thunk;
+    thread->result = NULL;
+    thread->finished = false;
+    thread->depth = 0;
+    thread->depthLimit = GREEN_DEPTH_LIMIT;
+    thread->errorHandlers = NULL;
+    thread->formHandler = NULL;
+    thread->shadowStack = NULL;
+    thread->shadowDepth = 0;
+    thread->stack = mmap(NULL, GREEN_STACK_SIZE, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(thread->stack == MAP_FAILED){
+        evaluationError("cannot allocate green thread stack");
+    }
+    // The lowest page catches a runaway recursion instead of letting it
+    // overwrite whatever is mapped below
+    mprotect(thread->stack, 4096, PROT_NONE);
+
+    getcontext(&thread->context);
+    thread->context.uc_stack.ss_sp = thread->stack;
+    thread->context.uc_stack.ss_size = GREEN_STACK_SIZE;
+    thread->context.uc_link = NULL;
+    makecontext(&thread->context, greenThreadStart, 0);
+    enqueue(&runQueue, thread);
+    thread->nextSpawned = spawnedThreads;
+    spawnedThreads = thread;
+
+    Value *threadValue = talloc(sizeof(Value));
+    threadValue->type = THREAD_TYPE;
+    threadValue->p = thread;
+    return threadValue;
+}
+
+// Let every other runnable green thread run once before continuing. The main
+// program counts as a green thread too.
+void yieldGreenThread(){
+    if(runQueue.head == NULL){
+        return;
+    }
+    enqueue(&runQueue, runningThread());
+    switchToNext();
+}
+
+// Blocks the running thread in queue until another thread makes it runnable.
+// With no other thread runnable that can never happen, so it is an error,
+// raised before the thread is queued so that handling it is safe.
+void blockOn(GreenQueue *queue){
+    if(runQueue.head == NULL){
+        evaluationError("every green thread is blocked");
+    }
+    enqueue(queue, runningThread());
+    switchToNext();
+}
+
+// Drop every green thread spawned on the calling OS thread that has not
+// finished, whether runnable or blocked, and free their stacks; they never
+// run again. Call it from the main program, not a green thread, before
+// freeing the heap the threads were spawned on.
+void discardGreenThreads(){
+    releaseDeadThread();
+    for(GreenThread *thread = spawnedThreads; thread != NULL; thread = thread->nextSpawned){
+        if(thread->stack != NULL){
+            munmap(thread->stack, GREEN_STACK_SIZE);
+            thread->stack = NULL;
+            profileFreeStack(thread->shadowStack);
+            thread->shadowStack = NULL;
+        }
+    }
+    spawnedThreads = NULL;
+    runQueue.head = runQueue.tail = NULL;
+}
+
+// Create a CHANNEL_TYPE Value holding up to capacity values.
+Value *makeChannel(int capacity){
+    Channel *channel = talloc(sizeof(Channel));
+    channel->values = talloc(sizeof(Value *) * capacity);
+    channel->capacity = capacity;
+    channel->first = 0;
+    channel->count = 0;
+    channel->putters.head = channel->putters.tail = NULL;
+    channel->getters.head = channel->getters.tail = NULL;
+
+    Value *channelValue = talloc(sizeof(Value));
+    channelValue->type = CHANNEL_TYPE;
+    channelValue->p = channel;
+    return channelValue;
+}
+
+// Add a value to a channel, blocking the current green thread while the
+// channel is full.
+void channelPut(Value *channelValue, Value *value){
+    checkUnsealed(channelValue, "use a channel made");
+    Channel *channel = channelValue->p;
+    while(channel->count == channel->capacity){
+        blockOn(&channel->putters);
+    }
+    channel->values[(channel->first + channel->count) % channel->capacity] = value;
+    channel->count++;
+    GreenThread *getter = dequeue(&channel->getters);
+    if(getter != NULL){
+        enqueue(&runQueue, getter);
+    }
+}
+
+// Remove and return the oldest value in a channel, blocking the current green
+// thread while the channel is empty.
+Value *channelGet(Value *channelValue){
+    checkUnsealed(channelValue, "use a channel made");
+    Channel *channel = channelValue->p;
+    while(channel->count == 0){
+        blockOn(&channel->getters);
+    }
+    Value *value = channel->values[channel->first];
+    channel->first = (channel->first + 1) % channel->capacity;
+    channel->count--;
+    GreenThread *putter = dequeue(&channel->putters);
+    if(putter != NULL){
+        enqueue(&runQueue, putter);
+    }
+    return value;
+}
+
+#endif
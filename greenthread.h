@@ -0,0 +1,35 @@
+#include "value.h"
+
+#ifndef _GREENTHREAD
+#define _GREENTHREAD
+
+// Create a green thread that will apply thunk (a procedure of no arguments)
+// and return a THREAD_TYPE Value for it. Green threads are scheduled
+// cooperatively on the OS thread that created them, in the order they become
+// runnable; the new thread first runs when the current one yields or blocks.
+// Each evaluates on its own stack allocated apart from the C stack, and gets
+// an evaluation error instead of overflowing it when it recurses too deeply.
+Value *spawnGreenThread(Value *thunk);
+
+// Let every other runnable green thread run once before continuing. The main
+// program counts as a green thread too.
+void yieldGreenThread();
+
+// Drop every green thread spawned on the calling OS thread that has not
+// finished, whether runnable or blocked, and free their stacks; they never
+// run again. Call it from the main program, not a green thread, before
+// freeing the heap the threads were spawned on.
+void discardGreenThreads();
+
+// Create a CHANNEL_TYPE Value holding up to capacity values.
+Value *makeChannel(int capacity);
+
+// Add a value to a channel, blocking the current green thread while the
+// channel is full.
+void channelPut(Value *channel, Value *value);
+
+// Remove and return the oldest value in a channel, blocking the current green
+// thread while the channel is empty.
+Value *channelGet(Value *channel);
+
+#endif
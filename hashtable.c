@@ -0,0 +1,248 @@
+#include <stdbool.h>
+#include "value.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "talloc.h"
+#include "linkedlist.h"
+#include "text.h"
+
+#ifndef _HASHTABLE
+#define _HASHTABLE
+
+// Number of old slots moved into the new slot array by each operation while
+// a resize is in progress. Growing doubles the capacity, so the old array is
+// always drained long before the new one fills up.
+#define MIGRATE_PER_OPERATION 8
+
+// Returns the hash of a key. Symbols and strings with the same text hash
+// differently, since they are different keys.
+unsigned int hashKey(Value *key){
+    unsigned int hash;
+    if(key->type == INT_TYPE){
+        // Fold in the high half so keys past 32 bits still spread out
+        hash = (unsigned int)(key->i ^ (key->i >> 32)) * 2654435761u;
+        hash ^= hash >> 16;
+        return hash;
+    }
+    hash = 2166136261u;
+    if(key->type == STR_TYPE){
+        for(size_t i = 0; i < key->length; i++){
+            hash ^= (unsigned char)key->s[i];
+            hash *= 16777619u;
+        }
+    } else {
+        for(char *c = key->s; *c != '\0'; c++){
+            hash ^= (unsigned char)*c;
+            hash *= 16777619u;
+        }
+    }
+    hash ^= key->type;
+    return hash;
+}
+
+// Returns whether two keys are the same key
+bool keysEqual(Value *a, Value *b){
+    if(a->type != b->type){
+        return false;
+    }
+    if(a->type == INT_TYPE){
+        return a->i == b->i;
+    }
+    if(a->type == STR_TYPE){
+        return a == b || compareStrings(a, b) == 0;
+    }
+    return a == b || !strcmp(a->s, b->s);
+}
+
+// Allocates a slot array with every slot empty
+HashEntry *makeEntries(int capacity){
+    HashEntry *entries = talloc(sizeof(HashEntry) * capacity);
+    memset(entries, 0, sizeof(HashEntry) * capacity);
+    return entries;
+}
+
+// Returns the slot holding key in the given slot array, or NULL
+HashEntry *findEntry(HashEntry *entries, int capacity, Value *key, unsigned int hash){
+    int mask = capacity - 1;
+    int index = hash & mask;
+    while(entries[index].key != NULL || entries[index].deleted){
+        HashEntry *entry = &entries[index];
+        if(!entry->deleted && entry->hash == hash && keysEqual(entry->key, key)){
+            return entry;
+        }
+        index = (index + 1) & mask;
+    }
+    return NULL;
+}
+
+// Puts a key that is not in the current slot array into its first free slot
+void placeEntry(HashTable *table, Value *key, Value *value, unsigned int hash){
+    int mask = table->capacity - 1;
+    int index = hash & mask;
+    while(table->entries[index].key != NULL && !table->entries[index].deleted){
+        index = (index + 1) & mask;
+    }
+    HashEntry *entry = &table->entries[index];
+    if(!entry->deleted){
+        table->used++;
+    }
+    entry->key = key;
+    entry->value = value;
+    entry->hash = hash;
+    entry->deleted = false;
+}
+
+// Moves the next few slots of an in-progress resize into the current array
+void migrateSome(HashTable *table, int slots){
+    if(table->oldEntries == NULL){
+        return;
+    }
+    int stop = table->migrated + slots;
+    if(stop > table->oldCapacity){
+        stop = table->oldCapacity;
+    }
+    while(table->migrated < stop){
+        HashEntry *old = &table->oldEntries[table->migrated];
+        if(old->key != NULL && !old->deleted){
+            placeEntry(table, old->key, old->value, old->hash);
+            // Keep the slot in the old probe sequences, but stop finding it
+            old->deleted = true;
+        }
+        table->migrated++;
+    }
+    if(table->migrated == table->oldCapacity){
+        table->oldEntries = NULL;
+        table->oldCapacity = 0;
+        table->migrated = 0;
+    }
+}
+
+// Starts a resize: the current slot array becomes the old one and is drained
+// by later operations. Capacity only doubles when the table is really fuller;
+// otherwise this just clears out deleted slots.
+void startResize(HashTable *table){
+    if(table->oldEntries != NULL){
+        migrateSome(table, table->oldCapacity);
+    }
+    int newCapacity = table->capacity;
+    if(table->count * 2 >= table->capacity){
+        newCapacity *= 2;
+    }
+    table->oldEntries = table->entries;
+    table->oldCapacity = table->capacity;
+    table->migrated = 0;
+    table->entries = makeEntries(newCapacity);
+    table->capacity = newCapacity;
+    table->used = 0;
+}
+
+// Create a pointer to a new HASHTABLE_TYPE Value with room for at least
+// capacity keys before its first resize.
+Value *makeHashTable(int capacity){
+    int slots = 8;
+    while(slots * 3 < capacity * 4){
+        slots *= 2;
+    }
+    HashTable *table = talloc(sizeof(HashTable));
+    table->entries = makeEntries(slots);
+    table->capacity = slots;
+    table->used = 0;
+    table->count = 0;
+    table->oldEntries = NULL;
+    table->oldCapacity = 0;
+    table->migrated = 0;
+
+    Value *tableValue = talloc(sizeof(Value));
+    tableValue->type = HASHTABLE_TYPE;
+    tableValue->h = table;
+    return tableValue;
+}
+
+// Return whether the given value can be used as a hash table key.
+bool isHashableKey(Value *key){
+    return key->type == INT_TYPE || key->type == STR_TYPE || key->type == SYMBOL_TYPE;
+}
+
+// Return the value bound to key in the table, or NULL if there is none.
+Value *hashTableGet(Value *table, Value *key){
+    assert(table->type == HASHTABLE_TYPE && isHashableKey(key));
+    HashTable *t = table->h;
+    unsigned int hash = hashKey(key);
+    HashEntry *entry = findEntry(t->entries, t->capacity, key, hash);
+    if(entry == NULL && t->oldEntries != NULL){
+        entry = findEntry(t->oldEntries, t->oldCapacity, key, hash);
+    }
+    if(entry == NULL){
+        return NULL;
+    }
+    return entry->value;
+}
+
+// Bind key to value in the table, replacing any existing binding.
+void hashTableSet(Value *table, Value *key, Value *value){
+    assert(table->type == HASHTABLE_TYPE && isHashableKey(key));
+    HashTable *t = table->h;
+    migrateSome(t, MIGRATE_PER_OPERATION);
+    unsigned int hash = hashKey(key);
+
+    HashEntry *entry = findEntry(t->entries, t->capacity, key, hash);
+    if(entry != NULL){
+        entry->value = value;
+        return;
+    }
+    // A key lives in exactly one of the two arrays, so one still waiting to
+    // be migrated moves over now
+    if(t->oldEntries != NULL){
+        entry = findEntry(t->oldEntries, t->oldCapacity, key, hash);
+        if(entry != NULL){
+            entry->deleted = true;
+            t->count--;
+        }
+    }
+    if((t->used + 1) * 4 > t->capacity * 3){
+        startResize(t);
+    }
+    placeEntry(t, key, value, hash);
+    t->count++;
+}
+
+// Remove key from the table. Returns whether it was present.
+bool hashTableDelete(Value *table, Value *key){
+    assert(table->type == HASHTABLE_TYPE && isHashableKey(key));
+    HashTable *t = table->h;
+    migrateSome(t, MIGRATE_PER_OPERATION);
+    unsigned int hash = hashKey(key);
+
+    HashEntry *entry = findEntry(t->entries, t->capacity, key, hash);
+    if(entry == NULL && t->oldEntries != NULL){
+        entry = findEntry(t->oldEntries, t->oldCapacity, key, hash);
+    }
+    if(entry == NULL){
+        return false;
+    }
+    entry->deleted = true;
+    entry->value = NULL;
+    t->count--;
+    return true;
+}
+
+// Return a new linked list of the keys in the table, in no particular order.
+Value *hashTableKeys(Value *table){
+    assert(table->type == HASHTABLE_TYPE);
+    HashTable *t = table->h;
+    Value *keys = makeNull();
+    for(int i = 0; i < t->capacity; i++){
+        if(t->entries[i].key != NULL && !t->entries[i].deleted){
+            keys = cons(t->entries[i].key, keys);
+        }
+    }
+    for(int i = t->migrated; i < t->oldCapacity; i++){
+        if(t->oldEntries[i].key != NULL && !t->oldEntries[i].deleted){
+            keys = cons(t->oldEntries[i].key, keys);
+        }
+    }
+    return keys;
+}
+
+#endif
@@ -0,0 +1,26 @@
+#include <stdbool.h>
+#include "value.h"
+
+#ifndef _HASHTABLE
+#define _HASHTABLE
+
+// Create a pointer to a new HASHTABLE_TYPE Value with room for at least
+// capacity keys before its first resize.
+Value *makeHashTable(int capacity);
+
+// Return whether the given value can be used as a hash table key.
+bool isHashableKey(Value *key);
+
+// Return the value bound to key in the table, or NULL if there is none.
+Value *hashTableGet(Value *table, Value *key);
+
+// Bind key to value in the table, replacing any existing binding.
+void hashTableSet(Value *table, Value *key, Value *value);
+
+// Remove key from the table. Returns whether it was present.
+bool hashTableDelete(Value *table, Value *key);
+
+// Return a new linked list of the keys in the table, in no particular order.
+Value *hashTableKeys(Value *table);
+
+#endif
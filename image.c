@@ -0,0 +1,549 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "value.h"
+#include "talloc.h"
+#include "linkedlist.h"
+#include "interpreter.h"
+
+#ifndef _IMAGE
+#define _IMAGE
+
+// Identifies an image file, and the layout of Value it was written with
+#define IMAGE_MAGIC 0x33474d494d435300ULL
+#define IMAGE_ALIGN 16
+
+// The start of an image file. Every pointer inside the image is stored as an
+// offset from the start of the file, and the header is at offset 0, so no
+// object ever has offset 0 and a stored 0 is still NULL. The objects are
+// followed by the relocation table, the offsets of every stored pointer, and
+// then the offsets of every primitive, whose pf slot holds its name.
+typedef struct ImageHeader {
+    uint64_t magic;
+    uint64_t valueSize;
+    uint64_t objectsEnd;
+    uint64_t globalFrame;
+    uint64_t relocationCount;
+    uint64_t primitiveCount;
+} ImageHeader;
+
+// Kinds of object the image walks through
+typedef enum {
+    VALUE_OBJECT, FRAME_OBJECT, STRING_OBJECT, TABLE_OBJECT, ENTRIES_OBJECT,
+    BIGNUM_OBJECT, PROMISE_OBJECT
+} ObjectKind;
+
+// One object found while walking the heap, in the order it will be written
+typedef struct ImageObject {
+    void *address;
+    ObjectKind kind;
+    uint64_t offset;
+    uint64_t size;
+} ImageObject;
+
+// State while saving an image. The address map is an open-addressing table
+// from an object's address to its index in objects.
+typedef struct ImageBuilder {
+    ImageObject *objects;
+    int objectCount;
+    int objectCapacity;
+
+    void **mapKeys;
+    int *mapIndexes;
+    int mapCapacity;
+
+    uint64_t end;
+    bool failed;
+
+    uint64_t *relocations;
+    int relocationCount;
+    int relocationCapacity;
+    uint64_t *primitives;
+    int primitiveCount;
+    int primitiveCapacity;
+
+    // Built-in bindings of a fresh global frame, for naming primitives
+    Frame *builtIns;
+} ImageBuilder;
+
+// Returns the slot for address in the builder's address map
+int mapSlot(ImageBuilder *builder, void *address){
+    uintptr_t hash = (uintptr_t)address;
+    hash ^= hash >> 17;
+    hash *= 0x9e3779b97f4a7c15ULL;
+    int index = (int)(hash >> 32) & (builder->mapCapacity - 1);
+    while(builder->mapKeys[index] != NULL && builder->mapKeys[index] != address){
+        index = (index + 1) & (builder->mapCapacity - 1);
+    }
+    return index;
+}
+
+// Doubles the builder's address map
+void growMap(ImageBuilder *builder){
+    void **oldKeys = builder->mapKeys;
+    int *oldIndexes = builder->mapIndexes;
+    int oldCapacity = builder->mapCapacity;
+    builder->mapCapacity *= 2;
+    builder->mapKeys = calloc(builder->mapCapacity, sizeof(void *));
+    builder->mapIndexes = malloc(sizeof(int) * builder->mapCapacity);
+    for(int i = 0; i < oldCapacity; i++){
+        if(oldKeys[i] != NULL){
+            int slot = mapSlot(builder, oldKeys[i]);
+            builder->mapKeys[slot] = oldKeys[i];
+            builder->mapIndexes[slot] = oldIndexes[i];
+        }
+    }
+    free(oldKeys);
+    free(oldIndexes);
+}
+
+// Returns the image offset of the object at address, or 0 if it has not been
+// found yet
+uint64_t offsetOf(ImageBuilder *builder, void *address){
+    int slot = mapSlot(builder, address);
+    if(builder->mapKeys[slot] == NULL){
+        return 0;
+    }
+    return builder->objects[builder->mapIndexes[slot]].offset;
+}
+
+// Gives the object at address a place in the image, unless it already has
+// one or is NULL
+void addObject(ImageBuilder *builder, void *address, ObjectKind kind, uint64_t size){
+    if(address == NULL){
+        return;
+    }
+    int slot = mapSlot(builder, address);
+    if(builder->mapKeys[slot] != NULL){
+        return;
+    }
+    if(builder->objectCount == builder->objectCapacity){
+        builder->objectCapacity *= 2;
+        builder->objects = realloc(builder->objects,
+            sizeof(ImageObject) * builder->objectCapacity);
+    }
+    ImageObject *object = &builder->objects[builder->objectCount];
+    object->address = address;
+    object->kind = kind;
+    object->offset = builder->end;
+    object->size = size;
+    builder->end += (size + IMAGE_ALIGN - 1) & ~(uint64_t)(IMAGE_ALIGN - 1);
+
+    builder->mapKeys[slot] = address;
+    builder->mapIndexes[slot] = builder->objectCount;
+    builder->objectCount++;
+    if(builder->objectCount * 2 > builder->mapCapacity){
+        growMap(builder);
+    }
+}
+
+// Gives a Value a place in the image; vectors include their element array
+void addValue(ImageBuilder *builder, Value *value){
+    if(value == NULL){
+        return;
+    }
+    uint64_t size = sizeof(Value);
+    if(value->type == VECTOR_TYPE){
+        size += sizeof(Value *) * value->v.size;
+    }
+    if(value->type == F64VECTOR_TYPE || value->type == S64VECTOR_TYPE){
+        size += sizeof(int64_t) * value->nv.size;
+    }
+    addObject(builder, value, VALUE_OBJECT, size);
+}
+
+// Gives a string a place in the image
+void addString(ImageBuilder *builder, char *string){
+    if(string != NULL){
+        addObject(builder, string, STRING_OBJECT, strlen(string) + 1);
+    }
+}
+
+// Gives a hash table slot array a place in the image
+void addEntries(ImageBuilder *builder, HashEntry *entries, int capacity){
+    addObject(builder, entries, ENTRIES_OBJECT, sizeof(HashEntry) * capacity);
+}
+
+// Returns the name a fresh global frame binds the primitive function to, or
+// NULL if it is not a built-in
+char *primitiveName(Frame *builtIns, Value *(*function)(struct Value *)){
+    for(Value *binding = builtIns->bindings; binding->type != NULL_TYPE; binding = cdr(binding)){
+        Value *bound = cdr(car(binding));
+        if(bound->type == PRIMITIVE_TYPE && bound->pf == function){
+            return car(car(binding))->s;
+        }
+    }
+    return NULL;
+}
+
+// Finds every object reachable from the objects found so far. Objects are
+// appended as they are found, so walking the array in order visits each
+// exactly once without recursing down long lists.
+void findObjects(ImageBuilder *builder){
+    for(int i = 0; i < builder->objectCount && !builder->failed; i++){
+        ImageObject object = builder->objects[i];
+        if(object.kind == FRAME_OBJECT){
+            Frame *frame = object.address;
+            addObject(builder, frame->parent, FRAME_OBJECT, sizeof(Frame));
+            addValue(builder, frame->bindings);
+        } else if(object.kind == PROMISE_OBJECT){
+            Promise *promise = object.address;
+            addValue(builder, promise->value);
+            addValue(builder, promise->code);
+            addObject(builder, promise->frame, FRAME_OBJECT, sizeof(Frame));
+        } else if(object.kind == TABLE_OBJECT){
+            HashTable *table = object.address;
+            addEntries(builder, table->entries, table->capacity);
+            addEntries(builder, table->oldEntries, table->oldCapacity);
+        } else if(object.kind == ENTRIES_OBJECT){
+            HashEntry *entries = object.address;
+            int capacity = object.size / sizeof(HashEntry);
+            for(int j = 0; j < capacity; j++){
+                addValue(builder, entries[j].key);
+                addValue(builder, entries[j].value);
+            }
+        } else if(object.kind == VALUE_OBJECT){
+            Value *value = object.address;
+            switch(value->type){
+                case STR_TYPE:
+                    addObject(builder, value->s, STRING_OBJECT, value->length + 1);
+                    break;
+                case SYMBOL_TYPE:
+                    addString(builder, value->s);
+                    break;
+                case CONS_TYPE:
+                    addValue(builder, value->c.car);
+                    addValue(builder, value->c.cdr);
+                    break;
+                case CLOSURE_TYPE:
+                    addValue(builder, value->cl.paramNames);
+                    addValue(builder, value->cl.functionCode);
+                    addObject(builder, value->cl.frame, FRAME_OBJECT, sizeof(Frame));
+                    break;
+                case PRIMITIVE_TYPE: {
+                    char *name = primitiveName(builder->builtIns, value->pf);
+                    if(name == NULL){
+                        fprintf(stderr, "Image error: unknown primitive\n");
+                        builder->failed = true;
+                    }
+                    addString(builder, name);
+                    break;
+                }
+                case VECTOR_TYPE:
+                    for(int j = 0; j < value->v.size; j++){
+                        addValue(builder, value->v.items[j]);
+                    }
+                    break;
+                case HASHTABLE_TYPE:
+                    addObject(builder, value->h, TABLE_OBJECT, sizeof(HashTable));
+                    break;
+                case PROMISE_TYPE:
+                    addObject(builder, value->pr, PROMISE_OBJECT, sizeof(Promise));
+                    break;
+                case ERROR_TYPE:
+                    addString(builder, value->e.message);
+                    break;
+                case BIGNUM_TYPE:
+                    addObject(builder, value->b, BIGNUM_OBJECT,
+                        sizeof(Bignum) + sizeof(uint32_t) * value->b->size);
+                    break;
+                case FUTURE_TYPE:
+                case THREAD_TYPE:
+                case CHANNEL_TYPE:
+                case STRINGPORT_TYPE:
+                    fprintf(stderr, "Image error: futures, threads, channels and string ports cannot be saved\n");
+                    builder->failed = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+// Appends an offset to one of the builder's tables
+void appendOffset(uint64_t **table, int *count, int *capacity, uint64_t offset){
+    if(*count == *capacity){
+        *capacity *= 2;
+        *table = realloc(*table, sizeof(uint64_t) * *capacity);
+    }
+    (*table)[(*count)++] = offset;
+}
+
+// Stores the offset of target into the pointer field at fieldOffset in the
+// image, and records the field for relocation
+void storePointer(ImageBuilder *builder, char *image, uint64_t fieldOffset, void *target){
+    uint64_t targetOffset = 0;
+    if(target != NULL){
+        targetOffset = offsetOf(builder, target);
+        appendOffset(&builder->relocations, &builder->relocationCount,
+            &builder->relocationCapacity, fieldOffset);
+    }
+    memcpy(image + fieldOffset, &targetOffset, sizeof(uint64_t));
+}
+
+// Copies every object into the image with its pointers turned into offsets
+void writeObjects(ImageBuilder *builder, char *image){
+    for(int i = 0; i < builder->objectCount; i++){
+        ImageObject object = builder->objects[i];
+        uint64_t at = object.offset;
+        memcpy(image + at, object.address, object.size);
+        if(object.kind == FRAME_OBJECT){
+            Frame *frame = object.address;
+            storePointer(builder, image, at + offsetof(Frame, parent), frame->parent);
+            storePointer(builder, image, at + offsetof(Frame, bindings), frame->bindings);
+        } else if(object.kind == PROMISE_OBJECT){
+            Promise *promise = object.address;
+            storePointer(builder, image, at + offsetof(Promise, value), promise->value);
+            storePointer(builder, image, at + offsetof(Promise, code), promise->code);
+            storePointer(builder, image, at + offsetof(Promise, frame), promise->frame);
+        } else if(object.kind == TABLE_OBJECT){
+            HashTable *table = object.address;
+            storePointer(builder, image, at + offsetof(HashTable, entries), table->entries);
+            storePointer(builder, image, at + offsetof(HashTable, oldEntries), table->oldEntries);
+        } else if(object.kind == ENTRIES_OBJECT){
+            HashEntry *entries = object.address;
+            int capacity = object.size / sizeof(HashEntry);
+            for(int j = 0; j < capacity; j++){
+                uint64_t entry = at + sizeof(HashEntry) * j;
+                storePointer(builder, image, entry + offsetof(HashEntry, key), entries[j].key);
+                storePointer(builder, image, entry + offsetof(HashEntry, value), entries[j].value);
+            }
+        } else if(object.kind == VALUE_OBJECT){
+            Value *value = object.address;
+            switch(value->type){
+                case STR_TYPE:
+                case SYMBOL_TYPE:
+                    storePointer(builder, image, at + offsetof(Value, s), value->s);
+                    break;
+                case CONS_TYPE:
+                    storePointer(builder, image, at + offsetof(Value, c.car), value->c.car);
+                    storePointer(builder, image, at + offsetof(Value, c.cdr), value->c.cdr);
+                    break;
+                case CLOSURE_TYPE:
+                    storePointer(builder, image, at + offsetof(Value, cl.paramNames), value->cl.paramNames);
+                    storePointer(builder, image, at + offsetof(Value, cl.functionCode), value->cl.functionCode);
+                    storePointer(builder, image, at + offsetof(Value, cl.frame), value->cl.frame);
+                    break;
+                case PRIMITIVE_TYPE:
+                    storePointer(builder, image, at + offsetof(Value, pf),
+                        primitiveName(builder->builtIns, value->pf));
+                    appendOffset(&builder->primitives, &builder->primitiveCount,
+                        &builder->primitiveCapacity, at);
+                    break;
+                case VECTOR_TYPE: {
+                    // The element array follows the Value in the same block
+                    uint64_t items = at + sizeof(Value);
+                    uint64_t relocated = items;
+                    memcpy(image + at + offsetof(Value, v.items), &relocated, sizeof(uint64_t));
+                    appendOffset(&builder->relocations, &builder->relocationCount,
+                        &builder->relocationCapacity, at + offsetof(Value, v.items));
+                    for(int j = 0; j < value->v.size; j++){
+                        storePointer(builder, image, items + sizeof(Value *) * j, value->v.items[j]);
+                    }
+                    break;
+                }
+                case F64VECTOR_TYPE:
+                case S64VECTOR_TYPE: {
+                    // The unboxed elements follow the Value and were copied
+                    // with it, so only the pointer to them moves
+                    uint64_t relocated = at + sizeof(Value);
+                    memcpy(image + at + offsetof(Value, nv.s64), &relocated, sizeof(uint64_t));
+                    appendOffset(&builder->relocations, &builder->relocationCount,
+                        &builder->relocationCapacity, at + offsetof(Value, nv.s64));
+                    break;
+                }
+                case HASHTABLE_TYPE:
+                    storePointer(builder, image, at + offsetof(Value, h), value->h);
+                    break;
+                case PROMISE_TYPE:
+                    storePointer(builder, image, at + offsetof(Value, pr), value->pr);
+                    break;
+                case ERROR_TYPE:
+                    storePointer(builder, image, at + offsetof(Value, e.message), value->e.message);
+                    break;
+                case BIGNUM_TYPE:
+                    storePointer(builder, image, at + offsetof(Value, b), value->b);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+// Frees everything the builder allocated
+void freeBuilder(ImageBuilder *builder){
+    free(builder->objects);
+    free(builder->mapKeys);
+    free(builder->mapIndexes);
+    free(builder->relocations);
+    free(builder->primitives);
+}
+
+// Write everything reachable from globalFrame (bindings, closures and the
+// frames they close over, the lists, strings, vectors, hash tables and
+// promises they hold) to an image file at path. Primitives are stored by
+// name, so an image stays valid across rebuilds of the interpreter. Futures,
+// green threads, channels and string ports cannot be saved. Returns nonzero,
+// after printing why, if the image could not be written.
+int saveImage(char *path, Frame *globalFrame){
+    ImageBuilder builder;
+    builder.objectCapacity = 1024;
+    builder.objects = malloc(sizeof(ImageObject) * builder.objectCapacity);
+    builder.objectCount = 0;
+    builder.mapCapacity = 4096;
+    builder.mapKeys = calloc(builder.mapCapacity, sizeof(void *));
+    builder.mapIndexes = malloc(sizeof(int) * builder.mapCapacity);
+    builder.end = (sizeof(ImageHeader) + IMAGE_ALIGN - 1) & ~(uint64_t)(IMAGE_ALIGN - 1);
+    builder.failed = false;
+    builder.relocationCapacity = 1024;
+    builder.relocations = malloc(sizeof(uint64_t) * builder.relocationCapacity);
+    builder.relocationCount = 0;
+    builder.primitiveCapacity = 256;
+    builder.primitives = malloc(sizeof(uint64_t) * builder.primitiveCapacity);
+    builder.primitiveCount = 0;
+    builder.builtIns = makeGlobalFrame();
+
+    addObject(&builder, globalFrame, FRAME_OBJECT, sizeof(Frame));
+    findObjects(&builder);
+    if(builder.failed){
+        freeBuilder(&builder);
+        return 1;
+    }
+
+    char *image = calloc(builder.end, 1);
+    writeObjects(&builder, image);
+    ImageHeader *header = (ImageHeader *)image;
+    header->magic = IMAGE_MAGIC;
+    header->valueSize = sizeof(Value);
+    header->objectsEnd = builder.end;
+    header->globalFrame = offsetOf(&builder, globalFrame);
+    header->relocationCount = builder.relocationCount;
+    header->primitiveCount = builder.primitiveCount;
+
+    FILE *file = fopen(path, "wb");
+    bool written = file != NULL
+        && fwrite(image, 1, builder.end, file) == builder.end
+        && fwrite(builder.relocations, sizeof(uint64_t), builder.relocationCount, file)
+            == (size_t)builder.relocationCount
+        && fwrite(builder.primitives, sizeof(uint64_t), builder.primitiveCount, file)
+            == (size_t)builder.primitiveCount;
+    if(file != NULL && fclose(file) != 0){
+        written = false;
+    }
+    if(!written){
+        perror("Image error: cannot write image");
+    }
+    free(image);
+    freeBuilder(&builder);
+    return written ? 0 : 1;
+}
+
+// Returns whether size bytes at offset lie among the objects of an image
+// whose objects end at objectsEnd
+bool inImageObjects(uint64_t offset, uint64_t size, uint64_t objectsEnd){
+    return offset >= sizeof(ImageHeader) && offset <= objectsEnd
+        && size <= objectsEnd - offset;
+}
+
+// Map the image file at path into memory and return the global frame saved in
+// it, or NULL, after printing why, if the file is not a usable image. Loading
+// is a single mmap followed by one pass adding the mapping's address to each
+// stored pointer. The mapping is private and writable, so the program can go
+// on to define and set! as usual; it is never unmapped.
+Frame *loadImage(char *path){
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        perror("Image error: cannot open image");
+        return NULL;
+    }
+    struct stat info;
+    if(fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(ImageHeader)){
+        fprintf(stderr, "Image error: %s is not an image\n", path);
+        close(fd);
+        return NULL;
+    }
+    char *image = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(image == MAP_FAILED){
+        perror("Image error: cannot map image");
+        return NULL;
+    }
+
+    ImageHeader *header = (ImageHeader *)image;
+    uint64_t objectsEnd = header->objectsEnd;
+    uint64_t tableSlots = objectsEnd <= (uint64_t)info.st_size
+        ? ((uint64_t)info.st_size - objectsEnd) / sizeof(uint64_t) : 0;
+    if(header->magic != IMAGE_MAGIC || header->valueSize != sizeof(Value)
+            || objectsEnd > (uint64_t)info.st_size
+            || objectsEnd % sizeof(uint64_t) != 0
+            || header->relocationCount > tableSlots
+            || header->primitiveCount != tableSlots - header->relocationCount
+            || (uint64_t)info.st_size - objectsEnd != sizeof(uint64_t) * tableSlots
+            || !inImageObjects(header->globalFrame, sizeof(Frame), objectsEnd)){
+        fprintf(stderr, "Image error: %s is not an image for this interpreter\n", path);
+        munmap(image, info.st_size);
+        return NULL;
+    }
+
+    // Every field listed must lie among the objects and hold an offset that
+    // does too, or a truncated or corrupt file would have loading write, and
+    // the program read, outside the mapping. A field listed twice fails the
+    // second time, since it then holds an address rather than an offset.
+    uint64_t *relocations = (uint64_t *)(image + objectsEnd);
+    for(uint64_t i = 0; i < header->relocationCount; i++){
+        uint64_t field = relocations[i];
+        if(field % sizeof(uint64_t) != 0
+                || !inImageObjects(field, sizeof(uint64_t), objectsEnd)
+                || !inImageObjects(*(uint64_t *)(image + field), 0, objectsEnd)){
+            fprintf(stderr, "Image error: %s is corrupt\n", path);
+            munmap(image, info.st_size);
+            return NULL;
+        }
+        *(uintptr_t *)(image + field) += (uintptr_t)image;
+    }
+
+    uint64_t *primitives = relocations + header->relocationCount;
+    if(header->primitiveCount > 0){
+        Frame *builtIns = makeGlobalFrame();
+        for(uint64_t i = 0; i < header->primitiveCount; i++){
+            Value *primitive = (Value *)(image + primitives[i]);
+            char *name = NULL;
+            if(primitives[i] % sizeof(uint64_t) == 0
+                    && inImageObjects(primitives[i], sizeof(Value), objectsEnd)
+                    && primitive->type == PRIMITIVE_TYPE){
+                name = (char *)primitive->pf;
+            }
+            // The name was relocated with the other pointers, so it is an
+            // address inside the mapping by now
+            if(name == NULL || name < image + sizeof(ImageHeader) || name >= image + objectsEnd
+                    || memchr(name, '\0', image + objectsEnd - name) == NULL){
+                fprintf(stderr, "Image error: %s is corrupt\n", path);
+                munmap(image, info.st_size);
+                return NULL;
+            }
+            primitive->pf = NULL;
+            for(Value *binding = builtIns->bindings; binding->type != NULL_TYPE; binding = cdr(binding)){
+                if(!strcmp(car(car(binding))->s, name)){
+                    primitive->pf = cdr(car(binding))->pf;
+                    break;
+                }
+            }
+            if(primitive->pf == NULL){
+                fprintf(stderr, "Image error: no primitive named %s\n", name);
+                munmap(image, info.st_size);
+                return NULL;
+            }
+        }
+    }
+    return (Frame *)(image + header->globalFrame);
+}
+
+#endif
@@ -0,0 +1,21 @@
+#include "value.h"
+
+#ifndef _IMAGE
+#define _IMAGE
+
+// Write everything reachable from globalFrame (bindings, closures and the
+// frames they close over, the lists, strings, vectors, hash tables and
+// promises they hold) to an image file at path. Primitives are stored by
+// name, so an image stays valid across rebuilds of the interpreter. Futures,
+// green threads, channels and string ports cannot be saved. Returns nonzero,
+// after printing why, if the image could not be written.
+int saveImage(char *path, Frame *globalFrame);
+
+// Map the image file at path into memory and return the global frame saved in
+// it, or NULL, after printing why, if the file is not a usable image. Loading
+// is a single mmap followed by one pass adding the mapping's address to each
+// stored pointer. The mapping is private and writable, so the program can go
+// on to define and set! as usual; it is never unmapped.
+Frame *loadImage(char *path);
+
+#endif
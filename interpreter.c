@@ -4,11 +4,26 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <limits.h>
+#include <setjmp.h>
 #include "talloc.h"
 #include "linkedlist.h"
 #include <ctype.h>
 #include "tokenizer.h"
 #include "parser.h"
+#include "vector.h"
+#include "hashtable.h"
+#include "output.h"
+#include "scheduler.h"
+#include "greenthread.h"
+#include "profiler.h"
+#include "tracer.h"
+#include "error.h"
+#include "bignum.h"
+#include "numvector.h"
+#include "text.h"
+#include "promise.h"
+#include "seal.h"
 #ifndef _INTERPRETER
 #define _INTERPRETER
 
@@ -18,57 +33,238 @@
 void printValue(Value *value){
     switch (value->type)  {
         case NULL_TYPE: {
-            printf("()\n");
+            writeString("()\n");
             break;
         }
         case CONS_TYPE: {
             printTree(value);
             break;
         }
-        case INT_TYPE: {
-            printf("%i\n", value->i);
+        case INT_TYPE:
+        case BIGNUM_TYPE: {
+            writeInteger(value);
+            writeChar('\n');
             break;
         }
         case DOUBLE_TYPE: {
-            printf("%lf\n", value->d);
+            writeDouble(value->d);
+            writeChar('\n');
             break;
         }
         case BOOL_TYPE: {
             if(value->i == 0){
-                printf("#f\n");
+                writeString("#f\n");
             }
             else if(value->i == 1){
-                printf("#t\n");
+                writeString("#t\n");
             }
             break;
         }
         case STR_TYPE:{
-            printf("%s\n", value->s);
+            writeQuotedString(value);
+            writeChar('\n');
             break;
         }
         case SYMBOL_TYPE: {
-            printf("%s\n", value->s);
+            writeString(value->s);
+            writeChar('\n');
             break;
         }  
         case VOID_TYPE: {
-            printf("");
             break;
         }
         case CLOSURE_TYPE: {
-            printf("#<procedure>\n");
+            writeString("#<procedure>\n");
+            break;
+        }
+        case VECTOR_TYPE: {
+            printVector(value);
+            writeChar('\n');
+            break;
+        }
+        case F64VECTOR_TYPE:
+        case S64VECTOR_TYPE: {
+            printNumericVector(value);
+            writeChar('\n');
+            break;
+        }
+        case HASHTABLE_TYPE: {
+            writeString("#<hash-table>\n");
+            break;
+        }
+        case FUTURE_TYPE: {
+            writeString("#<future>\n");
+            break;
+        }
+        case THREAD_TYPE: {
+            writeString("#<thread>\n");
+            break;
+        }
+        case CHANNEL_TYPE: {
+            writeString("#<channel>\n");
+            break;
+        }
+        case ERROR_TYPE: {
+            writeFormat("#<error: %s>\n", value->e.message);
+            break;
+        }
+        case STRINGPORT_TYPE: {
+            writeString("#<string-port>\n");
+            break;
+        }
+        case PROMISE_TYPE: {
+            writeString("#<promise>\n");
             break;
         }
         default:
-            printf("none of the types match");
+            writeString("none of the types match");
     }
 }
 
 //delcare here to use recursively in other functions
 Value *eval(Value *tree, Frame *frame);
 
+// Special forms counted by the evaluator statistics, in formNames order
+typedef enum {
+    IF_FORM, LET_FORM, QUOTE_FORM, DEFINE_FORM, LAMBDA_FORM, AND_FORM,
+    OR_FORM, BEGIN_FORM, LETSTAR_FORM, LETREC_FORM, COND_FORM, SET_FORM,
+    DO_FORM, FUTURE_FORM, GUARD_FORM, DELAY_FORM, DELAY_FORCE_FORM,
+    CONS_STREAM_FORM, FORM_COUNT
+} SpecialForm;
+
+static const char *formNames[FORM_COUNT] = {
+    "if", "let", "quote", "define", "lambda", "and",
+    "or", "begin", "let*", "letrec", "cond", "set!",
+    "do", "future", "guard", "delay", "delay-force",
+    "cons-stream"
+};
+
+// Special forms known never to keep a reference to the frame they are
+// evaluated in, nor to add bindings to it. Loops reuse one frame for every
+// iteration only when their bodies use no other special form, so a form
+// missing here, including any new one, is treated as capturing the frame.
+// let is missing because a named let makes a closure over its frame.
+static const bool frameSafeForms[FORM_COUNT] = {
+    [IF_FORM] = true, [QUOTE_FORM] = true, [AND_FORM] = true,
+    [OR_FORM] = true, [BEGIN_FORM] = true, [LETSTAR_FORM] = true,
+    [LETREC_FORM] = true, [COND_FORM] = true, [SET_FORM] = true,
+    [DO_FORM] = true, [GUARD_FORM] = true
+};
+
+// Counters describing the work the evaluator has done, shown by --stats and
+// runtime-stats. Each thread counts for itself, so they cost a plain
+// increment and interpreter instances and workers never share them.
+typedef struct EvalStats {
+    long forms[FORM_COUNT];
+    long closureCalls;
+    long primitiveCalls;
+    long symbolLookups;
+    // Frames searched by lookUpSymbol, including the one the symbol is in
+    long framesWalked;
+    long depth;
+    long maxDepth;
+} EvalStats;
+
+_Thread_local EvalStats evalStats;
+
+// Limits on the evaluation of each top-level form, see setEvalLimits
+static long stepLimit = LONG_MAX;
+static long heapLimitBytes = -1;
+static long depthLimit = LONG_MAX;
+
+// Evaluations so far in the current top-level form on this thread
+_Thread_local long formSteps = 0;
+// The error handler a limit being exceeded unwinds to on this thread: that of
+// the top-level form being evaluated, or of the green thread running, see
+// applyCatchingLimits. NULL when there is neither.
+_Thread_local ErrorHandler *formHandler = NULL;
+
+// Make handler the one a limit being exceeded unwinds to on this thread, and
+// return the one that was in place. Green threads keep their own this way.
+ErrorHandler *swapFormHandler(ErrorHandler *handler){
+    ErrorHandler *previous = formHandler;
+    formHandler = handler;
+    return previous;
+}
+
+// Raise a value, as raiseValue does. A limit error skips the handlers
+// installed since the form handler, so a program cannot catch its way past
+// a limit.
+void raiseError(Value *raised){
+    if(raised->type == ERROR_TYPE && raised->e.limit && formHandler != NULL){
+        swapErrorHandlers(formHandler);
+    }
+    raiseValue(raised);
+}
+
+// Reports that the current form ran past a limit and abandons it, going on
+// with the next top-level form, or ends the green thread that ran past it.
+void limitExceeded(const char *limit){
+    char message[64];
+    snprintf(message, sizeof(message), "%s limit exceeded", limit);
+    Value *error = makeError(message, false);
+    error->e.limit = true;
+    raiseError(error);
+}
+
+// Called by talloc when the current form allocates past the heap limit
+void heapLimitExceeded(){
+    limitExceeded("heap");
+}
+
+// Limit the evaluation of every top-level form to at most steps calls to
+// eval, heapBytes bytes allocated and depth nested evaluations. A negative
+// value means no limit.
+void setEvalLimits(long steps, long heapBytes, long depth){
+    stepLimit = steps < 0 ? LONG_MAX : steps;
+    heapLimitBytes = heapBytes;
+    depthLimit = depth < 0 ? LONG_MAX : depth;
+}
+
+// Return how much of the limits on the current form this thread has used.
+EvalBudget evalBudget(){
+    EvalBudget budget;
+    budget.steps = formSteps;
+    budget.depth = evalStats.depth;
+    budget.heapBytes = theapLimitLeft();
+    return budget;
+}
+
+// Put budget, from evalBudget, in place of what this thread has used of the
+// limits on the current form, and return what it had used. A task handed to
+// another thread takes the budget of the form that started it, so that it
+// cannot run past what that form had left.
+EvalBudget swapEvalBudget(EvalBudget budget){
+    EvalBudget previous = evalBudget();
+    formSteps = budget.steps;
+    evalStats.depth = budget.depth;
+    tsetHeapLimit(budget.heapBytes, heapLimitExceeded);
+    return previous;
+}
+
+// Deepest evaluation the stack of the running green thread has room for,
+// counted like evalStats.depth. The main program's stack has no such limit.
+_Thread_local long stackDepthLimit = LONG_MAX;
+
+// Make depth the evaluation depth on this thread and limit the deepest it
+// may go before running out of stack, returning the depth that was in
+// place. Green threads keep their own depth this way.
+long swapEvalDepth(long depth, long limit){
+    long previous = evalStats.depth;
+    evalStats.depth = depth;
+    stackDepthLimit = limit;
+    return previous;
+}
+
+
+//returns whether a value counts as false; everything but #f is true
+bool isFalse(Value *value){
+    return value->type == BOOL_TYPE && value->i == 0;
+}
 
 //checks if a symbol is bound
 Value *lookUpSymbol(Value *tree, Frame *frame){
+    evalStats.framesWalked++;
     Value *bindings = frame->bindings;
 
     while(bindings->type != NULL_TYPE){
@@ -81,15 +277,14 @@ Value *lookUpSymbol(Value *tree, Frame *frame){
         return lookUpSymbol(tree, frame->parent);
     } 
     else {
-        printf("Evaluation error: unbound variable\n");
-        texit(1);
+        evaluationError("unbound variable");
     }
     return tree; // to prevent compiler warning about non-void function
 }
 
 
-//evaluates if statements
-Value *evalIf(Value *args, Frame *frame){
+//chooses the branch of an if statement to evaluate, without evaluating it
+Value *selectIfBranch(Value *args, Frame *frame){
     if(car(args)->type != NULL_TYPE){
         Value *evalValue = eval(car(args), frame);
         // checks boolean values
@@ -97,36 +292,45 @@ Value *evalIf(Value *args, Frame *frame){
             int evalBool = evalValue -> i; // get whether it's true or false
             if (evalBool == 1){
                 if(cdr(args)->type != NULL_TYPE){
-                    return eval(car(cdr(args)), frame);
+                    return car(cdr(args));
                 } 
                 else {
-                    printf("Evaluation error: not enough arguments to if statement\n");
-                    texit(1);
+                    evaluationError("not enough arguments to if statement");
                 }
             }
             else if (evalBool == 0){
                 if(cdr(cdr(args))->type != NULL_TYPE){
-                    return eval(car(cdr(cdr(args))), frame);
+                    return car(cdr(cdr(args)));
                 } 
                 else {
-                    printf("Evaluation error: not enough arguments to if statement\n");
-                    texit(1);
+                    evaluationError("not enough arguments to if statement");
                 }
             }
         } 
         else {
-            return eval(car(cdr(args)), frame); // not BOOL_TYPE, so treat as truthy
+            return car(cdr(args)); // not BOOL_TYPE, so treat as truthy
         }
     }
     else {
-        printf("Evaluation error: not enough arguments to if statement\n");
-        texit(1);
+        evaluationError("not enough arguments to if statement");
     }
     return args; // to prevent compiler warning about non-void function
 }
 
+//evaluates if statements
+Value *evalIf(Value *args, Frame *frame){
+    return eval(selectIfBranch(args, frame), frame);
+}
+
+//declare here to use in evalLet
+Value *evalNamedLet(Value *args, Frame *frame);
+
 //evaluates let statements
 Value *evalLet(Value *args, Frame *frame){
+    if(args->type != NULL_TYPE && car(args)->type == SYMBOL_TYPE){
+        return evalNamedLet(args, frame);
+    }
+
     Frame *f = talloc(sizeof(Frame));
     f -> parent = frame;
     f -> bindings = makeNull();
@@ -145,26 +349,22 @@ Value *evalLet(Value *args, Frame *frame){
 
     //if the list isn't a list of lists or null throw an error
     if(list->type != CONS_TYPE && list->type != NULL_TYPE){
-        printf("Evaluation error: bad form in let\n");
-        texit(1);  
+        evaluationError("bad form in let");
     }
 
     //if there is a null binding throw an error
     if((list->type == CONS_TYPE) && (car(list)->type == NULL_TYPE)){
-        printf("Evaluation error: null binding in let\n");
-        texit(1);
+        evaluationError("null binding in let");
     }
 
     //if there is no body throw an error
     if(body->type == NULL_TYPE){
-        printf("Evaluation error: no args following the bindings in let\n");
-        texit(1);
+        evaluationError("no args following the bindings in let");
     }
 
     //if there is not a list of lists throw an error
     if(car(list)->type != CONS_TYPE){
-        printf("Evaluation error: bad form in let\n");
-        texit(1); 
+        evaluationError("bad form in let");
     }
 
 
@@ -176,8 +376,7 @@ Value *evalLet(Value *args, Frame *frame){
 
         // if the first thing isn't a symbol throw an error
         if(var_i->type != SYMBOL_TYPE){
-            printf("Evaluation error: first argument of each sublist must be a symbol\n");
-            texit(1);
+            evaluationError("first argument of each sublist must be a symbol");
         }
 
         Value *val_i = eval(car(cdr(sublist)), frame);
@@ -186,8 +385,7 @@ Value *evalLet(Value *args, Frame *frame){
         //iterate through bindings to find potential duplicates
         while(bindings->type != NULL_TYPE){
             if(!strcmp(car(car(bindings))->s, var_i->s)){
-                printf("Evaluation error: duplicate variable in let\n");
-                texit(1);
+                evaluationError("duplicate variable in let");
             }
             bindings = cdr(bindings);
         }
@@ -206,12 +404,10 @@ Value *evalLet(Value *args, Frame *frame){
 //evaluates quote statements
 Value *evalQuote(Value *args){
     if(args->type == NULL_TYPE){
-        printf("Evaluation error: no arguments to quote\n");
-        texit(1);
+        evaluationError("no arguments to quote");
     }
     if(cdr(args)->type != NULL_TYPE){
-        printf("Evaluation error: multiple arguments to quote\n");
-        texit(1);
+        evaluationError("multiple arguments to quote");
     }
     return args;
 }
@@ -235,30 +431,26 @@ Value *evalLetStar(Value *args, Frame *frame){
 
     //if the list isn't a list of lists or null throw an error
     if(list->type != CONS_TYPE && list->type != NULL_TYPE){
-        printf("Evaluation error: bad form in let\n");
-        texit(1);  
+        evaluationError("bad form in let");
     }
 
     //if there is a null binding throw an error
     if((list->type == CONS_TYPE) && (car(list)->type == NULL_TYPE)){
-        printf("Evaluation error: null binding in let\n");
-        texit(1);
+        evaluationError("null binding in let");
     }
 
     //if there is no body throw an error
     if(body->type == NULL_TYPE){
-        printf("Evaluation error: no args following the bindings in let\n");
-        texit(1);
+        evaluationError("no args following the bindings in let");
     }
 
     //if there is not a list of lists throw an error
     if(car(list)->type != CONS_TYPE){
-        printf("Evaluation error: bad form in let\n");
-        texit(1); 
+        evaluationError("bad form in let");
     }
 
     Frame *parent = frame;
-    Frame *f;
+    Frame *f = frame;
 
     //iterate through the list of lists
     while (list->type != NULL_TYPE){
@@ -272,14 +464,12 @@ Value *evalLetStar(Value *args, Frame *frame){
 
         // if the first thing isn't a symbol throw an error
         if(var_i->type != SYMBOL_TYPE){
-            printf("Evaluation error: first argument of each sublist must be a symbol\n");
-            texit(1);
+            evaluationError("first argument of each sublist must be a symbol");
         }
 
 
         Value *val_i = eval(car(cdr(sublist)), parent);
 
-        Value *bindings = f->bindings;
         f->bindings = cons(cons(var_i, val_i), f->bindings);
         list = cdr(list);
         parent = f;
@@ -317,8 +507,7 @@ Value *evalLetRec(Value *args, Frame *frame){
 
     while(unspecifiedList->type != NULL_TYPE){
         if(eval(car(cdr(car(unspecifiedList))), env2)->type == UNSPECIFIED_TYPE){
-            printf("Evaluation error: bindings not created yet\n");
-            texit(1);
+            evaluationError("bindings not created yet");
         }
         unspecifiedList = cdr(unspecifiedList);
     }
@@ -339,26 +528,22 @@ Value *evalLetRec(Value *args, Frame *frame){
 
     //if the list isn't a list of lists or null throw an error
     if(list->type != CONS_TYPE && list->type != NULL_TYPE){
-        printf("Evaluation error: bad form in let\n");
-        texit(1);  
+        evaluationError("bad form in let");
     }
 
     //if there is a null binding throw an error
     if((list->type == CONS_TYPE) && (car(list)->type == NULL_TYPE)){
-        printf("Evaluation error: null binding in let\n");
-        texit(1);
+        evaluationError("null binding in let");
     }
 
     //if there is no body throw an error
     if(body->type == NULL_TYPE){
-        printf("Evaluation error: no args following the bindings in let\n");
-        texit(1);
+        evaluationError("no args following the bindings in let");
     }
 
     //if there is not a list of lists throw an error
     if(car(list)->type != CONS_TYPE){
-        printf("Evaluation error: bad form in let\n");
-        texit(1); 
+        evaluationError("bad form in let");
     }
 
 
@@ -370,8 +555,7 @@ Value *evalLetRec(Value *args, Frame *frame){
 
         // if the first thing isn't a symbol throw an error
         if(var_i->type != SYMBOL_TYPE){
-            printf("Evaluation error: first argument of each sublist must be a symbol\n");
-            texit(1);
+            evaluationError("first argument of each sublist must be a symbol");
         }
 
         Value *val_i = eval(car(cdr(sublist)), env2);
@@ -380,8 +564,7 @@ Value *evalLetRec(Value *args, Frame *frame){
         //iterate through bindings to find potential duplicates
         while(bindings->type != NULL_TYPE){
             if(!strcmp(car(car(bindings))->s, var_i->s)){
-                printf("Evaluation error: duplicate variable in let\n");
-                texit(1);
+                evaluationError("duplicate variable in let");
             }
             bindings = cdr(bindings);
         }
@@ -398,27 +581,36 @@ Value *evalLetRec(Value *args, Frame *frame){
 }
 
 
-// evaluates cond
-Value *evalCond(Value *args, Frame *frame){
+// chooses the expression of the first cond clause that applies, without
+// evaluating it. Returns NULL if no clause applies
+Value *selectCondClause(Value *args, Frame *frame){
     while(args->type != NULL_TYPE){
         if(car(car(args))->type == SYMBOL_TYPE){
             if(!strcmp(car(car(args))->s, "else")){
-                return eval(car(cdr(car(args))), frame);
+                return car(cdr(car(args)));
             } else {
-                printf("Evaluation error: unrecognized symbol in cond\n");
-                texit(1);
+                evaluationError("unrecognized symbol in cond");
             }
         }
 
         Value *evalCarCar = eval(car(car(args)), frame);
         if(evalCarCar->type == BOOL_TYPE){
             if(evalCarCar->i == 1){
-                return eval(car(cdr(car(args))), frame);
+                return car(cdr(car(args)));
             }
         }
         
         args = cdr(args);
     }
+    return NULL;
+}
+
+// evaluates cond
+Value *evalCond(Value *args, Frame *frame){
+    Value *clause = selectCondClause(args, frame);
+    if(clause != NULL){
+        return eval(clause, frame);
+    }
     Value *nothingTrue = talloc(sizeof(Value));
     nothingTrue->type = VOID_TYPE;
     return nothingTrue;
@@ -428,63 +620,53 @@ Value *evalCond(Value *args, Frame *frame){
 //evaluates expressions
 Value *evalDefine(Value *args, Frame *frame){
     if(args->type == NULL_TYPE){
-        printf("Evaluation error: no args following define\n");
-        texit(1);
+        evaluationError("no args following define");
     }
     if(cdr(args)->type == NULL_TYPE){
-        printf("Evaluation error: no value following the symbol in define\n");
-        texit(1);
+        evaluationError("no value following the symbol in define");
     }
     if(car(args)->type != SYMBOL_TYPE){
-        printf("Evaluation error: define must bind to a symbol\n");
-        texit(1);
+        evaluationError("define must bind to a symbol");
     }
-    frame->bindings = cons(cons(car(args), eval(car(cdr(args)), frame)), frame->bindings);
+    Value *value = eval(car(cdr(args)), frame);
+    if(value->type == CLOSURE_TYPE){
+        profileName(value, car(args)->s);
+    }
+    frame->bindings = cons(cons(car(args), value), frame->bindings);
     Value *voidNode = makeNull();
     voidNode->type = VOID_TYPE;
     return voidNode;
 }
 
-//evaluates set expressions
+//evaluates set expressions. The binding is updated in place, so anything
+//holding on to the frame sees the new value
 Value *evalSet(Value *args, Frame *frame, Frame *originalFrame){
     if(args->type == NULL_TYPE){
-        printf("Evaluation error: no args following set!\n");
-        texit(1);
+        evaluationError("no args following set!");
     }
     if(cdr(args)->type == NULL_TYPE){
-        printf("Evaluation error: no value following the symbol in define\n");
-        texit(1);
+        evaluationError("no value following the symbol in define");
     }
     if(car(args)->type != SYMBOL_TYPE){
-        printf("Evaluation error: define must bind to a symbol\n");
-        texit(1);
+        evaluationError("define must bind to a symbol");
     }
-    bool varFound = false;
-    Value *bindings = frame->bindings;
-    Value *newBindings = makeNull();
     Value *newVal = eval(car(cdr(args)), originalFrame);
-    while(bindings->type != NULL_TYPE){
-        if(!strcmp(car(args)->s, car(car(bindings))->s)){
-            newBindings = cons(cons(car(args), newVal), newBindings);
-            varFound = true;
-        } else {
-            newBindings = cons(cons(car(car(bindings)), cdr(car(bindings))), newBindings);
-        }
-        bindings = cdr(bindings);
-    }
-    if(varFound){
-        frame->bindings = newBindings;
-    } else {
-        if(frame->parent == NULL){
-            printf("Evaluation error: variable not defined before set! statement\n");
-            texit(1);
-        } else {
-            return evalSet(args, frame->parent, originalFrame);
+    while(frame != NULL){
+        Value *bindings = frame->bindings;
+        while(bindings->type != NULL_TYPE){
+            if(!strcmp(car(args)->s, car(car(bindings))->s)){
+                checkUnsealed(frame, "set! a variable defined");
+                car(bindings)->c.cdr = newVal;
+                Value *voidNode = makeNull();
+                voidNode->type = VOID_TYPE;
+                return voidNode;
+            }
+            bindings = cdr(bindings);
         }
+        frame = frame->parent;
     }
-    Value *voidNode = makeNull();
-    voidNode->type = VOID_TYPE;
-    return voidNode;
+    evaluationError("variable not defined before set! statement");
+    return args; // to prevent compiler warning about non-void function
 }
 
 //checks if a list of symbols contains a target symbol
@@ -501,8 +683,7 @@ bool contains(Value *list, Value *target){
 //evaluate define expressions
 Value *evalLambda(Value *args, Frame *frame){
     if(args->type == NULL_TYPE){
-        printf("Evaluation error: no args following lambda\n");
-        texit(1);
+        evaluationError("no args following lambda");
     }
     Value *closureValue = talloc(sizeof(Value));
     closureValue->type = CLOSURE_TYPE;
@@ -512,12 +693,10 @@ Value *evalLambda(Value *args, Frame *frame){
     Value *targets = car(args);
     while(targets->type != NULL_TYPE){
         if(car(targets)->type != SYMBOL_TYPE){
-            printf("Evaluation error: formal parameters for lambda must be symbols\n");
-            texit(1);
+            evaluationError("formal parameters for lambda must be symbols");
         }
         if(contains(nonDuplicateParams, car(targets))){
-            printf("Evaluation error: duplicate identifier in lambda\n");
-            texit(1);
+            evaluationError("duplicate identifier in lambda");
         }
         nonDuplicateParams = cons(car(targets), nonDuplicateParams);
         targets = cdr(targets);
@@ -526,8 +705,7 @@ Value *evalLambda(Value *args, Frame *frame){
     closureValue->cl.paramNames = car(args);
 
     if(cdr(args)->type == NULL_TYPE){
-        printf("Evaluation error: no function code\n");
-        texit(1);
+        evaluationError("no function code");
     }
     closureValue->cl.functionCode = car(cdr(args));
 
@@ -574,21 +752,316 @@ Value *evalOr(Value *args, Frame *frame){
     return orReturn;
 }
 
+// evaluates all but the last expression of a begin statement and returns
+// the last one, without evaluating it. Returns NULL for an empty begin
+Value *selectBeginLast(Value *args, Frame *frame){
+    if(args->type == NULL_TYPE){
+        return NULL;
+    }
+    while(cdr(args)->type != NULL_TYPE){
+        eval(car(args), frame);
+        args = cdr(args);
+    }
+    return car(args);
+}
+
 // evaluates begin statements
 Value *evalBegin(Value *args, Frame *frame){
-    Value *beginReturn = talloc(sizeof(Value));
-    if(args->type == NULL_TYPE){
+    Value *last = selectBeginLast(args, frame);
+    if(last == NULL){
+        Value *beginReturn = talloc(sizeof(Value));
         beginReturn->type = VOID_TYPE;
         return beginReturn;
     }
-    Value *evalCar = talloc(sizeof(Value));
-    while(args->type != NULL_TYPE){
-        evalCar = eval(car(args), frame);
-        args = cdr(args);
+    return eval(last, frame);
+}
+
+//returns whether evaluating the given code could keep a reference to the
+//frame it runs in or add bindings to it: whether it names any special form
+//not in frameSafeForms. Loops whose bodies cannot can reuse one frame for
+//every iteration
+bool capturesFrame(Value *code){
+    while(code->type == CONS_TYPE){
+        if(capturesFrame(car(code))){
+            return true;
+        }
+        code = cdr(code);
+    }
+    if(code->type == SYMBOL_TYPE){
+        for(int i = 0; i < FORM_COUNT; i++){
+            if(!strcmp(code->s, formNames[i])){
+                return !frameSafeForms[i];
+            }
+        }
+    }
+    return false;
+}
+
+//binds each variable to the matching value, either in a new frame or, when
+//the loop body cannot capture the frame, by overwriting the bindings made in
+//the previous iteration. slots holds the binding pairs between iterations
+Frame *bindLoopVariables(Frame *frame, Frame *parent, Value *variables, Value **values, Value **slots, bool fresh){
+    int i = 0;
+    if(frame == NULL || fresh){
+        frame = talloc(sizeof(Frame));
+        frame->parent = parent;
+        frame->bindings = makeNull();
+        while(variables->type != NULL_TYPE){
+            slots[i] = cons(car(variables), values[i]);
+            frame->bindings = cons(slots[i], frame->bindings);
+            variables = cdr(variables);
+            i++;
+        }
+    } else {
+        while(variables->type != NULL_TYPE){
+            slots[i]->c.cdr = values[i];
+            variables = cdr(variables);
+            i++;
+        }
+    }
+    return frame;
+}
+
+//evaluates the body of a named let in tail position, following if, cond and
+//begin. A call to the loop itself found there is not applied: its arguments
+//are stored in values and NULL is returned, so the caller runs the next
+//iteration instead of growing the stack
+Value *evalLoopTail(Value *expr, Frame *frame, Value *name, Value *loop, Value **values, int count){
+    while(expr->type == CONS_TYPE && car(expr)->type == SYMBOL_TYPE){
+        Value *first = car(expr);
+        Value *args = cdr(expr);
+        if(!strcmp(first->s, "if")){
+            expr = selectIfBranch(args, frame);
+        }
+        else if(!strcmp(first->s, "cond")){
+            expr = selectCondClause(args, frame);
+        }
+        else if(!strcmp(first->s, "begin")){
+            expr = selectBeginLast(args, frame);
+        }
+        else if(!strcmp(first->s, name->s) && lookUpSymbol(first, frame) == loop){
+            int i = 0;
+            while(args->type != NULL_TYPE && i < count){
+                values[i] = eval(car(args), frame);
+                args = cdr(args);
+                i++;
+            }
+            if(i != count || args->type != NULL_TYPE){
+                evaluationError("wrong number of arguments to named let");
+            }
+            return NULL;
+        }
+        else {
+            break;
+        }
+        if(expr == NULL){
+            Value *voidNode = talloc(sizeof(Value));
+            voidNode->type = VOID_TYPE;
+            return voidNode;
+        }
+    }
+    return eval(expr, frame);
+}
+
+//evaluates named let statements as a loop. The name is bound to a real
+//closure, so calls that are not in tail position still recurse as usual
+Value *evalNamedLet(Value *args, Frame *frame){
+    Value *name = car(args);
+    if(cdr(args)->type == NULL_TYPE || cdr(cdr(args))->type == NULL_TYPE){
+        evaluationError("bad form in named let");
     }
-    return evalCar;
+    Value *list = car(cdr(args));
+    Value *body = cdr(cdr(args));
+    if(list->type != CONS_TYPE && list->type != NULL_TYPE){
+        evaluationError("bad form in named let");
+    }
+
+    int count = length(list);
+    Value **values = talloc(sizeof(Value *) * count);
+    Value **slots = talloc(sizeof(Value *) * count);
+    Value *variables = makeNull();
+    int i = 0;
+    while(list->type != NULL_TYPE){
+        Value *sublist = car(list);
+        if(sublist->type != CONS_TYPE || car(sublist)->type != SYMBOL_TYPE ||
+            cdr(sublist)->type == NULL_TYPE){
+            evaluationError("bad form in named let");
+        }
+        if(contains(variables, car(sublist))){
+            evaluationError("duplicate variable in let");
+        }
+        variables = cons(car(sublist), variables);
+        values[i] = eval(car(cdr(sublist)), frame);
+        list = cdr(list);
+        i++;
+    }
+    variables = reverse(variables);
+
+    Frame *loopFrame = talloc(sizeof(Frame));
+    loopFrame->parent = frame;
+    loopFrame->bindings = makeNull();
+
+    Value *loop = talloc(sizeof(Value));
+    loop->type = CLOSURE_TYPE;
+    loop->cl.paramNames = variables;
+    if(cdr(body)->type == NULL_TYPE){
+        loop->cl.functionCode = car(body);
+    } else {
+        Value *beginSymbol = talloc(sizeof(Value));
+        beginSymbol->type = SYMBOL_TYPE;
+        beginSymbol->s = "begin";
+        loop->cl.functionCode = cons(beginSymbol, body);
+    }
+    loop->cl.frame = loopFrame;
+    loopFrame->bindings = cons(cons(name, loop), loopFrame->bindings);
+
+    bool fresh = capturesFrame(body);
+    Frame *f = NULL;
+    while(true){
+        f = bindLoopVariables(f, loopFrame, variables, values, slots, fresh);
+        Value *result = evalLoopTail(loop->cl.functionCode, f, name, loop, values, count);
+        if(result != NULL){
+            return result;
+        }
+    }
+}
+
+//evaluates do loops: (do ((var init step) ...) (test result ...) body ...)
+Value *evalDo(Value *args, Frame *frame){
+    if(args->type == NULL_TYPE || cdr(args)->type == NULL_TYPE){
+        evaluationError("bad form in do");
+    }
+    Value *list = car(args);
+    Value *testClause = car(cdr(args));
+    Value *body = cdr(cdr(args));
+    if((list->type != CONS_TYPE && list->type != NULL_TYPE) || testClause->type != CONS_TYPE){
+        evaluationError("bad form in do");
+    }
+
+    int count = length(list);
+    Value **values = talloc(sizeof(Value *) * count);
+    Value **steps = talloc(sizeof(Value *) * count);
+    Value **slots = talloc(sizeof(Value *) * count);
+    Value *variables = makeNull();
+    int i = 0;
+    while(list->type != NULL_TYPE){
+        Value *spec = car(list);
+        if(spec->type != CONS_TYPE || car(spec)->type != SYMBOL_TYPE ||
+            cdr(spec)->type == NULL_TYPE){
+            evaluationError("bad form in do");
+        }
+        if(contains(variables, car(spec))){
+            evaluationError("duplicate variable in do");
+        }
+        variables = cons(car(spec), variables);
+        values[i] = eval(car(cdr(spec)), frame);
+        if(cdr(cdr(spec))->type != NULL_TYPE){
+            steps[i] = car(cdr(cdr(spec)));
+        } else {
+            steps[i] = NULL;
+        }
+        list = cdr(list);
+        i++;
+    }
+    variables = reverse(variables);
+
+    bool fresh = capturesFrame(cdr(args));
+    Frame *f = NULL;
+    while(true){
+        f = bindLoopVariables(f, frame, variables, values, slots, fresh);
+        if(!isFalse(eval(car(testClause), f))){
+            Value *last = selectBeginLast(cdr(testClause), f);
+            if(last == NULL){
+                Value *voidNode = talloc(sizeof(Value));
+                voidNode->type = VOID_TYPE;
+                return voidNode;
+            }
+            return eval(last, f);
+        }
+        Value *current = body;
+        while(current->type != NULL_TYPE){
+            eval(car(current), f);
+            current = cdr(current);
+        }
+        // all steps are computed before any variable changes
+        for(i = 0; i < count; i++){
+            if(steps[i] != NULL){
+                values[i] = eval(steps[i], f);
+            } else {
+                values[i] = cdr(slots[i]);
+            }
+        }
+    }
+}
+
+
+//evaluates future expressions, starting the expression on the worker pool
+Value *evalFuture(Value *args, Frame *frame){
+    if(args->type == NULL_TYPE || cdr(args)->type != NULL_TYPE){
+        evaluationError("future takes exactly one expression");
+    }
+    Value *thunk = talloc(sizeof(Value));
+    thunk->type = CLOSURE_TYPE;
+    thunk->cl.paramNames = makeNull();
+    thunk->cl.functionCode = car(args);
+    thunk->cl.frame = frame;
+    return makeFuture(thunk);
+}
+
+//evaluates guard, (guard (var clause ...) body ...). The body is evaluated
+//as with begin; if it raises a value, the value is bound to var and the
+//clauses are tried as with cond. When no clause applies the value is raised
+//again
+Value *evalGuard(Value *args, Frame *frame){
+    if(args->type == NULL_TYPE || car(args)->type != CONS_TYPE ||
+        car(car(args))->type != SYMBOL_TYPE){
+        evaluationError("bad form in guard");
+    }
+    long depth = evalStats.depth;
+    int profileDepth = profileStackDepth();
+    ErrorHandler handler;
+    pushErrorHandler(&handler);
+    if(setjmp(handler.jump) == 0){
+        Value *result = evalBegin(cdr(args), frame);
+        popErrorHandler(&handler);
+        return result;
+    }
+    evalStats.depth = depth;
+    profileUnwindStack(profileDepth);
+
+    Frame *guardFrame = talloc(sizeof(Frame));
+    guardFrame->parent = frame;
+    guardFrame->bindings = cons(cons(car(car(args)), handler.raised), makeNull());
+    Value *clause = selectCondClause(cdr(car(args)), guardFrame);
+    if(clause == NULL){
+        raiseValue(handler.raised);
+    }
+    return eval(clause, guardFrame);
+}
+
+//evaluates delay and delay-force, returning a promise for the expression
+//without evaluating it
+Value *evalDelay(Value *args, Frame *frame, bool chained, char *name){
+    if(args->type == NULL_TYPE || cdr(args)->type != NULL_TYPE){
+        evaluationError("%s takes exactly one expression", name);
+    }
+    return makePromise(car(args), frame, chained);
 }
 
+//declare here to use in evalConsStream
+Value *wrapList(Value *list);
+Value *dottedPair(Value *first, Value *second);
+
+//evaluates cons-stream, (cons-stream a b): a pair of the value of a and a
+//promise for b, built the way cons builds a pair whose cdr is not a list
+Value *evalConsStream(Value *args, Frame *frame){
+    if(args->type == NULL_TYPE || cdr(args)->type == NULL_TYPE ||
+        cdr(cdr(args))->type != NULL_TYPE){
+        evaluationError("cons-stream takes exactly two expressions");
+    }
+    Value *head = eval(car(args), frame);
+    return wrapList(dottedPair(head, makePromise(car(cdr(args)), frame, false)));
+}
 
 //applies a function to given arguments
 Value *apply(Value *function, Value *args){
@@ -606,14 +1079,20 @@ Value *apply(Value *function, Value *args){
             params = cdr(params);
         }
 
-        return eval(function->cl.functionCode, functionFrame);
+        evalStats.closureCalls++;
+        long long spanStart = traceBegin();
+        profileEnter(function);
+        Value *result = eval(function->cl.functionCode, functionFrame);
+        profileLeave();
+        traceApplication(function, spanStart);
+        return result;
     }
     else if(function->type == PRIMITIVE_TYPE){
+        evalStats.primitiveCalls++;
         return (*function->pf)(args);
     }
     else{
-        printf("Evaluation error: function is not a primitive or closure type");
-        texit(1);
+        evaluationError("function is not a primitive or closure type");
     }
     return args; //not possible to reach, simply here to avoid warning
 }
@@ -628,15 +1107,46 @@ Value *evalEach(Value *args, Frame *frame){
     return reverse(evalArgs);
 }
 
+//returns the linked list held by a list value. Quoted lists and the results
+//of cons come wrapped in one extra cons cell, lists taken out of another
+//list do not
+Value *unwrapList(Value *list){
+    if(list->type == CONS_TYPE && cdr(list)->type == NULL_TYPE &&
+        (car(list)->type == CONS_TYPE || car(list)->type == NULL_TYPE)){
+        return car(list);
+    }
+    return list;
+}
+
+//wraps a linked list so it is handed back to scheme code as a list value
+Value *wrapList(Value *list){
+    return cons(list, makeNull());
+}
+
+//returns an element taken out of a linked list, wrapping nested lists so
+//they behave like any other list value
+Value *listElement(Value *item){
+    if(item->type == CONS_TYPE || item->type == NULL_TYPE){
+        return wrapList(item);
+    }
+    return item;
+}
+
+//returns the linked list that represents the dotted pair (first . second):
+//the two values with a DOT_TYPE marker between them
+Value *dottedPair(Value *first, Value *second){
+    Value *dotVal = talloc(sizeof(Value));
+    dotVal->type = DOT_TYPE;
+    return cons(first, cons(dotVal, cons(second, makeNull())));
+}
+
 //evaluates built in car
 Value *builtInCar(Value *args) {
     if(car(args)->type != CONS_TYPE){
-        printf("Evaluation error: car must take in a list in the first argument\n");
-        texit(1);
+        evaluationError("car must take in a list in the first argument");
     }
     if(cdr(args)->type != NULL_TYPE){
-        printf("Evaluation error: too many arguments\n");
-        texit(1);
+        evaluationError("too many arguments");
     }
     //Three cars to get the original car
     return car(car(car(args)));
@@ -646,8 +1156,7 @@ Value *builtInCar(Value *args) {
 Value *builtInCdr(Value *args) {
 
     if(args->type == NULL_TYPE){
-        printf("Evaluation error: no arguments to cdr\n");
-        texit(1);
+        evaluationError("no arguments to cdr");
     }
 
     // if we have the cdr of a dotted list, take what is after the dot
@@ -655,12 +1164,8 @@ Value *builtInCdr(Value *args) {
         if(car(args)->type != NULL_TYPE){
             if(car(car(args))->type != NULL_TYPE){
                 if(cdr(car(car(args)))->type != NULL_TYPE){
-                    if(car(cdr(car(car(args))))->type != NULL_TYPE){
-                        if(car(cdr(car(car(args))))->type == STR_TYPE){
-                            if(!strcmp(car(cdr(car(car(args))))->s, ".")){
-                                return cdr(cdr(car(car(args))));
-                            }
-                        }
+                    if(car(cdr(car(car(args))))->type == DOT_TYPE){
+                        return cdr(cdr(car(car(args))));
                     }
                 }
             }
@@ -675,12 +1180,10 @@ Value *builtInCdr(Value *args) {
 Value *builtInNull(Value *args) {
 
     if(args->type == NULL_TYPE){
-        printf("Evaluation error: no arguments to null?\n");
-        texit(1);
+        evaluationError("no arguments to null?");
     }
     if(cdr(args)->type != NULL_TYPE){
-        printf("Evaluation error: too many arguments to null?\n");
-        texit(1);
+        evaluationError("too many arguments to null?");
     }
     Value *nullVal = talloc(sizeof(Value));
     nullVal->type = BOOL_TYPE;
@@ -696,11 +1199,44 @@ Value *builtInNull(Value *args) {
     return nullVal;
 }
 
+//returns whether a value is an integer, whether a fixnum or a bignum
+bool isIntegerValue(Value *value){
+    return value->type == INT_TYPE || value->type == BIGNUM_TYPE;
+}
+
+//returns whether a value is a number
+bool isNumberValue(Value *value){
+    return value->type == INT_TYPE || value->type == DOUBLE_TYPE || value->type == BIGNUM_TYPE;
+}
+
+//returns a number as a double
+double numberToDouble(Value *value){
+    if(value->type == DOUBLE_TYPE){
+        return value->d;
+    }
+    return integerToDouble(value);
+}
+
+//adds up the rest of the arguments to + once the running sum has left the
+//fixnum range or a bignum turns up
+Value *addBignums(int64_t partialSum, Value *args){
+    Value *sum = talloc(sizeof(Value));
+    sum->type = INT_TYPE;
+    sum->i = partialSum;
+    while(args->type != NULL_TYPE){
+        if(!isIntegerValue(car(args))){
+            evaluationError("cannot add non int or double types");
+        }
+        sum = integerAdd(sum, car(args));
+        args = cdr(args);
+    }
+    return sum;
+}
+
 //evaluates built in add
 Value *builtInAdd(Value *args) {
     Value *tempArgs = args;
     bool doubleFound = false;
-    Value *addReturn = talloc(sizeof(Value));
 
     while(tempArgs->type != NULL_TYPE){
         if(car(tempArgs)->type == DOUBLE_TYPE){
@@ -710,33 +1246,29 @@ Value *builtInAdd(Value *args) {
         tempArgs = cdr(tempArgs);
     }
 
+    Value *addReturn = talloc(sizeof(Value));
     if(doubleFound){
         double doubleSum = 0;
         while(args->type != NULL_TYPE){
-            if(car(args)->type == INT_TYPE){
-                doubleSum += car(args)->i;
-            }
-            else if(car(args)->type == DOUBLE_TYPE){
-                doubleSum += car(args)->d;
+            if(isNumberValue(car(args))){
+                doubleSum += numberToDouble(car(args));
             }
             else{
-                printf("Evaluation error: cannot add non int or double types\n");
-                texit(1);
+                evaluationError("cannot add non int or double types");
             }
             args = cdr(args);
         }
         addReturn->type = DOUBLE_TYPE;
         addReturn->d = doubleSum;
     } else {
-        int intSum = 0;
+        int64_t intSum = 0;
         while(args->type != NULL_TYPE){
-            if(car(args)->type == INT_TYPE){
-                intSum += car(args)->i;
-            }
-            else{
-                printf("Evaluation error: cannot add non int or double types\n");
-                texit(1);
+            Value *addend = car(args);
+            int64_t nextSum;
+            if(addend->type != INT_TYPE || __builtin_add_overflow(intSum, addend->i, &nextSum)){
+                return addBignums(intSum, args);
             }
+            intSum = nextSum;
             args = cdr(args);
         }
         addReturn->type = INT_TYPE;
@@ -750,35 +1282,27 @@ Value *builtInMinus(Value *args) {
 
     if(args->type == NULL_TYPE || car(args)->type == NULL_TYPE || 
         cdr(args)->type == NULL_TYPE || cdr(cdr(args))->type != NULL_TYPE){
-        printf("Evaluation error: wrong number of arguments to minus\n");
-        texit(1);
+        evaluationError("wrong number of arguments to minus");
     }
 
-    if(car(args)->type != DOUBLE_TYPE && car(args)->type != INT_TYPE){
-        printf("Evaluation error: first argument is not an int or double\n");
-        texit(1);
+    Value *first = car(args);
+    Value *second = car(cdr(args));
+    if(!isNumberValue(first)){
+        evaluationError("first argument is not an int or double");
     }
-    if(car(cdr(args))->type != DOUBLE_TYPE && car(cdr(args))->type != INT_TYPE){
-        printf("Evaluation error: second argument is not an int or double\n");
-        texit(1);
+    if(!isNumberValue(second)){
+        evaluationError("second argument is not an int or double");
     }
 
     Value *minusReturn = talloc(sizeof(Value));
-    if(car(args)->type == DOUBLE_TYPE || car(cdr(args))->type == DOUBLE_TYPE){
+    if(first->type == DOUBLE_TYPE || second->type == DOUBLE_TYPE){
         minusReturn->type = DOUBLE_TYPE;
-        double minusReturnDouble = 0;
-        if(car(args)->type == DOUBLE_TYPE && car(cdr(args))->type != DOUBLE_TYPE){
-            minusReturnDouble = car(args)->d - car(cdr(args))->i;
-        } else if(car(args)->type != DOUBLE_TYPE && car(cdr(args))->type == DOUBLE_TYPE){
-            minusReturnDouble = car(args)->i - car(cdr(args))->d;
-        } else {
-            minusReturnDouble = car(args)->d - car(cdr(args))->d;
-        }
-        minusReturn->d = minusReturnDouble;      
-    } else {
+        minusReturn->d = numberToDouble(first) - numberToDouble(second);
+    } else if(first->type == INT_TYPE && second->type == INT_TYPE &&
+        !__builtin_sub_overflow(first->i, second->i, &minusReturn->i)){
         minusReturn->type = INT_TYPE;
-        int minusReturnInt = car(args)->i - car(cdr(args))->i;
-        minusReturn->i = minusReturnInt;
+    } else {
+        return integerSubtract(first, second);
     }
 
     return minusReturn;
@@ -786,11 +1310,26 @@ Value *builtInMinus(Value *args) {
 
 
 
+//multiplies the rest of the arguments to * once the running product has
+//left the fixnum range or a bignum turns up
+Value *multiplyBignums(int64_t partialProduct, Value *args){
+    Value *product = talloc(sizeof(Value));
+    product->type = INT_TYPE;
+    product->i = partialProduct;
+    while(args->type != NULL_TYPE){
+        if(!isIntegerValue(car(args))){
+            evaluationError("cannot multiply non int or double types");
+        }
+        product = integerMultiply(product, car(args));
+        args = cdr(args);
+    }
+    return product;
+}
+
 //evaluates built in multiply
 Value *builtInMultiply(Value *args) {
     Value *tempArgs = args;
     bool doubleFound = false;
-    Value *multiplyReturn = talloc(sizeof(Value));
 
     while(tempArgs->type != NULL_TYPE){
         if(car(tempArgs)->type == DOUBLE_TYPE){
@@ -800,33 +1339,29 @@ Value *builtInMultiply(Value *args) {
         tempArgs = cdr(tempArgs);
     }
 
+    Value *multiplyReturn = talloc(sizeof(Value));
     if(doubleFound){
         double doubleMult = 1;
         while(args->type != NULL_TYPE){
-            if(car(args)->type == INT_TYPE){
-                doubleMult *= car(args)->i;
-            }
-            else if(car(args)->type == DOUBLE_TYPE){
-                doubleMult *= car(args)->d;
+            if(isNumberValue(car(args))){
+                doubleMult *= numberToDouble(car(args));
             }
             else{
-                printf("Evaluation error: cannot multiply non int or double types\n");
-                texit(1);
+                evaluationError("cannot multiply non int or double types");
             }
             args = cdr(args);
         }
         multiplyReturn->type = DOUBLE_TYPE;
         multiplyReturn->d = doubleMult;
     } else {
-        int intMult = 1;
+        int64_t intMult = 1;
         while(args->type != NULL_TYPE){
-            if(car(args)->type == INT_TYPE){
-                intMult *= car(args)->i;
-            }
-            else{
-                printf("Evaluation error: cannot multiply non int or double types\n");
-                texit(1);
+            Value *factor = car(args);
+            int64_t nextMult;
+            if(factor->type != INT_TYPE || __builtin_mul_overflow(intMult, factor->i, &nextMult)){
+                return multiplyBignums(intMult, args);
             }
+            intMult = nextMult;
             args = cdr(args);
         }
         multiplyReturn->type = INT_TYPE;
@@ -841,43 +1376,41 @@ Value *builtInDivide(Value *args) {
 
     if(args->type == NULL_TYPE || car(args)->type == NULL_TYPE || 
         cdr(args)->type == NULL_TYPE || cdr(cdr(args))->type != NULL_TYPE){
-        printf("Evaluation error: wrong number of arguments to divide\n");
-        texit(1);
+        evaluationError("wrong number of arguments to divide");
     }
 
-    if(car(args)->type != DOUBLE_TYPE && car(args)->type != INT_TYPE){
-        printf("Evaluation error: first argument is not an int or double\n");
-        texit(1);
+    Value *first = car(args);
+    Value *second = car(cdr(args));
+    if(!isNumberValue(first)){
+        evaluationError("first argument is not an int or double");
     }
-    if(car(cdr(args))->type != DOUBLE_TYPE && car(cdr(args))->type != INT_TYPE){
-        printf("Evaluation error: second argument is not an int or double\n");
-        texit(1);
+    if(!isNumberValue(second)){
+        evaluationError("second argument is not an int or double");
     }
 
     Value *divideReturn = talloc(sizeof(Value));
-    if(car(args)->type == DOUBLE_TYPE || car(cdr(args))->type == DOUBLE_TYPE){
+    if(first->type == DOUBLE_TYPE || second->type == DOUBLE_TYPE){
         divideReturn->type = DOUBLE_TYPE;
-        double divideReturnDouble = 0;
-        if(car(args)->type == DOUBLE_TYPE && car(cdr(args))->type != DOUBLE_TYPE){
-            divideReturnDouble = car(args)->d / car(cdr(args))->i;
-        } else if(car(args)->type != DOUBLE_TYPE && car(cdr(args))->type == DOUBLE_TYPE){
-            divideReturnDouble = car(args)->i / car(cdr(args))->d;
-        } else {
-            divideReturnDouble = car(args)->d / car(cdr(args))->d;
-        }
-        divideReturn->d = divideReturnDouble;      
-    } else {
-        if(car(args)->i % car(cdr(args))->i == 0){
+        divideReturn->d = numberToDouble(first) / numberToDouble(second);
+    } else if(first->type == INT_TYPE && second->type == INT_TYPE &&
+        second->i != 0 && !(first->i == INT64_MIN && second->i == -1)){
+        if(first->i % second->i == 0){
             divideReturn->type = INT_TYPE;
-            int divideReturnInt = car(args)->i / car(cdr(args))->i;
-            divideReturn->i = divideReturnInt;
+            divideReturn->i = first->i / second->i;
         }
         else{
             divideReturn->type = DOUBLE_TYPE;
-            double minusReturnDouble = (double) car(args)->i / car(cdr(args))->i;
-            divideReturn->d = minusReturnDouble;
+            divideReturn->d = (double) first->i / second->i;
         }
-        
+    } else {
+        Value *quotient;
+        Value *remainder;
+        integerDivide(first, second, &quotient, &remainder);
+        if(remainder->type == INT_TYPE && remainder->i == 0){
+            return quotient;
+        }
+        divideReturn->type = DOUBLE_TYPE;
+        divideReturn->d = numberToDouble(first) / numberToDouble(second);
     }
 
     return divideReturn;
@@ -888,49 +1421,49 @@ Value *builtInDivide(Value *args) {
 Value *builtInModulo(Value *args) {
     if(args->type == NULL_TYPE || car(args)->type == NULL_TYPE || 
         cdr(args)->type == NULL_TYPE || cdr(cdr(args))->type != NULL_TYPE){
-        printf("Evaluation error: wrong number of arguments to modulo\n");
-        texit(1);
+        evaluationError("wrong number of arguments to modulo");
     }
 
-    if(car(args)->type != INT_TYPE || car(cdr(args))->type != INT_TYPE){
-        printf("Evaluation error: arguments must be an int or double\n");
-        texit(1);
+    Value *first = car(args);
+    Value *second = car(cdr(args));
+    if(!isIntegerValue(first) || !isIntegerValue(second)){
+        evaluationError("arguments must be an int or double");
     }
 
-    Value *modReturn = talloc(sizeof(Value));
-    modReturn->type = INT_TYPE;
-    modReturn->i = car(args)->i % car(cdr(args))->i;
-    return modReturn;
-
+    if(first->type == INT_TYPE && second->type == INT_TYPE &&
+        second->i != 0 && second->i != -1){
+        Value *modReturn = talloc(sizeof(Value));
+        modReturn->type = INT_TYPE;
+        modReturn->i = first->i % second->i;
+        return modReturn;
+    }
+    Value *remainder;
+    integerDivide(first, second, NULL, &remainder);
+    return remainder;
 }
 
 //implements built in less than
 Value *builtInLessThan(Value *args) {
     if(args->type == NULL_TYPE || car(args)->type == NULL_TYPE || 
         cdr(args)->type == NULL_TYPE || cdr(cdr(args))->type != NULL_TYPE){
-        printf("Evaluation error: wrong number of arguments to less than\n");
-        texit(1);
+        evaluationError("wrong number of arguments to less than");
     }
 
-    if(car(args)->type != DOUBLE_TYPE && car(args)->type != INT_TYPE){
-        printf("Evaluation error: first argument is not an int or double\n");
-        texit(1);
+    Value *first = car(args);
+    Value *second = car(cdr(args));
+    if(!isNumberValue(first)){
+        evaluationError("first argument is not an int or double");
     }
-    if(car(cdr(args))->type != DOUBLE_TYPE && car(cdr(args))->type != INT_TYPE){
-        printf("Evaluation error: second argument is not an int or double\n");
-        texit(1);
+    if(!isNumberValue(second)){
+        evaluationError("second argument is not an int or double");
     }
 
     Value *lessThanReturn = talloc(sizeof(Value));
     lessThanReturn->type = BOOL_TYPE;
-    if(car(args)->type == DOUBLE_TYPE && car(cdr(args))->type == DOUBLE_TYPE){
-        lessThanReturn->i = (car(args)->d < car(cdr(args))->d);
-    } else if(car(args)->type == DOUBLE_TYPE && car(cdr(args))->type == INT_TYPE){
-        lessThanReturn->i = (car(args)->d < car(cdr(args))->i);
-    } else if(car(args)->type == INT_TYPE && car(cdr(args))->type == DOUBLE_TYPE){
-        lessThanReturn->i = (car(args)->i < car(cdr(args))->d);
+    if(first->type == DOUBLE_TYPE || second->type == DOUBLE_TYPE){
+        lessThanReturn->i = (numberToDouble(first) < numberToDouble(second));
     } else {
-        lessThanReturn->i = (car(args)->i < car(cdr(args))->i);
+        lessThanReturn->i = (integerCompare(first, second) < 0);
     }
     return lessThanReturn;
 }
@@ -940,29 +1473,24 @@ Value *builtInLessThan(Value *args) {
 Value *builtInGreaterThan(Value *args) {
     if(args->type == NULL_TYPE || car(args)->type == NULL_TYPE || 
         cdr(args)->type == NULL_TYPE || cdr(cdr(args))->type != NULL_TYPE){
-        printf("Evaluation error: wrong number of arguments to greater than\n");
-        texit(1);
+        evaluationError("wrong number of arguments to greater than");
     }
 
-    if(car(args)->type != DOUBLE_TYPE && car(args)->type != INT_TYPE){
-        printf("Evaluation error: first argument is not an int or double\n");
-        texit(1);
+    Value *first = car(args);
+    Value *second = car(cdr(args));
+    if(!isNumberValue(first)){
+        evaluationError("first argument is not an int or double");
     }
-    if(car(cdr(args))->type != DOUBLE_TYPE && car(cdr(args))->type != INT_TYPE){
-        printf("Evaluation error: second argument is not an int or double\n");
-        texit(1);
+    if(!isNumberValue(second)){
+        evaluationError("second argument is not an int or double");
     }
 
     Value *greaterThanReturn = talloc(sizeof(Value));
     greaterThanReturn->type = BOOL_TYPE;
-    if(car(args)->type == DOUBLE_TYPE && car(cdr(args))->type == DOUBLE_TYPE){
-        greaterThanReturn->i = (car(args)->d > car(cdr(args))->d);
-    } else if(car(args)->type == DOUBLE_TYPE && car(cdr(args))->type == INT_TYPE){
-        greaterThanReturn->i = (car(args)->d > car(cdr(args))->i);
-    } else if(car(args)->type == INT_TYPE && car(cdr(args))->type == DOUBLE_TYPE){
-        greaterThanReturn->i = (car(args)->i > car(cdr(args))->d);
+    if(first->type == DOUBLE_TYPE || second->type == DOUBLE_TYPE){
+        greaterThanReturn->i = (numberToDouble(first) > numberToDouble(second));
     } else {
-        greaterThanReturn->i = (car(args)->i > car(cdr(args))->i);
+        greaterThanReturn->i = (integerCompare(first, second) > 0);
     }
     return greaterThanReturn;
 }
@@ -971,29 +1499,24 @@ Value *builtInGreaterThan(Value *args) {
 Value *builtInEquals(Value *args) {
     if(args->type == NULL_TYPE || car(args)->type == NULL_TYPE || 
         cdr(args)->type == NULL_TYPE || cdr(cdr(args))->type != NULL_TYPE){
-        printf("Evaluation error: wrong number of arguments to equals\n");
-        texit(1);
+        evaluationError("wrong number of arguments to equals");
     }
     
-    if(car(args)->type != DOUBLE_TYPE && car(args)->type != INT_TYPE){
-        printf("Evaluation error: first argument is not an int or double\n");
-        texit(1);
+    Value *first = car(args);
+    Value *second = car(cdr(args));
+    if(!isNumberValue(first)){
+        evaluationError("first argument is not an int or double");
     }
-    if(car(cdr(args))->type != DOUBLE_TYPE && car(cdr(args))->type != INT_TYPE){
-        printf("Evaluation error: second argument is not an int or double\n");
-        texit(1);
+    if(!isNumberValue(second)){
+        evaluationError("second argument is not an int or double");
     }
 
     Value *equalsReturn = talloc(sizeof(Value));
     equalsReturn->type = BOOL_TYPE;
-    if(car(args)->type == DOUBLE_TYPE && car(cdr(args))->type == DOUBLE_TYPE){
-        equalsReturn->i = (car(args)->d == car(cdr(args))->d);
-    } else if(car(args)->type == DOUBLE_TYPE && car(cdr(args))->type == INT_TYPE){
-        equalsReturn->i = (car(args)->d == (double) car(cdr(args))->i);
-    } else if(car(args)->type == INT_TYPE && car(cdr(args))->type == DOUBLE_TYPE){
-        equalsReturn->i = ((double) car(args)->i == car(cdr(args))->d);
+    if(first->type == DOUBLE_TYPE || second->type == DOUBLE_TYPE){
+        equalsReturn->i = (numberToDouble(first) == numberToDouble(second));
     } else {
-        equalsReturn->i = (car(args)->i == car(cdr(args))->i);
+        equalsReturn->i = (integerCompare(first, second) == 0);
     }
     return equalsReturn;
 }
@@ -1003,16 +1526,13 @@ Value *builtInEquals(Value *args) {
 //implements cons
 Value *builtInCons(Value *args){
     if(args->type == NULL_TYPE){
-        printf("Evaluation error: no to cons\n");
-        texit(1);
+        evaluationError("no to cons");
     }
     if(cdr(args)->type == NULL_TYPE){
-        printf("Evaluation error: too few arguments to cons\n");
-        texit(1);
+        evaluationError("too few arguments to cons");
     }
     if(cdr(cdr(args))->type != NULL_TYPE){
-        printf("Evaluation error: too many arguments to cons\n");
-        texit(1);
+        evaluationError("too many arguments to cons");
     }
     Value *retValue = talloc(sizeof(Value));
 
@@ -1033,39 +1553,1611 @@ Value *builtInCons(Value *args){
     }
     //case when second item isn't list, make dotted pair
     else{
-        Value *dotVal = talloc(sizeof(Value));
-        dotVal->type = STR_TYPE;
-        char *dot = talloc(sizeof(char) * 2);
-        dot[0] = '.';
-        dot[1] = '\0';
-        dotVal->s = talloc(sizeof(char) * 2);
-        strcpy(dotVal->s, dot);
-        Value *newCdr = cons(car(cdr(args)), makeNull());
-        
-        retValue = cons(dotVal, newCdr);
-        retValue = cons(car(args), retValue);
-        return cons(retValue, makeNull());
+        return wrapList(dottedPair(car(args), car(cdr(args))));
     }
     return args;
     
 }
 
 
-//binds a primitive function
-void bindPrimitiveFunction(char *name, Value *(*function)(struct Value *), Frame *frame) {
-    // Bind 'name' to 'function' in 'frame'
-    Value *value = talloc(sizeof(Value));
-    value->type = PRIMITIVE_TYPE;
-    value->pf = function;
+//implements make-vector
+Value *builtInMakeVector(Value *args){
+    if(args->type == NULL_TYPE || (cdr(args)->type != NULL_TYPE && cdr(cdr(args))->type != NULL_TYPE)){
+        evaluationError("wrong number of arguments to make-vector");
+    }
+    if(car(args)->type != INT_TYPE || car(args)->i < 0){
+        evaluationError("make-vector size must be a non-negative integer");
+    }
+    if(car(args)->i > INT_MAX){
+        evaluationError("make-vector size is too large");
+    }
+    Value *fill;
+    if(cdr(args)->type != NULL_TYPE){
+        fill = car(cdr(args));
+    } else {
+        fill = talloc(sizeof(Value));
+        fill->type = INT_TYPE;
+        fill->i = 0;
+    }
+    return makeVector(car(args)->i, fill);
+}
+
+//implements vector
+Value *builtInVector(Value *args){
+    return listToVector(args);
+}
+
+//checks the vector and index arguments shared by vector-ref and vector-set!
+void checkVectorIndex(Value *args, char *name){
+    if(args->type == NULL_TYPE || cdr(args)->type == NULL_TYPE){
+        evaluationError("too few arguments to %s", name);
+    }
+    if(car(args)->type != VECTOR_TYPE){
+        evaluationError("%s must take in a vector in the first argument", name);
+    }
+    if(car(cdr(args))->type != INT_TYPE){
+        evaluationError("%s index must be an integer", name);
+    }
+    int64_t index = car(cdr(args))->i;
+    if(index < 0 || index >= car(args)->v.size){
+        evaluationError("%s index out of range", name);
+    }
+}
+
+//implements vector-ref
+Value *builtInVectorRef(Value *args){
+    checkVectorIndex(args, "vector-ref");
+    if(cdr(cdr(args))->type != NULL_TYPE){
+        evaluationError("too many arguments to vector-ref");
+    }
+    return car(args)->v.items[car(cdr(args))->i];
+}
+
+//implements vector-set!
+Value *builtInVectorSet(Value *args){
+    checkVectorIndex(args, "vector-set!");
+    if(cdr(cdr(args))->type == NULL_TYPE || cdr(cdr(cdr(args)))->type != NULL_TYPE){
+        evaluationError("wrong number of arguments to vector-set!");
+    }
+    checkUnsealed(car(args), "change a vector made");
+    car(args)->v.items[car(cdr(args))->i] = car(cdr(cdr(args)));
+    Value *voidNode = talloc(sizeof(Value));
+    voidNode->type = VOID_TYPE;
+    return voidNode;
+}
+
+//implements vector-length
+Value *builtInVectorLength(Value *args){
+    if(args->type == NULL_TYPE || cdr(args)->type != NULL_TYPE){
+        evaluationError("wrong number of arguments to vector-length");
+    }
+    if(car(args)->type != VECTOR_TYPE){
+        evaluationError("vector-length must take in a vector");
+    }
+    Value *lengthReturn = talloc(sizeof(Value));
+    lengthReturn->type = INT_TYPE;
+    lengthReturn->i = car(args)->v.size;
+    return lengthReturn;
+}
+
+//implements vector-fill!
+Value *builtInVectorFill(Value *args){
+    if(args->type == NULL_TYPE || cdr(args)->type == NULL_TYPE || cdr(cdr(args))->type != NULL_TYPE){
+        evaluationError("wrong number of arguments to vector-fill!");
+    }
+    if(car(args)->type != VECTOR_TYPE){
+        evaluationError("vector-fill! must take in a vector in the first argument");
+    }
+    Value *vector = car(args);
+    Value *fill = car(cdr(args));
+    checkUnsealed(vector, "change a vector made");
+    for(int i = 0; i < vector->v.size; i++){
+        vector->v.items[i] = fill;
+    }
+    Value *voidNode = talloc(sizeof(Value));
+    voidNode->type = VOID_TYPE;
+    return voidNode;
+}
+
+//implements list->vector
+Value *builtInListToVector(Value *args){
+    if(args->type == NULL_TYPE || cdr(args)->type != NULL_TYPE){
+        evaluationError("wrong number of arguments to list->vector");
+    }
+    Value *list = unwrapList(car(args));
+    if(list->type != CONS_TYPE && list->type != NULL_TYPE){
+        evaluationError("list->vector must take in a list");
+    }
+    Value *vector = listToVector(list);
+    for(int i = 0; i < vector->v.size; i++){
+        vector->v.items[i] = listElement(vector->v.items[i]);
+    }
+    return vector;
+}
+
+//implements vector->list
+Value *builtInVectorToList(Value *args){
+    if(args->type == NULL_TYPE || cdr(args)->type != NULL_TYPE){
+        evaluationError("wrong number of arguments to vector->list");
+    }
+    if(car(args)->type != VECTOR_TYPE){
+        evaluationError("vector->list must take in a vector");
+    }
+    Value *list = vectorToList(car(args));
+    Value *current = list;
+    while(current->type != NULL_TYPE){
+        current->c.car = unwrapList(car(current));
+        current = cdr(current);
+    }
+    return wrapList(list);
+}
+
+//implements make-hash-table, with an optional expected number of keys
+Value *builtInMakeHashTable(Value *args){
+    if(args->type == NULL_TYPE){
+        return makeHashTable(0);
+    }
+    if(cdr(args)->type != NULL_TYPE){
+        evaluationError("too many arguments to make-hash-table");
+    }
+    if(car(args)->type != INT_TYPE || car(args)->i < 0){
+        evaluationError("make-hash-table size must be a non-negative integer");
+    }
+    if(car(args)->i > INT_MAX){
+        evaluationError("make-hash-table size is too large");
+    }
+    return makeHashTable(car(args)->i);
+}
+
+//checks the table and key arguments shared by the hash table primitives and
+//returns the key. A quoted symbol comes wrapped like a quoted list, so it is
+//unwrapped here
+Value *hashTableKeyArgument(Value *args, char *name){
+    if(args->type == NULL_TYPE || cdr(args)->type == NULL_TYPE){
+        evaluationError("too few arguments to %s", name);
+    }
+    if(car(args)->type != HASHTABLE_TYPE){
+        evaluationError("%s must take in a hash table in the first argument", name);
+    }
+    Value *key = car(cdr(args));
+    if(key->type == CONS_TYPE && cdr(key)->type == NULL_TYPE && car(key)->type == SYMBOL_TYPE){
+        key = car(key);
+    }
+    if(!isHashableKey(key)){
+        evaluationError("%s key must be an integer, string or symbol", name);
+    }
+    return key;
+}
+
+//implements hash-table-ref, with an optional default for missing keys
+Value *builtInHashTableRef(Value *args){
+    Value *key = hashTableKeyArgument(args, "hash-table-ref");
+    Value *rest = cdr(cdr(args));
+    if(rest->type != NULL_TYPE && cdr(rest)->type != NULL_TYPE){
+        evaluationError("too many arguments to hash-table-ref");
+    }
+    Value *found = hashTableGet(car(args), key);
+    if(found == NULL){
+        if(rest->type == NULL_TYPE){
+            evaluationError("key not found in hash-table-ref");
+        }
+        return car(rest);
+    }
+    return found;
+}
+
+//implements hash-table-set!
+Value *builtInHashTableSet(Value *args){
+    Value *key = hashTableKeyArgument(args, "hash-table-set!");
+    if(cdr(cdr(args))->type == NULL_TYPE || cdr(cdr(cdr(args)))->type != NULL_TYPE){
+        evaluationError("wrong number of arguments to hash-table-set!");
+    }
+    checkUnsealed(car(args), "change a hash table made");
+    hashTableSet(car(args), key, car(cdr(cdr(args))));
+    Value *voidNode = talloc(sizeof(Value));
+    voidNode->type = VOID_TYPE;
+    return voidNode;
+}
+
+//implements hash-table-delete!
+Value *builtInHashTableDelete(Value *args){
+    Value *key = hashTableKeyArgument(args, "hash-table-delete!");
+    if(cdr(cdr(args))->type != NULL_TYPE){
+        evaluationError("too many arguments to hash-table-delete!");
+    }
+    checkUnsealed(car(args), "change a hash table made");
+    hashTableDelete(car(args), key);
+    Value *voidNode = talloc(sizeof(Value));
+    voidNode->type = VOID_TYPE;
+    return voidNode;
+}
+
+//implements hash-table-count
+Value *builtInHashTableCount(Value *args){
+    if(args->type == NULL_TYPE || cdr(args)->type != NULL_TYPE){
+        evaluationError("wrong number of arguments to hash-table-count");
+    }
+    if(car(args)->type != HASHTABLE_TYPE){
+        evaluationError("hash-table-count must take in a hash table");
+    }
+    Value *countReturn = talloc(sizeof(Value));
+    countReturn->type = INT_TYPE;
+    countReturn->i = car(args)->h->count;
+    return countReturn;
+}
+
+//implements hash-table-keys
+Value *builtInHashTableKeys(Value *args){
+    if(args->type == NULL_TYPE || cdr(args)->type != NULL_TYPE){
+        evaluationError("wrong number of arguments to hash-table-keys");
+    }
+    if(car(args)->type != HASHTABLE_TYPE){
+        evaluationError("hash-table-keys must take in a hash table");
+    }
+    return wrapList(hashTableKeys(car(args)));
+}
+
+//returns the linked list held by a list argument, or exits with an error
+//naming the primitive if the argument is not a list
+Value *listArgument(Value *arg, char *name){
+    Value *list = unwrapList(arg);
+    if(list->type != CONS_TYPE && list->type != NULL_TYPE){
+        evaluationError("%s must take in a list", name);
+    }
+    return list;
+}
+
+//checks that a primitive got exactly count arguments
+void checkArgumentCount(Value *args, int count, char *name){
+    if(length(args) != count){
+        evaluationError("wrong number of arguments to %s", name);
+    }
+}
+
+//checks that an argument can be applied
+void checkProcedure(Value *function, char *name){
+    if(function->type != CLOSURE_TYPE && function->type != PRIMITIVE_TYPE){
+        evaluationError("%s must take in a procedure", name);
+    }
+}
+
+//returns whether two values are structurally equal, as for equal?
+bool valuesEqual(Value *a, Value *b){
+    while(a != b){
+        if((a->type == INT_TYPE || a->type == DOUBLE_TYPE) &&
+            (b->type == INT_TYPE || b->type == DOUBLE_TYPE)){
+            double x = a->type == INT_TYPE ? a->i : a->d;
+            double y = b->type == INT_TYPE ? b->i : b->d;
+            return a->type == b->type && x == y;
+        }
+        if(a->type != b->type){
+            return false;
+        }
+        switch(a->type){
+            case STR_TYPE:
+                return compareStrings(a, b) == 0;
+            case SYMBOL_TYPE:
+                return !strcmp(a->s, b->s);
+            case DOT_TYPE:
+                return true;
+            case BOOL_TYPE:
+                return a->i == b->i;
+            case BIGNUM_TYPE:
+                return integerCompare(a, b) == 0;
+            case NULL_TYPE:
+                return true;
+            case CONS_TYPE:
+                if(!valuesEqual(car(a), car(b))){
+                    return false;
+                }
+                a = cdr(a);
+                b = cdr(b);
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+//implements length
+Value *builtInLength(Value *args){
+    checkArgumentCount(args, 1, "length");
+    Value *lengthReturn = talloc(sizeof(Value));
+    lengthReturn->type = INT_TYPE;
+    lengthReturn->i = length(listArgument(car(args), "length"));
+    return lengthReturn;
+}
+
+//implements reverse
+Value *builtInReverse(Value *args){
+    checkArgumentCount(args, 1, "reverse");
+    Value *list = listArgument(car(args), "reverse");
+    Value *reversed = makeNull();
+    while(list->type != NULL_TYPE){
+        reversed = cons(car(list), reversed);
+        list = cdr(list);
+    }
+    return wrapList(reversed);
+}
+
+//implements append. Every list but the last is copied front to back; the
+//last one is shared with the result
+Value *builtInAppend(Value *args){
+    if(args->type == NULL_TYPE){
+        return wrapList(makeNull());
+    }
+    Value *head = makeNull();
+    Value *tail = NULL;
+    while(cdr(args)->type != NULL_TYPE){
+        Value *list = listArgument(car(args), "append");
+        while(list->type != NULL_TYPE){
+            Value *cell = cons(car(list), head);
+            if(tail == NULL){
+                head = cell;
+            } else {
+                tail->c.cdr = cell;
+            }
+            tail = cell;
+            list = cdr(list);
+        }
+        args = cdr(args);
+    }
+    Value *last = listArgument(car(args), "append");
+    if(tail == NULL){
+        return wrapList(last);
+    }
+    tail->c.cdr = last;
+    return wrapList(head);
+}
+
+//implements assoc, comparing keys with equal? semantics. Returns the
+//matching pair or #f
+Value *builtInAssoc(Value *args){
+    checkArgumentCount(args, 2, "assoc");
+    Value *key = car(args);
+    if(key->type == CONS_TYPE && cdr(key)->type == NULL_TYPE){
+        key = car(key);
+    }
+    Value *list = listArgument(car(cdr(args)), "assoc");
+    while(list->type != NULL_TYPE){
+        Value *pair = car(list);
+        if(pair->type != CONS_TYPE){
+            evaluationError("assoc must take in a list of pairs");
+        }
+        if(valuesEqual(car(pair), key)){
+            return wrapList(pair);
+        }
+        list = cdr(list);
+    }
+    Value *notFound = talloc(sizeof(Value));
+    notFound->type = BOOL_TYPE;
+    notFound->i = 0;
+    return notFound;
+}
+
+//implements map over a single list. Results are collected front to back,
+//and one argument cell is reused for every call, since apply only copies
+//the arguments it is given
+Value *builtInMap(Value *args){
+    checkArgumentCount(args, 2, "map");
+    Value *function = car(args);
+    checkProcedure(function, "map");
+    Value *list = listArgument(car(cdr(args)), "map");
+
+    Value *end = makeNull();
+    Value *callArgs = cons(end, end);
+    Value *head = end;
+    Value *tail = NULL;
+    while(list->type != NULL_TYPE){
+        callArgs->c.car = listElement(car(list));
+        Value *cell = cons(unwrapList(apply(function, callArgs)), end);
+        if(tail == NULL){
+            head = cell;
+        } else {
+            tail->c.cdr = cell;
+        }
+        tail = cell;
+        list = cdr(list);
+    }
+    return wrapList(head);
+}
+
+//implements filter, keeping the elements for which the predicate is not #f
+Value *builtInFilter(Value *args){
+    checkArgumentCount(args, 2, "filter");
+    Value *function = car(args);
+    checkProcedure(function, "filter");
+    Value *list = listArgument(car(cdr(args)), "filter");
+
+    Value *end = makeNull();
+    Value *callArgs = cons(end, end);
+    Value *head = end;
+    Value *tail = NULL;
+    while(list->type != NULL_TYPE){
+        callArgs->c.car = listElement(car(list));
+        if(!isFalse(apply(function, callArgs))){
+            Value *cell = cons(car(list), end);
+            if(tail == NULL){
+                head = cell;
+            } else {
+                tail->c.cdr = cell;
+            }
+            tail = cell;
+        }
+        list = cdr(list);
+    }
+    return wrapList(head);
+}
+
+//implements fold as in SRFI 1: (fold kons knil list) calls (kons elem acc)
+//from the first element to the last
+Value *builtInFold(Value *args){
+    checkArgumentCount(args, 3, "fold");
+    Value *function = car(args);
+    checkProcedure(function, "fold");
+    Value *accumulator = car(cdr(args));
+    Value *list = listArgument(car(cdr(cdr(args))), "fold");
+
+    Value *end = makeNull();
+    Value *callArgs = cons(end, cons(end, end));
+    while(list->type != NULL_TYPE){
+        callArgs->c.car = listElement(car(list));
+        callArgs->c.cdr->c.car = accumulator;
+        accumulator = apply(function, callArgs);
+        list = cdr(list);
+    }
+    return accumulator;
+}
+
+//implements fold-left: (fold-left f init list) calls (f acc elem) from the
+//first element to the last
+Value *builtInFoldLeft(Value *args){
+    checkArgumentCount(args, 3, "fold-left");
+    Value *function = car(args);
+    checkProcedure(function, "fold-left");
+    Value *accumulator = car(cdr(args));
+    Value *list = listArgument(car(cdr(cdr(args))), "fold-left");
+
+    Value *end = makeNull();
+    Value *callArgs = cons(end, cons(end, end));
+    while(list->type != NULL_TYPE){
+        callArgs->c.car = accumulator;
+        callArgs->c.cdr->c.car = listElement(car(list));
+        accumulator = apply(function, callArgs);
+        list = cdr(list);
+    }
+    return accumulator;
+}
+
+//implements fold-right: (fold-right f init list) calls (f elem acc) from the
+//last element to the first. The elements are copied into a vector first so
+//the walk backwards needs no recursion
+Value *builtInFoldRight(Value *args){
+    checkArgumentCount(args, 3, "fold-right");
+    Value *function = car(args);
+    checkProcedure(function, "fold-right");
+    Value *accumulator = car(cdr(args));
+    Value *elements = listToVector(listArgument(car(cdr(cdr(args))), "fold-right"));
+
+    Value *end = makeNull();
+    Value *callArgs = cons(end, cons(end, end));
+    for(int i = elements->v.size - 1; i >= 0; i--){
+        callArgs->c.car = listElement(elements->v.items[i]);
+        callArgs->c.cdr->c.car = accumulator;
+        accumulator = apply(function, callArgs);
+    }
+    return accumulator;
+}
+
+//returns the scheme name of a numeric vector type, as used in error messages
+char *numericVectorName(valueType type){
+    return type == F64VECTOR_TYPE ? "f64vector" : "s64vector";
+}
+
+//checks that an argument is a numeric vector of the given type
+Value *numericVectorArgument(Value *arg, valueType type, char *name){
+    if(arg->type != type){
+        evaluationError("%s must take in an %s", name, numericVectorName(type));
+    }
+    return arg;
+}
+
+//stores a number in a numeric vector. An f64vector takes any number, an
+//s64vector only integers that fit in 64 bits
+void storeNumericElement(Value *vector, int index, Value *item, char *name){
+    if(vector->type == F64VECTOR_TYPE){
+        if(!isNumberValue(item)){
+            evaluationError("%s elements must be numbers", name);
+        }
+        vector->nv.f64[index] = numberToDouble(item);
+    } else {
+        if(item->type != INT_TYPE){
+            evaluationError("%s elements must be integers that fit in 64 bits", name);
+        }
+        vector->nv.s64[index] = item->i;
+    }
+}
+
+//returns a numeric vector element as a scheme number
+Value *numericElement(Value *vector, int index){
+    Value *item = talloc(sizeof(Value));
+    if(vector->type == F64VECTOR_TYPE){
+        item->type = DOUBLE_TYPE;
+        item->d = vector->nv.f64[index];
+    } else {
+        item->type = INT_TYPE;
+        item->i = vector->nv.s64[index];
+    }
+    return item;
+}
+
+//implements make-f64vector and make-s64vector
+Value *makeNumericVectorPrimitive(Value *args, valueType type, char *name){
+    if(args->type == NULL_TYPE || (cdr(args)->type != NULL_TYPE && cdr(cdr(args))->type != NULL_TYPE)){
+        evaluationError("wrong number of arguments to %s", name);
+    }
+    if(car(args)->type != INT_TYPE || car(args)->i < 0){
+        evaluationError("%s size must be a non-negative integer", name);
+    }
+    if(car(args)->i > INT_MAX){
+        evaluationError("%s size is too large", name);
+    }
+    Value *vector = makeNumericVector(type, car(args)->i);
+    if(cdr(args)->type != NULL_TYPE){
+        for(int i = 0; i < vector->nv.size; i++){
+            storeNumericElement(vector, i, car(cdr(args)), name);
+        }
+    }
+    return vector;
+}
+
+//returns a new numeric vector of the given type holding the car values of a
+//linked list
+Value *listToNumericVector(Value *list, valueType type, char *name){
+    Value *vector = makeNumericVector(type, length(list));
+    for(int i = 0; list->type != NULL_TYPE; i++){
+        storeNumericElement(vector, i, car(list), name);
+        list = cdr(list);
+    }
+    return vector;
+}
+
+//checks the vector and index arguments shared by the -ref and -set!
+//primitives of the numeric vectors
+void checkNumericVectorIndex(Value *args, valueType type, char *name){
+    if(args->type == NULL_TYPE || cdr(args)->type == NULL_TYPE){
+        evaluationError("too few arguments to %s", name);
+    }
+    numericVectorArgument(car(args), type, name);
+    if(car(cdr(args))->type != INT_TYPE){
+        evaluationError("%s index must be an integer", name);
+    }
+    int64_t index = car(cdr(args))->i;
+    if(index < 0 || index >= car(args)->nv.size){
+        evaluationError("%s index out of range", name);
+    }
+}
+
+//implements f64vector-ref and s64vector-ref
+Value *numericVectorRef(Value *args, valueType type, char *name){
+    checkNumericVectorIndex(args, type, name);
+    if(cdr(cdr(args))->type != NULL_TYPE){
+        evaluationError("too many arguments to %s", name);
+    }
+    return numericElement(car(args), car(cdr(args))->i);
+}
+
+//implements f64vector-set! and s64vector-set!
+Value *numericVectorSet(Value *args, valueType type, char *name){
+    checkNumericVectorIndex(args, type, name);
+    if(cdr(cdr(args))->type == NULL_TYPE || cdr(cdr(cdr(args)))->type != NULL_TYPE){
+        evaluationError("wrong number of arguments to %s", name);
+    }
+    storeNumericElement(car(args), car(cdr(args))->i, car(cdr(cdr(args))), name);
+    Value *voidNode = talloc(sizeof(Value));
+    voidNode->type = VOID_TYPE;
+    return voidNode;
+}
+
+//implements f64vector-length and s64vector-length
+Value *numericVectorLength(Value *args, valueType type, char *name){
+    checkArgumentCount(args, 1, name);
+    Value *lengthReturn = talloc(sizeof(Value));
+    lengthReturn->type = INT_TYPE;
+    lengthReturn->i = numericVectorArgument(car(args), type, name)->nv.size;
+    return lengthReturn;
+}
+
+//implements f64vector->list and s64vector->list
+Value *numericVectorToList(Value *args, valueType type, char *name){
+    checkArgumentCount(args, 1, name);
+    Value *vector = numericVectorArgument(car(args), type, name);
+    Value *list = makeNull();
+    for(int i = vector->nv.size - 1; i >= 0; i--){
+        list = cons(numericElement(vector, i), list);
+    }
+    return wrapList(list);
+}
+
+//implements f64vector-sum and s64vector-sum. An s64 sum that leaves the
+//fixnum range is redone exactly with bignums
+Value *numericVectorSum(Value *args, valueType type, char *name){
+    checkArgumentCount(args, 1, name);
+    Value *vector = numericVectorArgument(car(args), type, name);
+    Value *sum = talloc(sizeof(Value));
+    if(type == F64VECTOR_TYPE){
+        sum->type = DOUBLE_TYPE;
+        sum->d = f64Sum(vector->nv.f64, vector->nv.size);
+        return sum;
+    }
+    sum->type = INT_TYPE;
+    if(!s64Sum(vector->nv.s64, vector->nv.size, &sum->i)){
+        sum->i = 0;
+        for(int i = 0; i < vector->nv.size; i++){
+            sum = integerAdd(sum, numericElement(vector, i));
+        }
+    }
+    return sum;
+}
+
+//checks that the two vector arguments of a binary numeric vector primitive
+//have the given type and the same length
+void checkNumericVectorPair(Value *args, valueType type, char *name){
+    checkArgumentCount(args, 2, name);
+    numericVectorArgument(car(args), type, name);
+    numericVectorArgument(car(cdr(args)), type, name);
+    if(car(args)->nv.size != car(cdr(args))->nv.size){
+        evaluationError("%s must take in vectors of the same length", name);
+    }
+}
+
+//implements f64vector-dot and s64vector-dot. An s64 dot product that leaves
+//the fixnum range is redone exactly with bignums
+Value *numericVectorDot(Value *args, valueType type, char *name){
+    checkNumericVectorPair(args, type, name);
+    Value *a = car(args);
+    Value *b = car(cdr(args));
+    Value *dot = talloc(sizeof(Value));
+    if(type == F64VECTOR_TYPE){
+        dot->type = DOUBLE_TYPE;
+        dot->d = f64Dot(a->nv.f64, b->nv.f64, a->nv.size);
+        return dot;
+    }
+    dot->type = INT_TYPE;
+    if(!s64Dot(a->nv.s64, b->nv.s64, a->nv.size, &dot->i)){
+        dot->i = 0;
+        for(int i = 0; i < a->nv.size; i++){
+            dot = integerAdd(dot, integerMultiply(numericElement(a, i), numericElement(b, i)));
+        }
+    }
+    return dot;
+}
+
+//implements f64vector-add and s64vector-add, returning a new vector
+Value *numericVectorAdd(Value *args, valueType type, char *name){
+    checkNumericVectorPair(args, type, name);
+    Value *a = car(args);
+    Value *b = car(cdr(args));
+    Value *result = makeNumericVector(type, a->nv.size);
+    if(type == F64VECTOR_TYPE){
+        f64Add(a->nv.f64, b->nv.f64, result->nv.f64, a->nv.size);
+    } else if(!s64Add(a->nv.s64, b->nv.s64, result->nv.s64, a->nv.size)){
+        evaluationError("%s result does not fit in 64 bits", name);
+    }
+    return result;
+}
+
+//implements f64vector-mul and s64vector-mul, returning a new vector
+Value *numericVectorMultiply(Value *args, valueType type, char *name){
+    checkNumericVectorPair(args, type, name);
+    Value *a = car(args);
+    Value *b = car(cdr(args));
+    Value *result = makeNumericVector(type, a->nv.size);
+    if(type == F64VECTOR_TYPE){
+        f64Multiply(a->nv.f64, b->nv.f64, result->nv.f64, a->nv.size);
+    } else if(!s64Multiply(a->nv.s64, b->nv.s64, result->nv.s64, a->nv.size)){
+        evaluationError("%s result does not fit in 64 bits", name);
+    }
+    return result;
+}
+
+//implements f64vector-scale and s64vector-scale, returning a new vector
+//with every element multiplied by a number
+Value *numericVectorScale(Value *args, valueType type, char *name){
+    checkArgumentCount(args, 2, name);
+    Value *vector = numericVectorArgument(car(args), type, name);
+    Value *factor = car(cdr(args));
+    Value *result = makeNumericVector(type, vector->nv.size);
+    if(type == F64VECTOR_TYPE){
+        if(!isNumberValue(factor)){
+            evaluationError("%s factor must be a number", name);
+        }
+        f64Scale(vector->nv.f64, numberToDouble(factor), result->nv.f64, vector->nv.size);
+    } else {
+        if(factor->type != INT_TYPE){
+            evaluationError("%s factor must be an integer that fits in 64 bits", name);
+        }
+        if(!s64Scale(vector->nv.s64, factor->i, result->nv.s64, vector->nv.size)){
+            evaluationError("%s result does not fit in 64 bits", name);
+        }
+    }
+    return result;
+}
+
+//implements the -min and -max primitives of the numeric vectors
+Value *numericVectorExtreme(Value *args, valueType type, bool greatest, char *name){
+    checkArgumentCount(args, 1, name);
+    Value *vector = numericVectorArgument(car(args), type, name);
+    if(vector->nv.size == 0){
+        evaluationError("%s must take in a non-empty vector", name);
+    }
+    Value *extreme = talloc(sizeof(Value));
+    if(type == F64VECTOR_TYPE){
+        extreme->type = DOUBLE_TYPE;
+        extreme->d = greatest ? f64Max(vector->nv.f64, vector->nv.size) :
+            f64Min(vector->nv.f64, vector->nv.size);
+    } else {
+        extreme->type = INT_TYPE;
+        extreme->i = greatest ? s64Max(vector->nv.s64, vector->nv.size) :
+            s64Min(vector->nv.s64, vector->nv.size);
+    }
+    return extreme;
+}
+
+//implements f64vector-prefix-sum and s64vector-prefix-sum, returning a new
+//vector of running totals
+Value *numericVectorPrefixSum(Value *args, valueType type, char *name){
+    checkArgumentCount(args, 1, name);
+    Value *vector = numericVectorArgument(car(args), type, name);
+    Value *result = makeNumericVector(type, vector->nv.size);
+    if(type == F64VECTOR_TYPE){
+        f64PrefixSum(vector->nv.f64, result->nv.f64, vector->nv.size);
+    } else if(!s64PrefixSum(vector->nv.s64, result->nv.s64, vector->nv.size)){
+        evaluationError("%s result does not fit in 64 bits", name);
+    }
+    return result;
+}
+
+//implements make-f64vector
+Value *builtInMakeF64Vector(Value *args){
+    return makeNumericVectorPrimitive(args, F64VECTOR_TYPE, "make-f64vector");
+}
+
+//implements f64vector
+Value *builtInF64Vector(Value *args){
+    return listToNumericVector(args, F64VECTOR_TYPE, "f64vector");
+}
+
+//implements f64vector-length
+Value *builtInF64VectorLength(Value *args){
+    return numericVectorLength(args, F64VECTOR_TYPE, "f64vector-length");
+}
+
+//implements f64vector-ref
+Value *builtInF64VectorRef(Value *args){
+    return numericVectorRef(args, F64VECTOR_TYPE, "f64vector-ref");
+}
+
+//implements f64vector-set!
+Value *builtInF64VectorSet(Value *args){
+    return numericVectorSet(args, F64VECTOR_TYPE, "f64vector-set!");
+}
+
+//implements f64vector->list
+Value *builtInF64VectorToList(Value *args){
+    return numericVectorToList(args, F64VECTOR_TYPE, "f64vector->list");
+}
+
+//implements list->f64vector
+Value *builtInListToF64Vector(Value *args){
+    checkArgumentCount(args, 1, "list->f64vector");
+    return listToNumericVector(listArgument(car(args), "list->f64vector"), F64VECTOR_TYPE, "list->f64vector");
+}
+
+//implements f64vector-sum
+Value *builtInF64VectorSum(Value *args){
+    return numericVectorSum(args, F64VECTOR_TYPE, "f64vector-sum");
+}
+
+//implements f64vector-dot
+Value *builtInF64VectorDot(Value *args){
+    return numericVectorDot(args, F64VECTOR_TYPE, "f64vector-dot");
+}
+
+//implements f64vector-add
+Value *builtInF64VectorAdd(Value *args){
+    return numericVectorAdd(args, F64VECTOR_TYPE, "f64vector-add");
+}
+
+//implements f64vector-mul
+Value *builtInF64VectorMultiply(Value *args){
+    return numericVectorMultiply(args, F64VECTOR_TYPE, "f64vector-mul");
+}
+
+//implements f64vector-scale
+Value *builtInF64VectorScale(Value *args){
+    return numericVectorScale(args, F64VECTOR_TYPE, "f64vector-scale");
+}
+
+//implements f64vector-min
+Value *builtInF64VectorMin(Value *args){
+    return numericVectorExtreme(args, F64VECTOR_TYPE, false, "f64vector-min");
+}
+
+//implements f64vector-max
+Value *builtInF64VectorMax(Value *args){
+    return numericVectorExtreme(args, F64VECTOR_TYPE, true, "f64vector-max");
+}
+
+//implements f64vector-prefix-sum
+Value *builtInF64VectorPrefixSum(Value *args){
+    return numericVectorPrefixSum(args, F64VECTOR_TYPE, "f64vector-prefix-sum");
+}
+
+//implements make-s64vector
+Value *builtInMakeS64Vector(Value *args){
+    return makeNumericVectorPrimitive(args, S64VECTOR_TYPE, "make-s64vector");
+}
+
+//implements s64vector
+Value *builtInS64Vector(Value *args){
+    return listToNumericVector(args, S64VECTOR_TYPE, "s64vector");
+}
+
+//implements s64vector-length
+Value *builtInS64VectorLength(Value *args){
+    return numericVectorLength(args, S64VECTOR_TYPE, "s64vector-length");
+}
+
+//implements s64vector-ref
+Value *builtInS64VectorRef(Value *args){
+    return numericVectorRef(args, S64VECTOR_TYPE, "s64vector-ref");
+}
+
+//implements s64vector-set!
+Value *builtInS64VectorSet(Value *args){
+    return numericVectorSet(args, S64VECTOR_TYPE, "s64vector-set!");
+}
+
+//implements s64vector->list
+Value *builtInS64VectorToList(Value *args){
+    return numericVectorToList(args, S64VECTOR_TYPE, "s64vector->list");
+}
+
+//implements list->s64vector
+Value *builtInListToS64Vector(Value *args){
+    checkArgumentCount(args, 1, "list->s64vector");
+    return listToNumericVector(listArgument(car(args), "list->s64vector"), S64VECTOR_TYPE, "list->s64vector");
+}
+
+//implements s64vector-sum
+Value *builtInS64VectorSum(Value *args){
+    return numericVectorSum(args, S64VECTOR_TYPE, "s64vector-sum");
+}
+
+//implements s64vector-dot
+Value *builtInS64VectorDot(Value *args){
+    return numericVectorDot(args, S64VECTOR_TYPE, "s64vector-dot");
+}
+
+//implements s64vector-add
+Value *builtInS64VectorAdd(Value *args){
+    return numericVectorAdd(args, S64VECTOR_TYPE, "s64vector-add");
+}
+
+//implements s64vector-mul
+Value *builtInS64VectorMultiply(Value *args){
+    return numericVectorMultiply(args, S64VECTOR_TYPE, "s64vector-mul");
+}
+
+//implements s64vector-scale
+Value *builtInS64VectorScale(Value *args){
+    return numericVectorScale(args, S64VECTOR_TYPE, "s64vector-scale");
+}
+
+//implements s64vector-min
+Value *builtInS64VectorMin(Value *args){
+    return numericVectorExtreme(args, S64VECTOR_TYPE, false, "s64vector-min");
+}
+
+//implements s64vector-max
+Value *builtInS64VectorMax(Value *args){
+    return numericVectorExtreme(args, S64VECTOR_TYPE, true, "s64vector-max");
+}
+
+//implements s64vector-prefix-sum
+Value *builtInS64VectorPrefixSum(Value *args){
+    return numericVectorPrefixSum(args, S64VECTOR_TYPE, "s64vector-prefix-sum");
+}
+
+//implements force, returning the value of a promise, forcing it first if
+//needed. Any other value is returned as it is
+Value *builtInForce(Value *args){
+    checkArgumentCount(args, 1, "force");
+    if(car(args)->type != PROMISE_TYPE){
+        return car(args);
+    }
+    return forcePromise(car(args));
+}
+
+//implements make-promise, returning a promise already forced to the
+//argument, or the argument itself if it is a promise
+Value *builtInMakePromise(Value *args){
+    checkArgumentCount(args, 1, "make-promise");
+    if(car(args)->type == PROMISE_TYPE){
+        return car(args);
+    }
+    return makeForcedPromise(car(args));
+}
+
+//implements promise?
+Value *builtInPromise(Value *args){
+    checkArgumentCount(args, 1, "promise?");
+    Value *result = talloc(sizeof(Value));
+    result->type = BOOL_TYPE;
+    result->i = car(args)->type == PROMISE_TYPE;
+    return result;
+}
+
+//returns the linked list of a stream made by cons-stream: the head, the dot
+//marker and the promise for the rest
+Value *streamArgument(Value *arg, char *name){
+    Value *pair = unwrapList(arg);
+    if(pair->type != CONS_TYPE || cdr(pair)->type != CONS_TYPE ||
+        car(cdr(pair))->type != DOT_TYPE || car(cdr(cdr(pair)))->type != PROMISE_TYPE){
+        evaluationError("%s must take in a stream made by cons-stream", name);
+    }
+    return pair;
+}
+
+//implements stream-car, returning the first element of a stream
+Value *builtInStreamCar(Value *args){
+    checkArgumentCount(args, 1, "stream-car");
+    return car(streamArgument(car(args), "stream-car"));
+}
+
+//implements stream-cdr, forcing the rest of a stream
+Value *builtInStreamCdr(Value *args){
+    checkArgumentCount(args, 1, "stream-cdr");
+    return forcePromise(car(cdr(cdr(streamArgument(car(args), "stream-cdr")))));
+}
+
+//implements touch, returning the value of a future once it is ready. Any
+//other value is returned as it is
+Value *builtInTouch(Value *args){
+    checkArgumentCount(args, 1, "touch");
+    if(car(args)->type != FUTURE_TYPE){
+        return car(args);
+    }
+    return touchFuture(car(args));
+}
+
+//implements parallel-map over a single list. The procedure is applied to
+//the elements on the worker pool, so it must not mutate shared state; the
+//results keep the order of the list
+Value *builtInParallelMap(Value *args){
+    checkArgumentCount(args, 2, "parallel-map");
+    Value *function = car(args);
+    checkProcedure(function, "parallel-map");
+    Value *list = listArgument(car(cdr(args)), "parallel-map");
+
+    int count = length(list);
+    Value **items = talloc(sizeof(Value *) * count);
+    Value **results = talloc(sizeof(Value *) * count);
+    for(int i = 0; i < count; i++){
+        items[i] = listElement(car(list));
+        list = cdr(list);
+    }
+    parallelApply(function, items, results, count);
+
+    Value *head = makeNull();
+    for(int i = count - 1; i >= 0; i--){
+        head = cons(unwrapList(results[i]), head);
+    }
+    return wrapList(head);
+}
+
+//returns the evaluator statistics for this thread as a linked list of
+//dotted pairs, each a symbol naming a counter and its value
+Value *runtimeStatsList(){
+    long allocations;
+    long allocatedBytes;
+    tstats(&allocations, &allocatedBytes);
+
+    const char *names[FORM_COUNT + 8];
+    long counts[FORM_COUNT + 8];
+    int n = 0;
+    for(int i = 0; i < FORM_COUNT; i++){
+        names[n] = formNames[i];
+        counts[n++] = evalStats.forms[i];
+    }
+    names[n] = "closure-calls";
+    counts[n++] = evalStats.closureCalls;
+    names[n] = "primitive-calls";
+    counts[n++] = evalStats.primitiveCalls;
+    names[n] = "symbol-lookups";
+    counts[n++] = evalStats.symbolLookups;
+    names[n] = "frames-walked";
+    counts[n++] = evalStats.framesWalked;
+    names[n] = "max-depth";
+    counts[n++] = evalStats.maxDepth;
+    names[n] = "allocations";
+    counts[n++] = allocations;
+    names[n] = "allocated-bytes";
+    counts[n++] = allocatedBytes;
+
+    Value *list = makeNull();
+    for(int i = n - 1; i >= 0; i--){
+        Value *name = talloc(sizeof(Value));
+        name->type = SYMBOL_TYPE;
+        name->s = (char *)names[i];
+        Value *count = talloc(sizeof(Value));
+        count->type = INT_TYPE;
+        count->i = counts[i];
+        list = cons(dottedPair(name, count), list);
+    }
+    return list;
+}
+
+//implements runtime-stats, returning the evaluator statistics as an
+//association list
+Value *builtInRuntimeStats(Value *args){
+    checkArgumentCount(args, 0, "runtime-stats");
+    return wrapList(runtimeStatsList());
+}
+
+// Print the evaluator statistics for this thread to stream, one counter per
+// line.
+void printRuntimeStats(FILE *stream){
+    for(Value *stat = runtimeStatsList(); stat->type != NULL_TYPE; stat = cdr(stat)){
+        Value *pair = car(stat);
+        fprintf(stream, "%-18s %lld\n", car(pair)->s, (long long)car(cdr(cdr(pair)))->i);
+    }
+}
+
+//implements spawn, starting a green thread that calls a procedure of no
+//arguments
+Value *builtInSpawn(Value *args){
+    checkArgumentCount(args, 1, "spawn");
+    checkProcedure(car(args), "spawn");
+    return spawnGreenThread(car(args));
+}
+
+//implements yield, letting the other green threads run
+Value *builtInYield(Value *args){
+    checkArgumentCount(args, 0, "yield");
+    yieldGreenThread();
+    Value *voidNode = talloc(sizeof(Value));
+    voidNode->type = VOID_TYPE;
+    return voidNode;
+}
+
+//implements make-channel, with an optional capacity that defaults to 1
+Value *builtInMakeChannel(Value *args){
+    if(args->type == NULL_TYPE){
+        return makeChannel(1);
+    }
+    checkArgumentCount(args, 1, "make-channel");
+    if(car(args)->type != INT_TYPE || car(args)->i < 1 || car(args)->i > INT_MAX){
+        evaluationError("make-channel capacity must be a positive integer");
+    }
+    return makeChannel(car(args)->i);
+}
+
+//implements channel-put!, blocking while the channel is full
+Value *builtInChannelPut(Value *args){
+    checkArgumentCount(args, 2, "channel-put!");
+    if(car(args)->type != CHANNEL_TYPE){
+        evaluationError("channel-put! must take in a channel in the first argument");
+    }
+    channelPut(car(args), car(cdr(args)));
+    Value *voidNode = talloc(sizeof(Value));
+    voidNode->type = VOID_TYPE;
+    return voidNode;
+}
+
+//implements channel-get, blocking while the channel is empty
+Value *builtInChannelGet(Value *args){
+    checkArgumentCount(args, 1, "channel-get");
+    if(car(args)->type != CHANNEL_TYPE){
+        evaluationError("channel-get must take in a channel");
+    }
+    return channelGet(car(args));
+}
+
+// Apply a closure or primitive to a list of already evaluated arguments,
+// catching any error raised meanwhile. Returns the result and sets *raised to
+// NULL, or returns NULL with the raised value in *raised after putting the
+// evaluator's state on this thread back as it was.
+Value *applyCatching(Value *function, Value *args, Value **raised){
+    long depth = evalStats.depth;
+    int profileDepth = profileStackDepth();
+    ErrorHandler handler;
+    pushErrorHandler(&handler);
+    if(setjmp(handler.jump) == 0){
+        Value *result = apply(function, args);
+        popErrorHandler(&handler);
+        *raised = NULL;
+        return result;
+    }
+    evalStats.depth = depth;
+    profileUnwindStack(profileDepth);
+    *raised = handler.raised;
+    return NULL;
+}
+
+// Like applyCatching, but a limit exceeded during the call also unwinds to
+// here, past any handlers the call installs. Green threads and pool tasks
+// run this way, each ending on a limit like a top-level form of its own.
+Value *applyCatchingLimits(Value *function, Value *args, Value **raised){
+    long depth = evalStats.depth;
+    int profileDepth = profileStackDepth();
+    ErrorHandler *outer = formHandler;
+    ErrorHandler handler;
+    pushErrorHandler(&handler);
+    formHandler = &handler;
+    if(setjmp(handler.jump) == 0){
+        Value *result = apply(function, args);
+        popErrorHandler(&handler);
+        formHandler = outer;
+        *raised = NULL;
+        return result;
+    }
+    formHandler = outer;
+    evalStats.depth = depth;
+    profileUnwindStack(profileDepth);
+    *raised = handler.raised;
+    return NULL;
+}
+
+//implements raise, unwinding to the innermost guard or exception handler
+//with any value
+Value *builtInRaise(Value *args){
+    checkArgumentCount(args, 1, "raise");
+    raiseValue(car(args));
+    return args; // not reached
+}
+
+//returns the text printValue shows for a value, without the newline
+char *displayText(Value *value){
+    char *text;
+    size_t size;
+    FILE *stream = open_memstream(&text, &size);
+    FILE *previous = currentOutput();
+    outputSetStream(stream);
+    printValue(value);
+    outputSetStream(previous);
+    fclose(stream);
+    while(size > 0 && (text[size - 1] == '\n' || text[size - 1] == ' ')){
+        size--;
+    }
+    char *copy = talloc(size + 1);
+    memcpy(copy, text, size);
+    copy[size] = '\0';
+    free(text);
+    return copy;
+}
+
+//checks that an argument is a string
+Value *stringArgument(Value *arg, char *name){
+    if(arg->type != STR_TYPE){
+        evaluationError("%s must take in a string", name);
+    }
+    return arg;
+}
+
+//checks that an argument is an index or bound within a string: a
+//non-negative integer no greater than limit
+size_t stringIndexArgument(Value *arg, size_t limit, char *name){
+    if(arg->type != INT_TYPE){
+        evaluationError("%s index must be an integer", name);
+    }
+    if(arg->i < 0 || (uint64_t)arg->i > limit){
+        evaluationError("%s index out of range", name);
+    }
+    return arg->i;
+}
+
+//implements string-length
+Value *builtInStringLength(Value *args){
+    checkArgumentCount(args, 1, "string-length");
+    Value *lengthReturn = talloc(sizeof(Value));
+    lengthReturn->type = INT_TYPE;
+    lengthReturn->i = stringArgument(car(args), "string-length")->length;
+    return lengthReturn;
+}
+
+//implements string-append. The lengths are added up first so the result is
+//allocated once and each argument copied into place
+Value *builtInStringAppend(Value *args){
+    size_t length = 0;
+    for(Value *current = args; current->type != NULL_TYPE; current = cdr(current)){
+        length += stringArgument(car(current), "string-append")->length;
+    }
+    Value *result = talloc(sizeof(Value));
+    result->type = STR_TYPE;
+    result->s = talloc(length + 1);
+    result->length = length;
+    size_t at = 0;
+    for(Value *current = args; current->type != NULL_TYPE; current = cdr(current)){
+        memcpy(result->s + at, car(current)->s, car(current)->length);
+        at += car(current)->length;
+    }
+    result->s[length] = '\0';
+    return result;
+}
+
+//implements substring, returning a new string holding the characters from
+//start up to but not including end
+Value *builtInSubstring(Value *args){
+    checkArgumentCount(args, 3, "substring");
+    Value *string = stringArgument(car(args), "substring");
+    size_t end = stringIndexArgument(car(cdr(cdr(args))), string->length, "substring");
+    size_t start = stringIndexArgument(car(cdr(args)), end, "substring");
+    return makeString(string->s + start, end - start);
+}
+
+//implements string-ref. There is no character type, so the character comes
+//back as a string of length one
+Value *builtInStringRef(Value *args){
+    checkArgumentCount(args, 2, "string-ref");
+    Value *string = stringArgument(car(args), "string-ref");
+    if(string->length == 0){
+        evaluationError("string-ref index out of range");
+    }
+    size_t index = stringIndexArgument(car(cdr(args)), string->length - 1, "string-ref");
+    return makeString(string->s + index, 1);
+}
+
+//compares each argument with the next, as string=? and string<? do,
+//returning whether every comparison holds
+Value *compareStringArguments(Value *args, bool (*holds)(int order), char *name){
+    if(args->type == NULL_TYPE || cdr(args)->type == NULL_TYPE){
+        evaluationError("too few arguments to %s", name);
+    }
+    Value *result = talloc(sizeof(Value));
+    result->type = BOOL_TYPE;
+    result->i = 1;
+    stringArgument(car(args), name);
+    for(Value *current = args; cdr(current)->type != NULL_TYPE; current = cdr(current)){
+        stringArgument(car(cdr(current)), name);
+        if(!holds(compareStrings(car(current), car(cdr(current))))){
+            result->i = 0;
+        }
+    }
+    return result;
+}
+
+//returns whether a comparison found two strings equal
+bool stringOrderEqual(int order){
+    return order == 0;
+}
+
+//returns whether a comparison found the first string sorts first
+bool stringOrderLess(int order){
+    return order < 0;
+}
+
+//implements string=?
+Value *builtInStringEqual(Value *args){
+    return compareStringArguments(args, &stringOrderEqual, "string=?");
+}
+
+//implements string<?
+Value *builtInStringLess(Value *args){
+    return compareStringArguments(args, &stringOrderLess, "string<?");
+}
+
+//implements string->symbol
+Value *builtInStringToSymbol(Value *args){
+    checkArgumentCount(args, 1, "string->symbol");
+    Value *string = stringArgument(car(args), "string->symbol");
+    Value *symbol = makeString(string->s, string->length);
+    symbol->type = SYMBOL_TYPE;
+    return symbol;
+}
+
+//implements symbol->string. A quoted symbol comes wrapped like a quoted
+//list, so it is unwrapped first
+Value *builtInSymbolToString(Value *args){
+    checkArgumentCount(args, 1, "symbol->string");
+    Value *symbol = car(args);
+    if(symbol->type == CONS_TYPE && cdr(symbol)->type == NULL_TYPE){
+        symbol = car(symbol);
+    }
+    if(symbol->type != SYMBOL_TYPE){
+        evaluationError("symbol->string must take in a symbol");
+    }
+    return makeString(symbol->s, strlen(symbol->s));
+}
+
+//returns the optional radix argument of number->string and string->number,
+//10 if it is missing
+int radixArgument(Value *args, char *name){
+    if(cdr(args)->type == NULL_TYPE){
+        return 10;
+    }
+    if(cdr(cdr(args))->type != NULL_TYPE){
+        evaluationError("too many arguments to %s", name);
+    }
+    Value *radix = car(cdr(args));
+    if(radix->type != INT_TYPE ||
+        (radix->i != 2 && radix->i != 8 && radix->i != 10 && radix->i != 16)){
+        evaluationError("%s radix must be 2, 8, 10 or 16", name);
+    }
+    return radix->i;
+}
+
+//implements number->string with an optional radix of 2, 8, 10 or 16.
+//Doubles can only be written in decimal
+Value *builtInNumberToString(Value *args){
+    if(args->type == NULL_TYPE){
+        evaluationError("no arguments to number->string");
+    }
+    int radix = radixArgument(args, "number->string");
+    Value *number = car(args);
+    if(!isNumberValue(number)){
+        evaluationError("number->string must take in a number");
+    }
+    if(radix == 10){
+        char *text = displayText(number);
+        return makeString(text, strlen(text));
+    }
+    if(number->type == DOUBLE_TYPE){
+        evaluationError("number->string can only write doubles in decimal");
+    }
+    // Digits are produced least significant first, so the buffer is filled
+    // from the end. A bignum is divided down until what is left is a fixnum.
+    bool negative = number->type == INT_TYPE ? number->i < 0 : number->b->negative;
+    size_t capacity = number->type == INT_TYPE ? 66 : number->b->size * 32 + 2;
+    char *buffer = malloc(capacity);
+    size_t at = capacity;
+    uint64_t low;
+    if(number->type == INT_TYPE){
+        low = negative ? -(uint64_t)number->i : (uint64_t)number->i;
+    } else {
+        Value *zero = talloc(sizeof(Value));
+        zero->type = INT_TYPE;
+        zero->i = 0;
+        Value *divisor = talloc(sizeof(Value));
+        divisor->type = INT_TYPE;
+        divisor->i = radix;
+        Value *rest = negative ? integerSubtract(zero, number) : number;
+        while(rest->type == BIGNUM_TYPE){
+            Value *remainder;
+            integerDivide(rest, divisor, &rest, &remainder);
+            buffer[--at] = "0123456789abcdef"[remainder->i];
+        }
+        low = rest->i;
+    }
+    do {
+        buffer[--at] = "0123456789abcdef"[low % radix];
+        low /= radix;
+    } while(low != 0);
+    if(negative){
+        buffer[--at] = '-';
+    }
+    Value *result = makeString(buffer + at, capacity - at);
+    free(buffer);
+    return result;
+}
+
+//returns the value of a digit in the given radix, or -1 if it is not one
+int digitValue(char c, int radix){
+    int value = -1;
+    if(c >= '0' && c <= '9'){
+        value = c - '0';
+    } else if(c >= 'a' && c <= 'f'){
+        value = c - 'a' + 10;
+    } else if(c >= 'A' && c <= 'F'){
+        value = c - 'A' + 10;
+    }
+    return value < radix ? value : -1;
+}
+
+//returns the integer written in text as an optional sign and digits in the
+//given radix, or NULL if text is not such an integer
+Value *parseRadixInteger(char *text, size_t length, int radix){
+    size_t at = 0;
+    bool negative = false;
+    if(length > 0 && (text[0] == '-' || text[0] == '+')){
+        negative = text[0] == '-';
+        at++;
+    }
+    if(at == length){
+        return NULL;
+    }
+    // Digits are taken as a fixnum until it would overflow
+    int64_t fixnum = 0;
+    Value *big = NULL;
+    Value *base = talloc(sizeof(Value));
+    base->type = INT_TYPE;
+    base->i = radix;
+    for(; at < length; at++){
+        int digit = digitValue(text[at], radix);
+        if(digit < 0){
+            return NULL;
+        }
+        if(big == NULL){
+            int64_t next;
+            if(!__builtin_mul_overflow(fixnum, radix, &next) &&
+                !__builtin_add_overflow(next, digit, &next)){
+                fixnum = next;
+                continue;
+            }
+            big = talloc(sizeof(Value));
+            big->type = INT_TYPE;
+            big->i = fixnum;
+        }
+        Value *digitNumber = talloc(sizeof(Value));
+        digitNumber->type = INT_TYPE;
+        digitNumber->i = digit;
+        big = integerAdd(integerMultiply(big, base), digitNumber);
+    }
+    Value *result = big;
+    if(result == NULL){
+        result = talloc(sizeof(Value));
+        result->type = INT_TYPE;
+        result->i = fixnum;
+    }
+    if(negative){
+        Value *zero = talloc(sizeof(Value));
+        zero->type = INT_TYPE;
+        zero->i = 0;
+        result = integerSubtract(zero, result);
+    }
+    return result;
+}
+
+//implements string->number with an optional radix of 2, 8, 10 or 16,
+//returning #f if the string is not a number. In decimal it accepts what
+//the reader does, integers and doubles; in other radixes only integers
+Value *builtInStringToNumber(Value *args){
+    if(args->type == NULL_TYPE){
+        evaluationError("no arguments to string->number");
+    }
+    int radix = radixArgument(args, "string->number");
+    Value *string = stringArgument(car(args), "string->number");
+    Value *number = parseRadixInteger(string->s, string->length, radix);
+    if(number == NULL && radix == 10 && isDouble(string->s)){
+        char *end;
+        double d = strtod(string->s, &end);
+        if(end == string->s + string->length){
+            number = talloc(sizeof(Value));
+            number->type = DOUBLE_TYPE;
+            number->d = d;
+        }
+    }
+    if(number == NULL){
+        number = talloc(sizeof(Value));
+        number->type = BOOL_TYPE;
+        number->i = 0;
+    }
+    return number;
+}
+
+//implements open-output-string, returning a port that write-string can
+//append to
+Value *builtInOpenOutputString(Value *args){
+    checkArgumentCount(args, 0, "open-output-string");
+    return makeStringPort();
+}
+
+//implements write-string, writing a string to a string port or, without a
+//port, to the current output
+Value *builtInWriteString(Value *args){
+    if(args->type == NULL_TYPE || (cdr(args)->type != NULL_TYPE && cdr(cdr(args))->type != NULL_TYPE)){
+        evaluationError("wrong number of arguments to write-string");
+    }
+    Value *string = stringArgument(car(args), "write-string");
+    if(cdr(args)->type == NULL_TYPE){
+        writeBytes(string->s, string->length);
+    } else {
+        if(car(cdr(args))->type != STRINGPORT_TYPE){
+            evaluationError("write-string must take in a string port");
+        }
+        checkUnsealed(car(cdr(args)), "write to a string port made");
+        stringPortWrite(car(cdr(args)), string->s, string->length);
+    }
+    Value *voidNode = talloc(sizeof(Value));
+    voidNode->type = VOID_TYPE;
+    return voidNode;
+}
+
+//implements get-output-string, returning everything written to a string
+//port so far
+Value *builtInGetOutputString(Value *args){
+    checkArgumentCount(args, 1, "get-output-string");
+    if(car(args)->type != STRINGPORT_TYPE){
+        evaluationError("get-output-string must take in a string port");
+    }
+    return stringPortContents(car(args));
+}
+
+//implements error, raising an error object whose message is the given
+//string followed by the irritants, if any
+Value *builtInError(Value *args){
+    if(args->type == NULL_TYPE || car(args)->type != STR_TYPE){
+        evaluationError("error must take in a message string");
+    }
+    size_t length = car(args)->length;
+    size_t capacity = length + 1;
+    for(Value *irritant = cdr(args); irritant->type != NULL_TYPE; irritant = cdr(irritant)){
+        capacity += strlen(displayText(car(irritant))) + 1;
+    }
+    char *message = talloc(capacity);
+    memcpy(message, car(args)->s, length);
+    message[length] = '\0';
+    for(Value *irritant = cdr(args); irritant->type != NULL_TYPE; irritant = cdr(irritant)){
+        strcat(message, " ");
+        strcat(message, displayText(car(irritant)));
+    }
+    raiseValue(makeError(message, false));
+    return args; // not reached
+}
+
+//implements error-object?
+Value *builtInErrorObject(Value *args){
+    checkArgumentCount(args, 1, "error-object?");
+    Value *result = talloc(sizeof(Value));
+    result->type = BOOL_TYPE;
+    result->i = car(args)->type == ERROR_TYPE;
+    return result;
+}
+
+//implements error-object-message, returning the message of an error object
+//as a string
+Value *builtInErrorObjectMessage(Value *args){
+    checkArgumentCount(args, 1, "error-object-message");
+    if(car(args)->type != ERROR_TYPE){
+        evaluationError("error-object-message must take in an error object");
+    }
+    char *message = car(args)->e.message;
+    return makeString(message, strlen(message));
+}
+
+//implements with-exception-handler, calling a procedure of no arguments and
+//returning its value. If it raises a value, evaluation unwinds to here
+//first and then the handler is applied to the value, its result becoming
+//the result of with-exception-handler
+Value *builtInWithExceptionHandler(Value *args){
+    checkArgumentCount(args, 2, "with-exception-handler");
+    checkProcedure(car(args), "with-exception-handler");
+    checkProcedure(car(cdr(args)), "with-exception-handler");
+    Value *raised;
+    Value *result = applyCatching(car(cdr(args)), makeNull(), &raised);
+    if(raised == NULL){
+        return result;
+    }
+    return apply(car(args), cons(raised, makeNull()));
+}
+
+//implements flush-output, pushing buffered output out immediately
+Value *builtInFlushOutput(Value *args){
+    checkArgumentCount(args, 0, "flush-output");
+    outputFlush();
+    Value *voidNode = talloc(sizeof(Value));
+    voidNode->type = VOID_TYPE;
+    return voidNode;
+}
+
+//binds a primitive function
+void bindPrimitiveFunction(char *name, Value *(*function)(struct Value *), Frame *frame) {
+    // Bind 'name' to 'function' in 'frame'
+    Value *value = talloc(sizeof(Value));
+    value->type = PRIMITIVE_TYPE;
+    value->pf = function;
 
     Value *functionName = talloc(sizeof(Value));
     functionName->type = STR_TYPE;
     functionName->s = name;
+    functionName->length = strlen(name);
     frame->bindings = cons(cons(functionName, value), frame->bindings);
 }
 
-//evaluates a node
-Value *eval(Value *tree, Frame *frame) {
+//evaluates a node, see eval
+Value *evalNode(Value *tree, Frame *frame) {
     switch (tree->type)  {
         case NULL_TYPE: {
             break;
@@ -1089,7 +3181,49 @@ Value *eval(Value *tree, Frame *frame) {
             return tree;
             break;
         }
+        case VECTOR_TYPE: {
+            return tree;
+            break;
+        }
+        case HASHTABLE_TYPE: {
+            return tree;
+            break;
+        }
+        case FUTURE_TYPE: {
+            return tree;
+            break;
+        }
+        case THREAD_TYPE: {
+            return tree;
+            break;
+        }
+        case CHANNEL_TYPE: {
+            return tree;
+            break;
+        }
+        case ERROR_TYPE: {
+            return tree;
+            break;
+        }
+        case BIGNUM_TYPE: {
+            return tree;
+            break;
+        }
+        case F64VECTOR_TYPE:
+        case S64VECTOR_TYPE: {
+            return tree;
+            break;
+        }
+        case STRINGPORT_TYPE: {
+            return tree;
+            break;
+        }
+        case PROMISE_TYPE: {
+            return tree;
+            break;
+        }
         case SYMBOL_TYPE: {
+            evalStats.symbolLookups++;
             return lookUpSymbol(tree, frame);
             break;
         }  
@@ -1098,43 +3232,81 @@ Value *eval(Value *tree, Frame *frame) {
             Value *args = cdr(tree);
 
             if (!strcmp(first->s, "if")) {
+                evalStats.forms[IF_FORM]++;
                 return evalIf(args, frame);
             }
             else if (!strcmp(first->s, "let")) {
+                evalStats.forms[LET_FORM]++;
                 return evalLet(args, frame);
             }
             else if (!strcmp(first->s, "quote")) {
+                evalStats.forms[QUOTE_FORM]++;
                 return evalQuote(args);
             }
             else if (!strcmp(first->s, "define")) {
+                evalStats.forms[DEFINE_FORM]++;
                 return evalDefine(args, frame);
             }
             else if (!strcmp(first->s, "lambda")) {
+                evalStats.forms[LAMBDA_FORM]++;
                 return evalLambda(args, frame);
             }
             else if (!strcmp(first->s, "and")) {
+                evalStats.forms[AND_FORM]++;
                 return evalAnd(args, frame);
             }
             else if (!strcmp(first->s, "or")) {
+                evalStats.forms[OR_FORM]++;
                 return evalOr(args, frame);
             }
             else if (!strcmp(first->s, "begin")) {
+                evalStats.forms[BEGIN_FORM]++;
                 return evalBegin(args, frame);
             }
             else if (!strcmp(first->s, "let*")) {
+                evalStats.forms[LETSTAR_FORM]++;
                 return evalLetStar(args, frame);
             }
             else if (!strcmp(first->s, "letrec")) {
+                evalStats.forms[LETREC_FORM]++;
                 return evalLetRec(args, frame);
             }
             else if (!strcmp(first->s, "cond")) {
+                evalStats.forms[COND_FORM]++;
                 return evalCond(args, frame);
             }
             else if (!strcmp(first->s, "set!")) {
+                evalStats.forms[SET_FORM]++;
                 return evalSet(args, frame, frame);
             }
+            else if (!strcmp(first->s, "do")) {
+                evalStats.forms[DO_FORM]++;
+                return evalDo(args, frame);
+            }
+            else if (!strcmp(first->s, "future")) {
+                evalStats.forms[FUTURE_FORM]++;
+                return evalFuture(args, frame);
+            }
+            else if (!strcmp(first->s, "guard")) {
+                evalStats.forms[GUARD_FORM]++;
+                return evalGuard(args, frame);
+            }
+            else if (!strcmp(first->s, "delay")) {
+                evalStats.forms[DELAY_FORM]++;
+                return evalDelay(args, frame, false, "delay");
+            }
+            else if (!strcmp(first->s, "delay-force")) {
+                evalStats.forms[DELAY_FORCE_FORM]++;
+                return evalDelay(args, frame, true, "delay-force");
+            }
+            else if (!strcmp(first->s, "cons-stream")) {
+                evalStats.forms[CONS_STREAM_FORM]++;
+                return evalConsStream(args, frame);
+            }
 
-            // Other special forms go here...
+            // Other special forms go here... Each also needs a SpecialForm
+            // and a formNames entry, and an entry in frameSafeForms only if
+            // it can never keep its frame or bind in it.
 
             else {
                 // If it's not a special form, evaluate 'first', evaluate the args, then
@@ -1151,8 +3323,28 @@ Value *eval(Value *tree, Frame *frame) {
     return tree; // to prevent compiler warning about non-void function
 }
 
-//interprets a value node
-void interpret(Value *tree){
+//evaluates a node, keeping track of how deeply evaluation is nested and
+//enforcing the step and depth limits
+Value *eval(Value *tree, Frame *frame) {
+    if(++evalStats.depth > evalStats.maxDepth){
+        evalStats.maxDepth = evalStats.depth;
+    }
+    if(evalStats.depth > depthLimit){
+        limitExceeded("depth");
+    }
+    if(evalStats.depth > stackDepthLimit){
+        evaluationError("recursion too deep for a green thread stack");
+    }
+    if(++formSteps > stepLimit){
+        limitExceeded("step");
+    }
+    Value *result = evalNode(tree, frame);
+    evalStats.depth--;
+    return result;
+}
+
+//creates a global frame with bindings for all of the built-in functions
+Frame *makeGlobalFrame(){
     Frame *globalFrame = talloc(sizeof(Frame));
     globalFrame -> parent = NULL;
     globalFrame -> bindings = makeNull();
@@ -1173,10 +3365,164 @@ void interpret(Value *tree){
     bindPrimitiveFunction(">", &builtInGreaterThan, globalFrame);
     bindPrimitiveFunction("=", &builtInEquals, globalFrame);
 
-    while (tree->type != NULL_TYPE){
-        Value *evalResult = eval(car(tree), globalFrame);
-        printValue(evalResult);
-        tree = cdr(tree);
+    bindPrimitiveFunction("make-vector", &builtInMakeVector, globalFrame);
+    bindPrimitiveFunction("vector", &builtInVector, globalFrame);
+    bindPrimitiveFunction("vector-ref", &builtInVectorRef, globalFrame);
+    bindPrimitiveFunction("vector-set!", &builtInVectorSet, globalFrame);
+    bindPrimitiveFunction("vector-length", &builtInVectorLength, globalFrame);
+    bindPrimitiveFunction("vector-fill!", &builtInVectorFill, globalFrame);
+    bindPrimitiveFunction("list->vector", &builtInListToVector, globalFrame);
+    bindPrimitiveFunction("vector->list", &builtInVectorToList, globalFrame);
+    bindPrimitiveFunction("make-f64vector", &builtInMakeF64Vector, globalFrame);
+    bindPrimitiveFunction("f64vector", &builtInF64Vector, globalFrame);
+    bindPrimitiveFunction("f64vector-length", &builtInF64VectorLength, globalFrame);
+    bindPrimitiveFunction("f64vector-ref", &builtInF64VectorRef, globalFrame);
+    bindPrimitiveFunction("f64vector-set!", &builtInF64VectorSet, globalFrame);
+    bindPrimitiveFunction("f64vector->list", &builtInF64VectorToList, globalFrame);
+    bindPrimitiveFunction("list->f64vector", &builtInListToF64Vector, globalFrame);
+    bindPrimitiveFunction("f64vector-sum", &builtInF64VectorSum, globalFrame);
+    bindPrimitiveFunction("f64vector-dot", &builtInF64VectorDot, globalFrame);
+    bindPrimitiveFunction("f64vector-add", &builtInF64VectorAdd, globalFrame);
+    bindPrimitiveFunction("f64vector-mul", &builtInF64VectorMultiply, globalFrame);
+    bindPrimitiveFunction("f64vector-scale", &builtInF64VectorScale, globalFrame);
+    bindPrimitiveFunction("f64vector-min", &builtInF64VectorMin, globalFrame);
+    bindPrimitiveFunction("f64vector-max", &builtInF64VectorMax, globalFrame);
+    bindPrimitiveFunction("f64vector-prefix-sum", &builtInF64VectorPrefixSum, globalFrame);
+    bindPrimitiveFunction("make-s64vector", &builtInMakeS64Vector, globalFrame);
+    bindPrimitiveFunction("s64vector", &builtInS64Vector, globalFrame);
+    bindPrimitiveFunction("s64vector-length", &builtInS64VectorLength, globalFrame);
+    bindPrimitiveFunction("s64vector-ref", &builtInS64VectorRef, globalFrame);
+    bindPrimitiveFunction("s64vector-set!", &builtInS64VectorSet, globalFrame);
+    bindPrimitiveFunction("s64vector->list", &builtInS64VectorToList, globalFrame);
+    bindPrimitiveFunction("list->s64vector", &builtInListToS64Vector, globalFrame);
+    bindPrimitiveFunction("s64vector-sum", &builtInS64VectorSum, globalFrame);
+    bindPrimitiveFunction("s64vector-dot", &builtInS64VectorDot, globalFrame);
+    bindPrimitiveFunction("s64vector-add", &builtInS64VectorAdd, globalFrame);
+    bindPrimitiveFunction("s64vector-mul", &builtInS64VectorMultiply, globalFrame);
+    bindPrimitiveFunction("s64vector-scale", &builtInS64VectorScale, globalFrame);
+    bindPrimitiveFunction("s64vector-min", &builtInS64VectorMin, globalFrame);
+    bindPrimitiveFunction("s64vector-max", &builtInS64VectorMax, globalFrame);
+    bindPrimitiveFunction("s64vector-prefix-sum", &builtInS64VectorPrefixSum, globalFrame);
+    bindPrimitiveFunction("string-length", &builtInStringLength, globalFrame);
+    bindPrimitiveFunction("string-append", &builtInStringAppend, globalFrame);
+    bindPrimitiveFunction("substring", &builtInSubstring, globalFrame);
+    bindPrimitiveFunction("string-ref", &builtInStringRef, globalFrame);
+    bindPrimitiveFunction("string=?", &builtInStringEqual, globalFrame);
+    bindPrimitiveFunction("string<?", &builtInStringLess, globalFrame);
+    bindPrimitiveFunction("string->symbol", &builtInStringToSymbol, globalFrame);
+    bindPrimitiveFunction("symbol->string", &builtInSymbolToString, globalFrame);
+    bindPrimitiveFunction("number->string", &builtInNumberToString, globalFrame);
+    bindPrimitiveFunction("string->number", &builtInStringToNumber, globalFrame);
+    bindPrimitiveFunction("open-output-string", &builtInOpenOutputString, globalFrame);
+    bindPrimitiveFunction("write-string", &builtInWriteString, globalFrame);
+    bindPrimitiveFunction("get-output-string", &builtInGetOutputString, globalFrame);
+
+    bindPrimitiveFunction("make-hash-table", &builtInMakeHashTable, globalFrame);
+    bindPrimitiveFunction("hash-table-ref", &builtInHashTableRef, globalFrame);
+    bindPrimitiveFunction("hash-table-set!", &builtInHashTableSet, globalFrame);
+    bindPrimitiveFunction("hash-table-delete!", &builtInHashTableDelete, globalFrame);
+    bindPrimitiveFunction("hash-table-count", &builtInHashTableCount, globalFrame);
+    bindPrimitiveFunction("hash-table-keys", &builtInHashTableKeys, globalFrame);
+
+    bindPrimitiveFunction("length", &builtInLength, globalFrame);
+    bindPrimitiveFunction("reverse", &builtInReverse, globalFrame);
+    bindPrimitiveFunction("append", &builtInAppend, globalFrame);
+    bindPrimitiveFunction("assoc", &builtInAssoc, globalFrame);
+    bindPrimitiveFunction("map", &builtInMap, globalFrame);
+    bindPrimitiveFunction("filter", &builtInFilter, globalFrame);
+    bindPrimitiveFunction("fold", &builtInFold, globalFrame);
+    bindPrimitiveFunction("fold-left", &builtInFoldLeft, globalFrame);
+    bindPrimitiveFunction("fold-right", &builtInFoldRight, globalFrame);
+
+    bindPrimitiveFunction("flush-output", &builtInFlushOutput, globalFrame);
+
+    bindPrimitiveFunction("touch", &builtInTouch, globalFrame);
+    bindPrimitiveFunction("force", &builtInForce, globalFrame);
+    bindPrimitiveFunction("make-promise", &builtInMakePromise, globalFrame);
+    bindPrimitiveFunction("promise?", &builtInPromise, globalFrame);
+    bindPrimitiveFunction("stream-car", &builtInStreamCar, globalFrame);
+    bindPrimitiveFunction("stream-cdr", &builtInStreamCdr, globalFrame);
+    bindPrimitiveFunction("parallel-map", &builtInParallelMap, globalFrame);
+
+    bindPrimitiveFunction("runtime-stats", &builtInRuntimeStats, globalFrame);
+
+    bindPrimitiveFunction("raise", &builtInRaise, globalFrame);
+    bindPrimitiveFunction("error", &builtInError, globalFrame);
+    bindPrimitiveFunction("error-object?", &builtInErrorObject, globalFrame);
+    bindPrimitiveFunction("error-object-message", &builtInErrorObjectMessage, globalFrame);
+    bindPrimitiveFunction("with-exception-handler", &builtInWithExceptionHandler, globalFrame);
+
+    bindPrimitiveFunction("spawn", &builtInSpawn, globalFrame);
+    bindPrimitiveFunction("yield", &builtInYield, globalFrame);
+    bindPrimitiveFunction("make-channel", &builtInMakeChannel, globalFrame);
+    bindPrimitiveFunction("channel-put!", &builtInChannelPut, globalFrame);
+    bindPrimitiveFunction("channel-get", &builtInChannelGet, globalFrame);
+
+    return globalFrame;
+}
+
+//evaluates each top-level form of a parse tree in the given frame, printing
+//the results. A form that raises an error no handler takes only ends itself:
+//the error is printed and evaluation goes on with the next form. Returns 1 if
+//any form ended with such an error, and 0 otherwise; a form that runs past a
+//limit does not count.
+int interpretInFrame(Value *tree, Frame *frame){
+    ErrorHandler handler;
+    ErrorHandler *outerHandler = formHandler;
+    formHandler = &handler;
+    Value * volatile rest = tree;
+    volatile int status = 0;
+    while (rest->type != NULL_TYPE){
+        Value *form = car(rest);
+        rest = cdr(rest);
+        // A form that raised an error leaves the depth raised
+        evalStats.depth = 0;
+        formSteps = 0;
+        profileUnwindStack(0);
+        tsetHeapLimit(heapLimitBytes, heapLimitExceeded);
+        pushErrorHandler(&handler);
+        if(setjmp(handler.jump) == 0){
+            long long spanStart = traceBegin();
+            Value *evalResult = eval(form, frame);
+            printValue(evalResult);
+            traceEnd("form", spanStart);
+            popErrorHandler(&handler);
+        } else {
+            printError(handler.raised);
+            if(handler.raised->type != ERROR_TYPE || !handler.raised->e.limit){
+                status = 1;
+            }
+        }
+    }
+    tsetHeapLimit(-1, NULL);
+    formHandler = outerHandler;
+    return status;
+}
+
+//tokenizes, parses and evaluates everything on input in the given frame, as
+//interpretInFrame does. A syntax error is printed and nothing is evaluated.
+//Returns 1 after an error and 0 otherwise.
+int interpretStream(FILE *input, Frame *frame){
+    ErrorHandler handler;
+    pushErrorHandler(&handler);
+    if(setjmp(handler.jump) != 0){
+        printError(handler.raised);
+        return 1;
+    }
+    long long spanStart = traceBegin();
+    Value *tokens = tokenizeStream(input);
+    traceEnd("tokenize", spanStart);
+    spanStart = traceBegin();
+    Value *tree = parse(tokens);
+    traceEnd("parse", spanStart);
+    popErrorHandler(&handler);
+    return interpretInFrame(tree, frame);
+}
+
+//interprets a value node
+void interpret(Value *tree){
+    if(interpretInFrame(tree, makeGlobalFrame()) != 0){
+        texit(1);
     }
 }
 
@@ -4,7 +4,77 @@
 
 void interpret(Value *tree);
 
+// Create a global frame with bindings for all of the built-in functions.
+Frame *makeGlobalFrame();
+
+// Evaluate each top-level form of a parse tree in the given frame, printing
+// the results. A form that raises an error no handler takes only ends itself:
+// the error is printed and evaluation goes on with the next form. Returns 1 if
+// any form ended with such an error, and 0 otherwise; a form that runs past a
+// limit does not count.
+int interpretInFrame(Value *tree, Frame *frame);
+
+// Tokenize, parse and evaluate everything on input in the given frame, as
+// interpretInFrame does. A syntax error is printed and nothing is evaluated.
+// Returns 1 after an error and 0 otherwise.
+int interpretStream(FILE *input, Frame *frame);
+
+// Print a value as the result of a top-level form.
+void printValue(Value *value);
+
 Value *eval(Value *expr, Frame *frame);
 
+// Limit the evaluation of every top-level form to at most steps calls to
+// eval, heapBytes bytes allocated and depth nested evaluations. A form that
+// runs past a limit is abandoned with an evaluation error, and the next
+// form is evaluated as usual; a green thread that runs past one ends the
+// same way, leaving the others running. Each future or parallel-map task a
+// form starts may use what the form had left when starting it, and a task
+// that runs past that fails with the limit error. A negative value means no
+// limit.
+void setEvalLimits(long steps, long heapBytes, long depth);
+
+// Make depth the evaluation depth on this thread and limit the deepest it
+// may go before running out of stack, raising an evaluation error past it;
+// LONG_MAX means no limit. Returns the depth that was in place. Green
+// threads keep their own depth this way.
+long swapEvalDepth(long depth, long limit);
+
+// Print the evaluator statistics for this thread to stream, one counter per
+// line.
+void printRuntimeStats(FILE *stream);
+
+// Apply a closure or primitive to a list of already evaluated arguments.
+Value *apply(Value *function, Value *args);
+
+// Apply a closure or primitive to a list of already evaluated arguments,
+// catching any error raised meanwhile. Returns the result and sets *raised to
+// NULL, or returns NULL with the raised value in *raised after putting the
+// evaluator's state on this thread back as it was.
+Value *applyCatching(Value *function, Value *args, Value **raised);
+
+// Like applyCatching, but a limit exceeded during the call also unwinds to
+// here, past any handlers the call installs. Green threads and pool tasks
+// run this way, each ending on a limit like a top-level form of its own.
+Value *applyCatchingLimits(Value *function, Value *args, Value **raised);
+
+// Raise a value, as raiseValue does. A limit error skips the handlers
+// installed since the form handler, so a program cannot catch its way past
+// a limit.
+void raiseError(Value *raised);
+
+// Return how much of the limits on the current form this thread has used.
+EvalBudget evalBudget();
+
+// Put budget, from evalBudget, in place of what this thread has used of the
+// limits on the current form, and return what it had used. A task handed to
+// another thread takes the budget of the form that started it, so that it
+// cannot run past what that form had left.
+EvalBudget swapEvalBudget(EvalBudget budget);
+
+// Make handler the one a limit being exceeded unwinds to on this thread, and
+// return the one that was in place. Green threads keep their own this way.
+ErrorHandler *swapFormHandler(ErrorHandler *handler);
+
 #endif
 
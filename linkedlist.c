@@ -5,16 +5,26 @@
 #include <string.h>
 #include <stdio.h>
 #include "talloc.h"
+#include "output.h"
+#include "bignum.h"
+#include "text.h"
 
 #ifndef _LINKEDLIST
 #define _LINKEDLIST
 
+// makeNull with the name of the calling function attached, for the
+// allocation profiler. The makeNull macro in linkedlist.h turns every call
+// into one of these.
+Value *makeNullAt(const char *site){
+    Value *nullNode = tallocAt(sizeof(Value), site);
+    nullNode->type = NULL_TYPE;
+    return nullNode;
+}
+
 // Create a pointer to a new NULL_TYPE Value (hint: where in memory will 
 // the value have to live?
 Value *makeNull(){
-    Value *nullNode = talloc(sizeof(Value));
-    nullNode->type = NULL_TYPE;
-    return nullNode;
+    return makeNullAt("makeNull");
 }
 
 // Return whether the given pointer points at a NULL_TYPE Value. Use assertions 
@@ -29,15 +39,21 @@ bool isNull(Value *value){
     }
 }
 
-// Create a new CONS_TYPE value node.
-Value *cons(Value *newCar, Value *newCdr){
-    Value *consNode = talloc(sizeof(Value));
+// cons with the name of the calling function attached, for the allocation
+// profiler. The cons macro in linkedlist.h turns every call into one of these.
+Value *consAt(Value *newCar, Value *newCdr, const char *site){
+    Value *consNode = tallocAt(sizeof(Value), site);
     consNode->type = CONS_TYPE;
     consNode->c.car = newCar;
     consNode->c.cdr = newCdr;
     return consNode;
 }
 
+// Create a new CONS_TYPE value node.
+Value *cons(Value *newCar, Value *newCdr){
+    return consAt(newCar, newCdr, "cons");
+}
+
 // Return a pointer to the car value for the cons cell at the head of the given 
 // linked list. Use assertions here to make sure that this is a legitimate operation 
 // (e.g., there is no car value at the head of an empty list). See the assignment 
@@ -63,16 +79,17 @@ void display(Value *list){
     while(list->type != NULL_TYPE){
         switch (list->c.car->type) {
             case INT_TYPE:
-                printf("%i", list->c.car->i);
+            case BIGNUM_TYPE:
+                writeInteger(list->c.car);
                 break;
             case DOUBLE_TYPE:
-                printf("%g", list->c.car->d);
+                writeDouble(list->c.car->d);
                 break;
             case STR_TYPE:
-                printf("%s", list->c.car->s);
+                writeQuotedString(list->c.car);
                 break;
             default:
-                printf("");
+                ;
         }
         list = list->c.cdr;
     }
@@ -83,13 +100,13 @@ void display(Value *list){
 // create a new linked list of CONS_TYPE nodes whose car values point to the 
 // corresponding car values in the original list.
 Value *reverse(Value *list){
-    Value *reverseHead = makeNull();
+    Value *reverseHead = makeNullAt(__func__);
 
     while(list->type != NULL_TYPE){
         Value *newHead = talloc(sizeof(Value));
         newHead = list->c.car;
         newHead->type = list->c.car->type;
-        reverseHead = cons(newHead, reverseHead);
+        reverseHead = consAt(newHead, reverseHead, __func__);
         list = list->c.cdr;
     }
     return reverseHead;
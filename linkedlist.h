@@ -8,6 +8,12 @@
 // the value have to live?)
 Value *makeNull();
 
+// makeNull with the name of the calling function attached, for the
+// allocation profiler. The makeNull macro below turns every call into one of
+// these.
+Value *makeNullAt(const char *site);
+#define makeNull() makeNullAt(__func__)
+
 // Return whether the given pointer points at a NULL_TYPE Value. Use assertions 
 // to make sure that this is a legitimate operation. See the assignment
 // instructions for further explanation on assertions.
@@ -16,6 +22,11 @@ bool isNull(Value *value);
 // Create a pointer to a new CONS_TYPE Value
 Value *cons(Value *newCar, Value *newCdr);
 
+// cons with the name of the calling function attached, for the allocation
+// profiler. The cons macro below turns every call into one of these.
+Value *consAt(Value *newCar, Value *newCdr, const char *site);
+#define cons(newCar, newCdr) consAt((newCar), (newCdr), __func__)
+
 // Return a pointer to the car value for the cons cell at the head of the given 
 // linked list. Use assertions here to make sure that this is a legitimate operation 
 // (e.g., there is no car value at the head of an empty list). See the assignment 
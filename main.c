@@ -1,18 +1,241 @@
 #include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "tokenizer.h"
 #include "value.h"
 #include "linkedlist.h"
 #include "parser.h"
 #include "talloc.h"
 #include "interpreter.h"
+#include "output.h"
+#include "server.h"
+#include "batch.h"
+#include "forkserver.h"
+#include "image.h"
+#include "profiler.h"
+#include "allocprofile.h"
+#include "tracer.h"
+#include "scheduler.h"
 
+// Evaluates the Scheme file at path in the given frame, exiting if it has an
+// error
+void loadPrelude(char *path, Frame *frame) {
+    FILE *prelude = fopen(path, "r");
+    if (prelude == NULL) {
+        fprintf(stderr, "Error: cannot open prelude %s\n", path);
+        texit(1);
+    }
+    int status = interpretStream(prelude, frame);
+    fclose(prelude);
+    if (status != 0) {
+        texit(status);
+    }
+}
+
+// Where --profile-stacks writes the sampled stacks, or NULL
+static char *profileStacksPath = NULL;
+
+// Stops the profiler and prints its report; runs at exit, so a program that
+// ends with an error still gets one
+void reportProfile() {
+    profileStop();
+    profileReport(stderr, profileStacksPath);
+}
+
+// Prints the allocation profile; runs at exit
+void reportAllocations() {
+    allocProfileReport(stderr);
+}
+
+// Prints the evaluator statistics; runs at exit
+void reportStats() {
+    printRuntimeStats(stderr);
+}
+
+// Names the procedures bound in frame for the profiler, for when they were
+// defined before profiling started
+void nameProcedures(Frame *frame) {
+    for (Value *binding = frame->bindings; binding->type != NULL_TYPE; binding = cdr(binding)) {
+        if (cdr(car(binding))->type == CLOSURE_TYPE) {
+            profileName(cdr(car(binding)), car(car(binding))->s);
+        }
+    }
+}
+
+// Usage: interpreter [--prelude file] [--server socket-path]
+//        interpreter [--prelude file] --save-image image-file
+//        interpreter --load-image image-file [--server socket-path]
+//        interpreter [--prelude file] --fork-server socket-path
+//        interpreter [--prelude file] --fork-jobs jobs-file
+//        interpreter [--prelude file] [--profile] [--profile-stacks file]
+//                    [--alloc-profile] [--stats]
+//                    [--trace file] [--trace-threshold microseconds]
+//                    [--max-steps n] [--max-heap bytes] [--max-depth n]
+//        interpreter --batch [--jobs n] [--output-dir dir] script-or-dir...
+// With --server, requests are evaluated against the global frame, after the
+// prelude is loaded once. With --fork-server or --fork-jobs, each request or
+// script runs in a forked copy of the process made after the prelude is
+// loaded. With --save-image, the global frame is written to an image file
+// once the prelude is loaded, and --load-image starts from such an image
+// instead of building a global frame. With --profile, the program read from
+// stdin is sampled while it runs and a profile is printed to stderr at the
+// end; --profile-stacks also writes the sampled stacks for flame graphs. With
+// --alloc-profile, every allocation is recorded and a table of where they
+// came from is printed to stderr at the end. With --stats, counters of the
+// evaluator's work are printed to stderr at the end. With --trace, spans for
+// tokenizing, parsing, each top-level form and every closure application
+// lasting at least --trace-threshold microseconds (100 by default) are
+// written to a Chrome trace-event file. --max-steps, --max-heap and --max-depth
+// limit each top-level form, in every mode; a form that goes past a limit is
+// abandoned with an evaluation error and the next one runs. Any other
+// uncaught error is printed and ends its form too, but the program then exits
+// with status 1. With --batch, the scripts
+// run in parallel, each in its own interpreter instance. Otherwise the
+// program is read from stdin.
+int main(int argc, char *argv[]) {
+
+    outputInit(stdout);
+
+    char *preludePath = NULL;
+    char *socketPath = NULL;
+    char *forkSocketPath = NULL;
+    char *saveImagePath = NULL;
+    char *loadImagePath = NULL;
+    bool profile = false;
+    bool allocProfile = false;
+    bool stats = false;
+    char *tracePath = NULL;
+    long traceThreshold = 100;
+    long maxSteps = -1;
+    long maxHeap = -1;
+    long maxDepth = -1;
+    char *forkJobsPath = NULL;
+    bool batch = false;
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    char *outputDir = NULL;
+    int i = 1;
+    for (; i < argc; i++) {
+        if (!strcmp(argv[i], "--prelude") && i + 1 < argc) {
+            preludePath = argv[++i];
+        } else if (!strcmp(argv[i], "--server") && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (!strcmp(argv[i], "--fork-server") && i + 1 < argc) {
+            forkSocketPath = argv[++i];
+        } else if (!strcmp(argv[i], "--fork-jobs") && i + 1 < argc) {
+            forkJobsPath = argv[++i];
+        } else if (!strcmp(argv[i], "--save-image") && i + 1 < argc) {
+            saveImagePath = argv[++i];
+        } else if (!strcmp(argv[i], "--load-image") && i + 1 < argc) {
+            loadImagePath = argv[++i];
+        } else if (!strcmp(argv[i], "--profile")) {
+            profile = true;
+        } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (!strcmp(argv[i], "--trace-threshold") && i + 1 < argc) {
+            traceThreshold = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-steps") && i + 1 < argc) {
+            maxSteps = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-heap") && i + 1 < argc) {
+            maxHeap = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-depth") && i + 1 < argc) {
+            maxDepth = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--stats")) {
+            stats = true;
+        } else if (!strcmp(argv[i], "--alloc-profile")) {
+            allocProfile = true;
+        } else if (!strcmp(argv[i], "--profile-stacks") && i + 1 < argc) {
+            profile = true;
+            profileStacksPath = argv[++i];
+        } else if (!strcmp(argv[i], "--batch")) {
+            batch = true;
+        } else if (!strcmp(argv[i], "--jobs") && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--output-dir") && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else if (batch && argv[i][0] != '-') {
+            break;
+        } else {
+            fprintf(stderr, "Usage: %s [--prelude file] [--server socket-path]\n", argv[0]);
+            fprintf(stderr, "       %s [--prelude file] --save-image image-file\n", argv[0]);
+            fprintf(stderr, "       %s --load-image image-file [--server socket-path]\n", argv[0]);
+            fprintf(stderr, "       %s [--prelude file] --fork-server socket-path\n", argv[0]);
+            fprintf(stderr, "       %s [--prelude file] --fork-jobs jobs-file\n", argv[0]);
+            fprintf(stderr, "       %s [--prelude file] [--profile] [--profile-stacks file]\n", argv[0]);
+            fprintf(stderr, "       %*s [--alloc-profile] [--stats]\n", (int)strlen(argv[0]), "");
+            fprintf(stderr, "       %*s [--trace file] [--trace-threshold microseconds]\n", (int)strlen(argv[0]), "");
+            fprintf(stderr, "       %*s [--max-steps n] [--max-heap bytes] [--max-depth n]\n", (int)strlen(argv[0]), "");
+            fprintf(stderr, "       %s --batch [--jobs n] [--output-dir dir] script-or-dir...\n", argv[0]);
+            return 1;
+        }
+    }
+
+    setEvalLimits(maxSteps, maxHeap, maxDepth);
+
+    if (tracePath != NULL) {
+        if (traceStart(tracePath, traceThreshold) != 0) {
+            return 1;
+        }
+        atexit(traceStop);
+    }
+
+    if (batch) {
+        return runBatch(argv + i, argc - i, jobs, outputDir);
+    }
+
+    if (stats) {
+        atexit(reportStats);
+    }
+    if (allocProfile) {
+        allocProfileStart();
+        atexit(reportAllocations);
+    }
+
+    Frame *globalFrame;
+    if (loadImagePath != NULL) {
+        globalFrame = loadImage(loadImagePath);
+        if (globalFrame == NULL) {
+            return 1;
+        }
+    } else {
+        globalFrame = makeGlobalFrame();
+    }
+    if (profile) {
+        profileStart();
+        atexit(reportProfile);
+    }
+    if (profile || allocProfile) {
+        nameProcedures(globalFrame);
+    }
+    if (preludePath != NULL) {
+        loadPrelude(preludePath, globalFrame);
+    }
+
+    if (saveImagePath != NULL) {
+        int status = saveImage(saveImagePath, globalFrame);
+        tfree();
+        return status;
+    }
+
+    if (forkSocketPath != NULL || forkJobsPath != NULL) {
+        int status = runForkServer(forkSocketPath, forkJobsPath, globalFrame, preludePath);
+        tfree();
+        return status;
+    }
 
-int main() {
+    if (socketPath != NULL) {
+        int status = runServer(socketPath, globalFrame);
+        tfree();
+        return status;
+    }
 
-    Value *tokensList = tokenize();
-    Value *tree = parse(tokensList);
-    interpret(tree);
+    int status = interpretStream(stdin, globalFrame);
 
-    tfree();
-    return 0;
+    // Futures that were never touched may still be running code from this
+    // heap; the process is exiting, so leave it to the operating system
+    if (!poolBusy()) {
+        tfree();
+    }
+    return status;
 }
@@ -0,0 +1,663 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include "value.h"
+#include "talloc.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#ifndef _NUMVECTOR
+#define _NUMVECTOR
+
+// Create a new F64VECTOR_TYPE or S64VECTOR_TYPE Value with room for size
+// unboxed elements, all zero. The elements live in the same talloc'd block
+// as the Value.
+Value *makeNumericVector(valueType type, int size){
+    // Both element types are 8 bytes
+    Value *vector = talloc(sizeof(Value) + sizeof(int64_t) * size);
+    vector->type = type;
+    vector->nv.size = size;
+    vector->nv.s64 = (int64_t *)(vector + 1);
+    memset(vector->nv.s64, 0, sizeof(int64_t) * size);
+    return vector;
+}
+
+// The kernels in use, chosen once by chooseKernels
+typedef struct NumericKernels {
+    const char *name;
+    double (*f64Sum)(const double *, int);
+    double (*f64Dot)(const double *, const double *, int);
+    void (*f64Add)(const double *, const double *, double *, int);
+    void (*f64Multiply)(const double *, const double *, double *, int);
+    void (*f64Scale)(const double *, double, double *, int);
+    double (*f64Min)(const double *, int);
+    double (*f64Max)(const double *, int);
+    void (*f64PrefixSum)(const double *, double *, int);
+    bool (*s64Sum)(const int64_t *, int, int64_t *);
+    bool (*s64Add)(const int64_t *, const int64_t *, int64_t *, int);
+    int64_t (*s64Min)(const int64_t *, int);
+    int64_t (*s64Max)(const int64_t *, int);
+} NumericKernels;
+
+static NumericKernels kernels;
+static pthread_once_t kernelsChosen = PTHREAD_ONCE_INIT;
+
+// Portable versions, used as they are where nothing faster applies
+
+// Scalar f64Sum
+double f64SumScalar(const double *a, int n){
+    double sum = 0;
+    for(int i = 0; i < n; i++){
+        sum += a[i];
+    }
+    return sum;
+}
+
+// Scalar f64Dot
+double f64DotScalar(const double *a, const double *b, int n){
+    double sum = 0;
+    for(int i = 0; i < n; i++){
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// Scalar f64Add
+void f64AddScalar(const double *a, const double *b, double *out, int n){
+    for(int i = 0; i < n; i++){
+        out[i] = a[i] + b[i];
+    }
+}
+
+// Scalar f64Multiply
+void f64MultiplyScalar(const double *a, const double *b, double *out, int n){
+    for(int i = 0; i < n; i++){
+        out[i] = a[i] * b[i];
+    }
+}
+
+// Scalar f64Scale
+void f64ScaleScalar(const double *a, double k, double *out, int n){
+    for(int i = 0; i < n; i++){
+        out[i] = a[i] * k;
+    }
+}
+
+// Scalar f64Min
+double f64MinScalar(const double *a, int n){
+    double least = a[0];
+    for(int i = 1; i < n; i++){
+        if(a[i] < least){
+            least = a[i];
+        }
+    }
+    return least;
+}
+
+// Scalar f64Max
+double f64MaxScalar(const double *a, int n){
+    double greatest = a[0];
+    for(int i = 1; i < n; i++){
+        if(a[i] > greatest){
+            greatest = a[i];
+        }
+    }
+    return greatest;
+}
+
+// Scalar f64PrefixSum
+void f64PrefixSumScalar(const double *a, double *out, int n){
+    double sum = 0;
+    for(int i = 0; i < n; i++){
+        sum += a[i];
+        out[i] = sum;
+    }
+}
+
+// Scalar s64Sum
+bool s64SumScalar(const int64_t *a, int n, int64_t *sum){
+    int64_t total = 0;
+    for(int i = 0; i < n; i++){
+        if(__builtin_add_overflow(total, a[i], &total)){
+            return false;
+        }
+    }
+    *sum = total;
+    return true;
+}
+
+// Scalar s64Add
+bool s64AddScalar(const int64_t *a, const int64_t *b, int64_t *out, int n){
+    for(int i = 0; i < n; i++){
+        if(__builtin_add_overflow(a[i], b[i], &out[i])){
+            return false;
+        }
+    }
+    return true;
+}
+
+// Scalar s64Min
+int64_t s64MinScalar(const int64_t *a, int n){
+    int64_t least = a[0];
+    for(int i = 1; i < n; i++){
+        if(a[i] < least){
+            least = a[i];
+        }
+    }
+    return least;
+}
+
+// Scalar s64Max
+int64_t s64MaxScalar(const int64_t *a, int n){
+    int64_t greatest = a[0];
+    for(int i = 1; i < n; i++){
+        if(a[i] > greatest){
+            greatest = a[i];
+        }
+    }
+    return greatest;
+}
+
+#if defined(__x86_64__)
+
+// SSE2 versions, two doubles at a time. Every x86-64 CPU has SSE2.
+
+// SSE2 f64Sum
+double f64SumSse2(const double *a, int n){
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        sum0 = _mm_add_pd(sum0, _mm_loadu_pd(a + i));
+        sum1 = _mm_add_pd(sum1, _mm_loadu_pd(a + i + 2));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    double sum = lanes[0] + lanes[1];
+    for(; i < n; i++){
+        sum += a[i];
+    }
+    return sum;
+}
+
+// SSE2 f64Dot
+double f64DotSse2(const double *a, const double *b, int n){
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    double sum = lanes[0] + lanes[1];
+    for(; i < n; i++){
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// SSE2 f64Add
+void f64AddSse2(const double *a, const double *b, double *out, int n){
+    int i = 0;
+    for(; i + 2 <= n; i += 2){
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    for(; i < n; i++){
+        out[i] = a[i] + b[i];
+    }
+}
+
+// SSE2 f64Multiply
+void f64MultiplySse2(const double *a, const double *b, double *out, int n){
+    int i = 0;
+    for(; i + 2 <= n; i += 2){
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    for(; i < n; i++){
+        out[i] = a[i] * b[i];
+    }
+}
+
+// SSE2 f64Scale
+void f64ScaleSse2(const double *a, double k, double *out, int n){
+    __m128d factor = _mm_set1_pd(k);
+    int i = 0;
+    for(; i + 2 <= n; i += 2){
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), factor));
+    }
+    for(; i < n; i++){
+        out[i] = a[i] * k;
+    }
+}
+
+// SSE2 f64Min
+double f64MinSse2(const double *a, int n){
+    __m128d least = _mm_set1_pd(a[0]);
+    int i = 0;
+    for(; i + 2 <= n; i += 2){
+        least = _mm_min_pd(least, _mm_loadu_pd(a + i));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, least);
+    double result = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+    for(; i < n; i++){
+        if(a[i] < result){
+            result = a[i];
+        }
+    }
+    return result;
+}
+
+// SSE2 f64Max
+double f64MaxSse2(const double *a, int n){
+    __m128d greatest = _mm_set1_pd(a[0]);
+    int i = 0;
+    for(; i + 2 <= n; i += 2){
+        greatest = _mm_max_pd(greatest, _mm_loadu_pd(a + i));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, greatest);
+    double result = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    for(; i < n; i++){
+        if(a[i] > result){
+            result = a[i];
+        }
+    }
+    return result;
+}
+
+// AVX2 versions, four elements at a time. Compiled for AVX2 one function at
+// a time, so the rest of the program still runs on any x86-64 CPU.
+
+// AVX2 f64Sum
+__attribute__((target("avx2")))
+double f64SumAvx2(const double *a, int n){
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+        sum0 = _mm256_add_pd(sum0, _mm256_loadu_pd(a + i));
+        sum1 = _mm256_add_pd(sum1, _mm256_loadu_pd(a + i + 4));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sum0, sum1));
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for(; i < n; i++){
+        sum += a[i];
+    }
+    return sum;
+}
+
+// AVX2 f64Dot
+__attribute__((target("avx2")))
+double f64DotAvx2(const double *a, const double *b, int n){
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+        sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sum0, sum1));
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for(; i < n; i++){
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// AVX2 f64Add
+__attribute__((target("avx2")))
+void f64AddAvx2(const double *a, const double *b, double *out, int n){
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    for(; i < n; i++){
+        out[i] = a[i] + b[i];
+    }
+}
+
+// AVX2 f64Multiply
+__attribute__((target("avx2")))
+void f64MultiplyAvx2(const double *a, const double *b, double *out, int n){
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    for(; i < n; i++){
+        out[i] = a[i] * b[i];
+    }
+}
+
+// AVX2 f64Scale
+__attribute__((target("avx2")))
+void f64ScaleAvx2(const double *a, double k, double *out, int n){
+    __m256d factor = _mm256_set1_pd(k);
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), factor));
+    }
+    for(; i < n; i++){
+        out[i] = a[i] * k;
+    }
+}
+
+// AVX2 f64Min
+__attribute__((target("avx2")))
+double f64MinAvx2(const double *a, int n){
+    __m256d least = _mm256_set1_pd(a[0]);
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        least = _mm256_min_pd(least, _mm256_loadu_pd(a + i));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, least);
+    double result = lanes[0];
+    for(int lane = 1; lane < 4; lane++){
+        if(lanes[lane] < result){
+            result = lanes[lane];
+        }
+    }
+    for(; i < n; i++){
+        if(a[i] < result){
+            result = a[i];
+        }
+    }
+    return result;
+}
+
+// AVX2 f64Max
+__attribute__((target("avx2")))
+double f64MaxAvx2(const double *a, int n){
+    __m256d greatest = _mm256_set1_pd(a[0]);
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        greatest = _mm256_max_pd(greatest, _mm256_loadu_pd(a + i));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, greatest);
+    double result = lanes[0];
+    for(int lane = 1; lane < 4; lane++){
+        if(lanes[lane] > result){
+            result = lanes[lane];
+        }
+    }
+    for(; i < n; i++){
+        if(a[i] > result){
+            result = a[i];
+        }
+    }
+    return result;
+}
+
+// AVX2 f64PrefixSum. Each block of four is scanned in the register with two
+// shift-and-add steps, then offset by the running total of earlier blocks.
+__attribute__((target("avx2")))
+void f64PrefixSumAvx2(const double *a, double *out, int n){
+    __m256d zero = _mm256_setzero_pd();
+    __m256d carry = zero;
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256d x = _mm256_loadu_pd(a + i);
+        // x + [0, x0, x1, x2]
+        __m256d shifted = _mm256_blend_pd(_mm256_permute4x64_pd(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x1);
+        x = _mm256_add_pd(x, shifted);
+        // x + [0, 0, x0, x1]
+        shifted = _mm256_blend_pd(_mm256_permute4x64_pd(x, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x3);
+        x = _mm256_add_pd(_mm256_add_pd(x, shifted), carry);
+        _mm256_storeu_pd(out + i, x);
+        carry = _mm256_permute4x64_pd(x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    double sum = i > 0 ? out[i - 1] : 0;
+    for(; i < n; i++){
+        sum += a[i];
+        out[i] = sum;
+    }
+}
+
+// AVX2 s64Sum. Overflow is caught per lane: a sum overflowed exactly when
+// both addends have a sign different from the result's.
+__attribute__((target("avx2")))
+bool s64SumAvx2(const int64_t *a, int n, int64_t *sum){
+    __m256i total = _mm256_setzero_si256();
+    __m256i overflow = _mm256_setzero_si256();
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i result = _mm256_add_epi64(total, x);
+        overflow = _mm256_or_si256(overflow, _mm256_and_si256(
+            _mm256_xor_si256(total, result), _mm256_xor_si256(x, result)));
+        total = result;
+    }
+    if(_mm256_movemask_pd(_mm256_castsi256_pd(overflow)) != 0){
+        return false;
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, total);
+    int64_t result = 0;
+    for(int lane = 0; lane < 4; lane++){
+        if(__builtin_add_overflow(result, lanes[lane], &result)){
+            return false;
+        }
+    }
+    for(; i < n; i++){
+        if(__builtin_add_overflow(result, a[i], &result)){
+            return false;
+        }
+    }
+    *sum = result;
+    return true;
+}
+
+// AVX2 s64Add
+__attribute__((target("avx2")))
+bool s64AddAvx2(const int64_t *a, const int64_t *b, int64_t *out, int n){
+    __m256i overflow = _mm256_setzero_si256();
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i result = _mm256_add_epi64(x, y);
+        overflow = _mm256_or_si256(overflow, _mm256_and_si256(
+            _mm256_xor_si256(x, result), _mm256_xor_si256(y, result)));
+        _mm256_storeu_si256((__m256i *)(out + i), result);
+    }
+    if(_mm256_movemask_pd(_mm256_castsi256_pd(overflow)) != 0){
+        return false;
+    }
+    return s64AddScalar(a + i, b + i, out + i, n - i);
+}
+
+// AVX2 s64Min
+__attribute__((target("avx2")))
+int64_t s64MinAvx2(const int64_t *a, int n){
+    __m256i least = _mm256_set1_epi64x(a[0]);
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        least = _mm256_blendv_epi8(least, x, _mm256_cmpgt_epi64(least, x));
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, least);
+    int64_t result = s64MinScalar(lanes, 4);
+    for(; i < n; i++){
+        if(a[i] < result){
+            result = a[i];
+        }
+    }
+    return result;
+}
+
+// AVX2 s64Max
+__attribute__((target("avx2")))
+int64_t s64MaxAvx2(const int64_t *a, int n){
+    __m256i greatest = _mm256_set1_epi64x(a[0]);
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        greatest = _mm256_blendv_epi8(greatest, x, _mm256_cmpgt_epi64(x, greatest));
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, greatest);
+    int64_t result = s64MaxScalar(lanes, 4);
+    for(; i < n; i++){
+        if(a[i] > result){
+            result = a[i];
+        }
+    }
+    return result;
+}
+
+#endif
+
+// Picks the fastest kernels the CPU supports
+void chooseKernels(){
+    kernels = (NumericKernels){
+        "scalar", f64SumScalar, f64DotScalar, f64AddScalar, f64MultiplyScalar,
+        f64ScaleScalar, f64MinScalar, f64MaxScalar, f64PrefixSumScalar,
+        s64SumScalar, s64AddScalar, s64MinScalar, s64MaxScalar
+    };
+#if defined(__x86_64__)
+    kernels.name = "sse2";
+    kernels.f64Sum = f64SumSse2;
+    kernels.f64Dot = f64DotSse2;
+    kernels.f64Add = f64AddSse2;
+    kernels.f64Multiply = f64MultiplySse2;
+    kernels.f64Scale = f64ScaleSse2;
+    kernels.f64Min = f64MinSse2;
+    kernels.f64Max = f64MaxSse2;
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        kernels = (NumericKernels){
+            "avx2", f64SumAvx2, f64DotAvx2, f64AddAvx2, f64MultiplyAvx2,
+            f64ScaleAvx2, f64MinAvx2, f64MaxAvx2, f64PrefixSumAvx2,
+            s64SumAvx2, s64AddAvx2, s64MinAvx2, s64MaxAvx2
+        };
+    }
+#endif
+}
+
+// Returns the kernels in use, choosing them on first use
+NumericKernels *numericKernels(){
+    pthread_once(&kernelsChosen, chooseKernels);
+    return &kernels;
+}
+
+// Return the sum of a[0..n).
+double f64Sum(const double *a, int n){
+    return numericKernels()->f64Sum(a, n);
+}
+
+// Return the dot product of a[0..n) and b[0..n).
+double f64Dot(const double *a, const double *b, int n){
+    return numericKernels()->f64Dot(a, b, n);
+}
+
+// Store a[i] + b[i] in out[i] for each i below n.
+void f64Add(const double *a, const double *b, double *out, int n){
+    numericKernels()->f64Add(a, b, out, n);
+}
+
+// Store a[i] * b[i] in out[i] for each i below n.
+void f64Multiply(const double *a, const double *b, double *out, int n){
+    numericKernels()->f64Multiply(a, b, out, n);
+}
+
+// Store a[i] * k in out[i] for each i below n.
+void f64Scale(const double *a, double k, double *out, int n){
+    numericKernels()->f64Scale(a, k, out, n);
+}
+
+// Return the least of a[0..n), n > 0.
+double f64Min(const double *a, int n){
+    return numericKernels()->f64Min(a, n);
+}
+
+// Return the greatest of a[0..n), n > 0.
+double f64Max(const double *a, int n){
+    return numericKernels()->f64Max(a, n);
+}
+
+// Store a[0] + ... + a[i] in out[i] for each i below n.
+void f64PrefixSum(const double *a, double *out, int n){
+    numericKernels()->f64PrefixSum(a, out, n);
+}
+
+// Store the sum of a[0..n) in *sum.
+bool s64Sum(const int64_t *a, int n, int64_t *sum){
+    return numericKernels()->s64Sum(a, n, sum);
+}
+
+// Store the dot product of a[0..n) and b[0..n) in *dot.
+bool s64Dot(const int64_t *a, const int64_t *b, int n, int64_t *dot){
+    int64_t total = 0;
+    for(int i = 0; i < n; i++){
+        int64_t product;
+        if(__builtin_mul_overflow(a[i], b[i], &product) ||
+            __builtin_add_overflow(total, product, &total)){
+            return false;
+        }
+    }
+    *dot = total;
+    return true;
+}
+
+// Store a[i] + b[i] in out[i] for each i below n.
+bool s64Add(const int64_t *a, const int64_t *b, int64_t *out, int n){
+    return numericKernels()->s64Add(a, b, out, n);
+}
+
+// Store a[i] * b[i] in out[i] for each i below n.
+bool s64Multiply(const int64_t *a, const int64_t *b, int64_t *out, int n){
+    for(int i = 0; i < n; i++){
+        if(__builtin_mul_overflow(a[i], b[i], &out[i])){
+            return false;
+        }
+    }
+    return true;
+}
+
+// Store a[i] * k in out[i] for each i below n.
+bool s64Scale(const int64_t *a, int64_t k, int64_t *out, int n){
+    for(int i = 0; i < n; i++){
+        if(__builtin_mul_overflow(a[i], k, &out[i])){
+            return false;
+        }
+    }
+    return true;
+}
+
+// Return the least of a[0..n), n > 0.
+int64_t s64Min(const int64_t *a, int n){
+    return numericKernels()->s64Min(a, n);
+}
+
+// Return the greatest of a[0..n), n > 0.
+int64_t s64Max(const int64_t *a, int n){
+    return numericKernels()->s64Max(a, n);
+}
+
+// Store a[0] + ... + a[i] in out[i] for each i below n.
+bool s64PrefixSum(const int64_t *a, int64_t *out, int n){
+    int64_t sum = 0;
+    for(int i = 0; i < n; i++){
+        if(__builtin_add_overflow(sum, a[i], &sum)){
+            return false;
+        }
+        out[i] = sum;
+    }
+    return true;
+}
+
+// Return the name of the kernels in use: "avx2", "sse2" or "scalar".
+const char *numericKernelName(){
+    return numericKernels()->name;
+}
+
+#endif
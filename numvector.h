@@ -0,0 +1,76 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "value.h"
+
+#ifndef _NUMVECTOR
+#define _NUMVECTOR
+
+// Create a new F64VECTOR_TYPE or S64VECTOR_TYPE Value with room for size
+// unboxed elements, all zero. The elements live in the same talloc'd block
+// as the Value.
+Value *makeNumericVector(valueType type, int size);
+
+// Kernels over unboxed elements. Each has a portable scalar version and, on
+// x86-64, SSE2 and AVX2 versions; the first call picks the fastest one the
+// CPU supports. Vectorized floating-point reductions add in a different
+// order than a left-to-right loop, so they can differ in the last bits.
+
+// Return the sum of a[0..n).
+double f64Sum(const double *a, int n);
+
+// Return the dot product of a[0..n) and b[0..n).
+double f64Dot(const double *a, const double *b, int n);
+
+// Store a[i] + b[i] in out[i] for each i below n.
+void f64Add(const double *a, const double *b, double *out, int n);
+
+// Store a[i] * b[i] in out[i] for each i below n.
+void f64Multiply(const double *a, const double *b, double *out, int n);
+
+// Store a[i] * k in out[i] for each i below n.
+void f64Scale(const double *a, double k, double *out, int n);
+
+// Return the least of a[0..n), n > 0.
+double f64Min(const double *a, int n);
+
+// Return the greatest of a[0..n), n > 0.
+double f64Max(const double *a, int n);
+
+// Store a[0] + ... + a[i] in out[i] for each i below n.
+void f64PrefixSum(const double *a, double *out, int n);
+
+// The s64 kernels below return false instead of wrapping around when a
+// result does not fit in 64 bits. Reductions also return false when some
+// partial sum does not fit, and the vectorized ones add in a different order,
+// so a sum that fits can still come back false; callers redo it exactly.
+// Only sum, add, min and max have vectorized versions, since SSE2 and AVX2
+// have no 64-bit integer multiply.
+
+// Store the sum of a[0..n) in *sum.
+bool s64Sum(const int64_t *a, int n, int64_t *sum);
+
+// Store the dot product of a[0..n) and b[0..n) in *dot.
+bool s64Dot(const int64_t *a, const int64_t *b, int n, int64_t *dot);
+
+// Store a[i] + b[i] in out[i] for each i below n.
+bool s64Add(const int64_t *a, const int64_t *b, int64_t *out, int n);
+
+// Store a[i] * b[i] in out[i] for each i below n.
+bool s64Multiply(const int64_t *a, const int64_t *b, int64_t *out, int n);
+
+// Store a[i] * k in out[i] for each i below n.
+bool s64Scale(const int64_t *a, int64_t k, int64_t *out, int n);
+
+// Return the least of a[0..n), n > 0.
+int64_t s64Min(const int64_t *a, int n);
+
+// Return the greatest of a[0..n), n > 0.
+int64_t s64Max(const int64_t *a, int n);
+
+// Store a[0] + ... + a[i] in out[i] for each i below n.
+bool s64PrefixSum(const int64_t *a, int64_t *out, int n);
+
+// Return the name of the kernels in use: "avx2", "sse2" or "scalar".
+const char *numericKernelName();
+
+#endif
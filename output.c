@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdarg.h>
+
+#ifndef _OUTPUT
+#define _OUTPUT
+
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+
+// Buffer for the stream given to outputInit. Streams of interpreter
+// instances bring their own buffers.
+char outputBuffer[OUTPUT_BUFFER_SIZE];
+
+// Each thread writes to its own stream, so instances running on different
+// threads never share output
+_Thread_local FILE *outputStream = NULL;
+
+// Send all further output to stream, giving it a large fully-buffered
+// buffer so that printing many small values does not cost a write each.
+// Must be called before anything is written to stream. Error messages
+// printed with printf go through the same stream, so they stay in order.
+void outputInit(FILE *stream){
+    outputStream = stream;
+    setvbuf(stream, outputBuffer, _IOFBF, OUTPUT_BUFFER_SIZE);
+}
+
+// Make stream this thread's output stream without changing its buffering.
+// Each interpreter instance sets its own stream when it starts running.
+void outputSetStream(FILE *stream){
+    outputStream = stream;
+}
+
+// Return this thread's output stream, stdout unless set otherwise.
+FILE *currentOutput(){
+    if(outputStream == NULL){
+        return stdout;
+    }
+    return outputStream;
+}
+
+// Write one character.
+void writeChar(char c){
+    putc(c, currentOutput());
+}
+
+// Write a null-terminated string.
+void writeString(const char *s){
+    fwrite(s, 1, strlen(s), currentOutput());
+}
+
+// Write length bytes starting at bytes.
+void writeBytes(const char *bytes, size_t length){
+    fwrite(bytes, 1, length, currentOutput());
+}
+
+// Write an integer in decimal.
+void writeInt(int64_t i){
+    char digits[21];
+    int pos = sizeof(digits);
+    // Work with the magnitude as unsigned so INT64_MIN does not overflow
+    uint64_t magnitude = i < 0 ? 0u - (uint64_t)i : (uint64_t)i;
+    do {
+        digits[--pos] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while(magnitude != 0);
+    if(i < 0){
+        digits[--pos] = '-';
+    }
+    fwrite(digits + pos, 1, sizeof(digits) - pos, currentOutput());
+}
+
+// Write a double using the fewest digits that read back as the same double,
+// always with a decimal point so it reads as a double again, as in 2.0 or
+// 5.0e+19.
+void writeDouble(double d){
+    if(isnan(d)){
+        writeString("+nan.0");
+        return;
+    }
+    if(isinf(d)){
+        writeString(d > 0 ? "+inf.0" : "-inf.0");
+        return;
+    }
+    // %g drops trailing zeros, so if 15 significant digits read back
+    // correctly they are also the shortest digits that do. Otherwise 16 or
+    // 17 are needed, and 17 always suffice.
+    char text[32];
+    for(int precision = 15; precision <= 17; precision++){
+        snprintf(text, sizeof(text), "%.*g", precision, d);
+        if(strtod(text, NULL) == d){
+            break;
+        }
+    }
+    // %g leaves the point out of whole mantissas, as in 2 or 5e+19
+    if(strpbrk(text, ".n") == NULL){
+        char *exponent = strchr(text, 'e');
+        if(exponent == NULL){
+            strcat(text, ".0");
+        } else {
+            memmove(exponent + 2, exponent, strlen(exponent) + 1);
+            memcpy(exponent, ".0", 2);
+        }
+    }
+    writeString(text);
+}
+
+// Write formatted text, as printf does, to this thread's output stream.
+void writeFormat(const char *format, ...){
+    va_list args;
+    va_start(args, format);
+    vfprintf(currentOutput(), format, args);
+    va_end(args);
+}
+
+// Push everything buffered so far out to the stream.
+void outputFlush(){
+    fflush(currentOutput());
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#ifndef _OUTPUT
+#define _OUTPUT
+
+// Send all further output to stream, giving it a large fully-buffered
+// buffer so that printing many small values does not cost a write each.
+// Must be called before anything is written to stream. Error messages
+// printed with printf go through the same stream, so they stay in order.
+void outputInit(FILE *stream);
+
+// Make stream this thread's output stream without changing its buffering.
+// Each interpreter instance sets its own stream when it starts running.
+void outputSetStream(FILE *stream);
+
+// Return this thread's output stream, stdout unless set otherwise.
+FILE *currentOutput();
+
+// Write one character.
+void writeChar(char c);
+
+// Write a null-terminated string.
+void writeString(const char *s);
+
+// Write length bytes starting at bytes.
+void writeBytes(const char *bytes, size_t length);
+
+// Write an integer in decimal.
+void writeInt(int64_t i);
+
+// Write a double using the fewest digits that read back as the same double,
+// always with a decimal point so it reads as a double again, as in 2.0 or
+// 5.0e+19.
+void writeDouble(double d);
+
+// Write formatted text, as printf does, to this thread's output stream.
+void writeFormat(const char *format, ...);
+
+// Push everything buffered so far out to the stream.
+void outputFlush();
+
+#endif
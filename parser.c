@@ -2,6 +2,12 @@
 #include "talloc.h"
 #include "linkedlist.h"
 #include "tokenizer.h"
+#include "vector.h"
+#include "output.h"
+#include "error.h"
+#include "bignum.h"
+#include "constpool.h"
+#include "text.h"
 #include <stdio.h>
 #include <assert.h>
 #include <stdbool.h>
@@ -12,9 +18,62 @@
 #ifndef _PARSER
 #define _PARSER
 
+// Build the vector for a #( ... ) literal from its parsed elements. A vector
+// literal is self-quoting, so nested lists are wrapped the same way quote
+// wraps its argument; vector-ref then hands them out as ordinary list values.
+Value *makeVectorLiteral(Value *elements){
+    Value *vector = listToVector(elements);
+    for(int i = 0; i < vector->v.size; i++){
+        Value *item = vector->v.items[i];
+        if(item->type == CONS_TYPE || item->type == NULL_TYPE){
+            vector->v.items[i] = cons(item, makeNull());
+        }
+    }
+    return vector;
+}
+
+// Close the list whose elements are on top of the stack as quoted data,
+// replacing them and their open paren with the pooled list that has the same
+// elements, or with a new list that is then added to the pool. Returns the
+// new stack, or NULL, leaving the stack alone, if the elements belong to a
+// vector literal. A new list ends in empty.
+Value *closeSharedList(Value *tree, Value *empty, ConstantPool *pool){
+    int count = 0;
+    Value *open = tree;
+    while(car(open)->type != OPEN_TYPE && car(open)->type != OPENVECTOR_TYPE){
+        if(cdr(open)->type == NULL_TYPE){
+            syntaxError("too many close parens");
+        }
+        open = cdr(open);
+        count++;
+    }
+    if(car(open)->type == OPENVECTOR_TYPE){
+        return NULL;
+    }
+    // The stack holds the elements last first
+    Value **items = malloc(sizeof(Value *) * (count > 0 ? count : 1));
+    Value *item = tree;
+    for(int i = count - 1; i >= 0; i--){
+        items[i] = car(item);
+        item = cdr(item);
+    }
+    uint64_t hash;
+    Value *list = findConstantList(pool, items, count, &hash);
+    if(list == NULL){
+        list = empty;
+        for(int i = count - 1; i >= 0; i--){
+            list = cons(items[i], list);
+        }
+        addConstantList(pool, list, hash);
+    }
+    free(items);
+    return cons(list, cdr(open));
+}
+
 // If token is not a close parentheses, push onto stack. 
 // Otherwise, pop items from stack until an open paren, forming a subtree. Then push subtree on stack.
-Value *addToParseTree(Value  *tree, Value *token, int *depth){
+// A list closed with a pool is quoted data, shared through the pool.
+Value *addToParseTree(Value  *tree, Value *token, int *depth, ConstantPool *pool){
     if(token->type != CLOSE_TYPE){
         tree = cons(token, tree); // push token onto stack
     }
@@ -23,96 +82,227 @@ Value *addToParseTree(Value  *tree, Value *token, int *depth){
     switch (token->type) {
         case CLOSE_TYPE:
             (*depth)--; 
-            while (car(tree)->type != OPEN_TYPE){
+            if(pool != NULL){
+                Value *shared = closeSharedList(tree, subtree, pool);
+                if(shared != NULL){
+                    return shared;
+                }
+            }
+            while (car(tree)->type != OPEN_TYPE && car(tree)->type != OPENVECTOR_TYPE){
                 subtree = cons(car(tree), subtree); // pop and add to subtree
                 
                 // if there's no more items on the stack, throw an error
                 if (cdr(tree)->type == NULL_TYPE){
-                    printf("Syntax error: too many close parens\n");
-                    texit(0);
+                    syntaxError("too many close parens");
                 }
                 tree = cdr(tree); 
             }
             //subtree->type = CONS_TYPE;
+            if (car(tree)->type == OPENVECTOR_TYPE){
+                tree = cdr(tree);
+                tree = cons(makeVectorLiteral(subtree), tree);
+                return tree;
+            }
             tree = cdr(tree);
             tree = cons(subtree, tree);
             return tree;
 
         case OPEN_TYPE:
+        case OPENVECTOR_TYPE:
             (*depth)++;
             return tree;
         default:
             return tree;
     }
 }
-// Return a pointer to a parse tree representing the structure of a Scheme 
-// program, given a list of tokens in the program.
-Value *parse(Value *tokens){
-    
-    assert(tokens != NULL && "Error (parse): null pointer");
-
+// Parse the tokens, sharing the lists inside quote forms through pool. Kept
+// apart from parse so the setjmp there does not slow this loop.
+Value *parsePooled(Value *tokens, ConstantPool *pool){
     Value *tree = makeNull();
     int depth = 0;
+    // Depth inside the outermost quote form being parsed, or 0
+    int quoteDepth = 0;
 
     Value *current = tokens; // linked list of tokens
 
     while (current->type != NULL_TYPE) {
         Value *token = car(current); // get Value token
-        
-        tree = addToParseTree(tree, token, &depth); 
+
+        if(token->type == OPEN_TYPE && quoteDepth == 0 && cdr(current)->type != NULL_TYPE &&
+            car(cdr(current))->type == SYMBOL_TYPE && !strcmp(car(cdr(current))->s, "quote")){
+            quoteDepth = depth + 1;
+        }
+        // Lists closing deeper than the quote form itself are its datum
+        bool quoted = quoteDepth != 0 && token->type == CLOSE_TYPE && depth > quoteDepth;
+        tree = addToParseTree(tree, token, &depth, quoted ? pool : NULL);
+        if(depth < quoteDepth){
+            quoteDepth = 0;
+        }
 
         current = cdr(current); // get next node in linked list
     }
 
     if (depth > 0) {
-        printf("Syntax error: too few close parens\n");
-        texit(0);
+        syntaxError("too few close parens");
     }
     else if (depth < 0){
-        printf("Syntax error: too many close parens\n");
-        texit(0);
+        syntaxError("too many close parens");
     }
     return reverse(tree);
 }
 
+// Return a pointer to a parse tree representing the structure of a Scheme 
+// program, given a list of tokens in the program.
+Value *parse(Value *tokens){
+    
+    assert(tokens != NULL && "Error (parse): null pointer");
+
+    // Lists inside quote forms are shared through the pool. The pool's table
+    // is freed on the way out, including when a syntax error is raised.
+    ConstantPool pool;
+    initConstantPool(&pool);
+    ErrorHandler handler;
+    pushErrorHandler(&handler);
+    if(setjmp(handler.jump) != 0){
+        freeConstantPool(&pool);
+        raiseValue(handler.raised);
+    }
+    Value *tree = parsePooled(tokens, &pool);
+    popErrorHandler(&handler);
+    freeConstantPool(&pool);
+    return tree;
+}
+
+//declare here to use in printVector
+void printTree(Value *tree);
+
+// Print an f64vector or s64vector in #f64( ... ) or #s64( ... ) notation,
+// without a trailing newline.
+void printNumericVector(Value *vector){
+    if(vector->type == F64VECTOR_TYPE){
+        writeString("#f64(");
+        for(int i = 0; i < vector->nv.size; i++){
+            writeDouble(vector->nv.f64[i]);
+            writeChar(' ');
+        }
+    } else {
+        writeString("#s64(");
+        for(int i = 0; i < vector->nv.size; i++){
+            writeInt(vector->nv.s64[i]);
+            writeChar(' ');
+        }
+    }
+    writeChar(')');
+}
+
+// Print a vector in #( ... ) notation, without a trailing newline. List
+// elements are stored wrapped, so printTree prints them with their parens.
+void printVector(Value *vector){
+    writeString("#(");
+    for(int i = 0; i < vector->v.size; i++){
+        Value *item = vector->v.items[i];
+        switch(item->type){
+            case CONS_TYPE:
+                printTree(item);
+                break;
+            case INT_TYPE:
+            case BIGNUM_TYPE:
+                writeInteger(item);
+                writeChar(' ');
+                break;
+            case DOUBLE_TYPE:
+                writeDouble(item->d);
+                writeChar(' ');
+                break;
+            case STR_TYPE:
+                writeQuotedString(item);
+                writeChar(' ');
+                break;
+            case SYMBOL_TYPE:
+                writeString(item->s);
+                writeChar(' ');
+                break;
+            case BOOL_TYPE:
+                if(item->i == 1){
+                    writeString("#t ");
+                } else {
+                    writeString("#f ");
+                }
+                break;
+            case NULL_TYPE:
+                writeString("() ");
+                break;
+            case VECTOR_TYPE:
+                printVector(item);
+                writeChar(' ');
+                break;
+            case F64VECTOR_TYPE:
+            case S64VECTOR_TYPE:
+                printNumericVector(item);
+                writeChar(' ');
+                break;
+            default:
+                ;
+        }
+    }
+    writeChar(')');
+}
+
 // Print a parse tree to the screen in a readable fashion. 
 void printTree(Value *tree){
 
     while (tree->type != NULL_TYPE){
         switch(tree->c.car->type){
             case CONS_TYPE: // start of new subtree
-                printf("("); 
+                writeChar('(');
                 printTree(car(tree)); // call recursively
-                printf(") ");
+                writeString(") ");
                 break;
             case INT_TYPE:
-                printf("%i ", tree->c.car->i);
+            case BIGNUM_TYPE:
+                writeInteger(tree->c.car);
+                writeChar(' ');
                 break;
             case DOUBLE_TYPE:
-                printf("%f ", tree->c.car->d);
+                writeDouble(tree->c.car->d);
+                writeChar(' ');
                 break;
             case STR_TYPE:
-                printf("%s ", tree->c.car->s);
+                writeQuotedString(tree->c.car);
+                writeChar(' ');
+                break;
+            case DOT_TYPE:
+                writeString(". ");
                 break;
             case BOOL_TYPE:
                 if(tree->c.car->i == 1){
-                    printf("#t ");
+                    writeString("#t ");
                 } else {
-                    printf("#f ");
+                    writeString("#f ");
                 }
                 break;
             case SYMBOL_TYPE:
-                printf("%s ", tree->c.car->s);
+                writeString(tree->c.car->s);
+                writeChar(' ');
                 break;
             case NULL_TYPE:
-                printf("() ");
+                writeString("() ");
+                break;
+            case VECTOR_TYPE:
+                printVector(car(tree));
+                writeChar(' ');
+                break;
+            case F64VECTOR_TYPE:
+            case S64VECTOR_TYPE:
+                printNumericVector(car(tree));
+                writeChar(' ');
                 break;
             default:
                 ;
         }
         tree = cdr(tree);
     }
-    printf("\n");
+    writeChar('\n');
 }
 
 #endif
@@ -13,5 +13,13 @@ Value *parse(Value *tokens);
 // just like Scheme code (use parentheses to mark subtrees).
 void printTree(Value *tree);
 
+// Print a vector to the screen in #( ... ) notation, without a trailing
+// newline.
+void printVector(Value *vector);
+
+// Print an f64vector or s64vector to the screen in #f64( ... ) or
+// #s64( ... ) notation, without a trailing newline.
+void printNumericVector(Value *vector);
+
 
 #endif
@@ -0,0 +1,426 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include "value.h"
+
+#ifndef _PROFILER
+#define _PROFILER
+
+// Frames of each sample kept, innermost first; deeper stacks lose their
+// outermost frames
+#define SAMPLE_DEPTH 128
+// Shadow stack entries, past which calls go unrecorded. Each stack is mapped
+// lazily, so it only costs the pages a thread's calls reach.
+#define SHADOW_DEPTH 100000
+// Room in the sample log, in pointers; mapped lazily, so a short run only
+// touches the pages it needs
+#define SAMPLE_LOG_SIZE (16 * 1024 * 1024)
+
+// Whether samples are being taken
+static volatile sig_atomic_t profiling = 0;
+// Whether the shadow stack and procedure names are being kept
+static volatile sig_atomic_t tracking = 0;
+
+// Code of every closure this thread, or the green thread running on it, is
+// inside, outermost first. Mapped on the first call tracked on the thread.
+_Thread_local Value ** volatile shadowStack = NULL;
+_Thread_local volatile sig_atomic_t shadowDepth = 0;
+
+// The sample log, written only by the signal handler. Each sample is its
+// depth followed by that many closure code pointers, innermost first. A depth
+// of SAMPLE_DEPTH + 1 marks a stack cut short.
+static Value **sampleLog = NULL;
+static volatile size_t sampleLogUsed = 0;
+static volatile long droppedSamples = 0;
+
+// Procedure names, keyed by closure code
+typedef struct ProcedureName {
+    Value *code;
+    char *name;
+    struct ProcedureName *next;
+} ProcedureName;
+
+#define NAME_BUCKETS 4096
+static ProcedureName *names[NAME_BUCKETS];
+// Held to add names, and to look them up while pool workers may be adding
+static pthread_rwlock_t namesLock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Per-procedure totals while building the report
+typedef struct ProcedureCount {
+    Value *code;
+    long self;
+    long total;
+    // Sample the total was last counted in, so recursion counts once
+    long lastSample;
+} ProcedureCount;
+
+// Hashes a code pointer into a table of the given power-of-two size
+size_t hashCode(Value *code, size_t size){
+    uintptr_t hash = (uintptr_t)code;
+    hash ^= hash >> 15;
+    hash *= 0x9e3779b97f4a7c15ULL;
+    return (hash >> 32) & (size - 1);
+}
+
+// Records the active stack in the sample log. Runs in the signal handler, so
+// it only reads and writes memory that is already there.
+void takeSample(int signal){
+    (void)signal;
+    Value **stack = shadowStack;
+    int depth = stack == NULL ? 0 : shadowDepth;
+    if(depth > SHADOW_DEPTH){
+        depth = SHADOW_DEPTH;
+    }
+    int kept = depth > SAMPLE_DEPTH ? SAMPLE_DEPTH : depth;
+    if(sampleLogUsed + kept + 1 > SAMPLE_LOG_SIZE){
+        droppedSamples++;
+        return;
+    }
+    size_t at = sampleLogUsed;
+    sampleLog[at] = (Value *)(uintptr_t)(depth > SAMPLE_DEPTH ? SAMPLE_DEPTH + 1 : kept);
+    for(int i = 0; i < kept; i++){
+        sampleLog[at + 1 + i] = stack[depth - 1 - i];
+    }
+    sampleLogUsed = at + kept + 1;
+}
+
+// Start sampling: every millisecond of CPU time, a SIGPROF handler records
+// the procedures that are active on the thread it interrupts.
+void profileStart(){
+    if(sampleLog == NULL){
+        sampleLog = mmap(NULL, sizeof(Value *) * SAMPLE_LOG_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(sampleLog == MAP_FAILED){
+            sampleLog = NULL;
+            fprintf(stderr, "Profiler error: cannot allocate the sample log\n");
+            return;
+        }
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = takeSample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+
+    profiling = 1;
+    tracking = 1;
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+// Stop sampling. The samples taken so far are kept for profileReport.
+void profileStop(){
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    signal(SIGPROF, SIG_IGN);
+    profiling = 0;
+}
+
+// Maps a shadow stack, or returns NULL if there is no memory for one
+Value **mapShadowStack(){
+    Value **stack = mmap(NULL, sizeof(Value *) * SHADOW_DEPTH, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return stack == MAP_FAILED ? NULL : stack;
+}
+
+// Note that closure is being entered or left. apply calls these around every
+// closure call; they return at once unless procedures are being tracked.
+void profileEnter(Value *closure){
+    if(!tracking){
+        return;
+    }
+    if(shadowStack == NULL){
+        shadowStack = mapShadowStack();
+        if(shadowStack == NULL){
+            return;
+        }
+    }
+    int depth = shadowDepth;
+    if(depth < SHADOW_DEPTH){
+        shadowStack[depth] = closure->cl.functionCode;
+    }
+    // The entry is in place before the handler can see the deeper stack
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    shadowDepth = depth + 1;
+}
+
+void profileLeave(){
+    if(!tracking || shadowStack == NULL || shadowDepth == 0){
+        return;
+    }
+    shadowDepth = shadowDepth - 1;
+}
+
+// Return how many closures are on this thread's shadow stack.
+int profileStackDepth(){
+    return shadowDepth;
+}
+
+// Forget the closures on this thread's shadow stack above depth, for when
+// evaluation was abandoned without leaving them.
+void profileUnwindStack(int depth){
+    if(shadowDepth > depth){
+        shadowDepth = depth;
+    }
+}
+
+// Make *stack, holding *depth closures, the shadow stack of this thread, and
+// store the one that was in place in *stack and *depth. Green threads keep
+// their own this way; a NULL stack is mapped when first needed.
+void profileSwapStack(Value ***stack, int *depth){
+    Value **previousStack = shadowStack;
+    int previousDepth = shadowDepth;
+    // The signal handler must never see the new stack with the old depth
+    shadowDepth = 0;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    shadowStack = *stack;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    shadowDepth = *depth;
+    *stack = previousStack;
+    *depth = previousDepth;
+}
+
+// Free a shadow stack from profileSwapStack that no thread uses any more.
+void profileFreeStack(Value **stack){
+    if(stack != NULL){
+        munmap(stack, sizeof(Value *) * SHADOW_DEPTH);
+    }
+}
+
+// Remember name as the name of closure's procedure, for reports. The first
+// name given to a procedure's code is the one kept.
+void profileName(Value *closure, char *name){
+    if(!tracking){
+        return;
+    }
+    Value *code = closure->cl.functionCode;
+    size_t bucket = hashCode(code, NAME_BUCKETS);
+    pthread_rwlock_wrlock(&namesLock);
+    for(ProcedureName *entry = names[bucket]; entry != NULL; entry = entry->next){
+        if(entry->code == code){
+            pthread_rwlock_unlock(&namesLock);
+            return;
+        }
+    }
+    ProcedureName *entry = malloc(sizeof(ProcedureName));
+    entry->code = code;
+    entry->name = strdup(name);
+    entry->next = names[bucket];
+    names[bucket] = entry;
+    pthread_rwlock_unlock(&namesLock);
+}
+
+// Keep the shadow stack and procedure names without sampling, for other
+// tools that attribute work to Scheme procedures.
+void profileTrackProcedures(){
+    tracking = 1;
+}
+
+// Return the code of the innermost closure this thread is inside, or NULL at
+// top level. Only meaningful while procedures are tracked.
+Value *profileCurrentProcedure(){
+    int depth = shadowDepth;
+    if(depth == 0 || shadowStack == NULL){
+        return NULL;
+    }
+    return shadowStack[(depth > SHADOW_DEPTH ? SHADOW_DEPTH : depth) - 1];
+}
+
+// Return the name recorded for the procedure with the given closure code, or
+// NULL if it was never named.
+char *profileProcedureName(Value *code){
+    char *name = NULL;
+    pthread_rwlock_rdlock(&namesLock);
+    for(ProcedureName *entry = names[hashCode(code, NAME_BUCKETS)]; entry != NULL; entry = entry->next){
+        if(entry->code == code){
+            name = entry->name;
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&namesLock);
+    return name;
+}
+
+// Writes the name of the procedure with the given code to stream
+void writeProcedureName(FILE *stream, Value *code){
+    char *name = profileProcedureName(code);
+    if(name != NULL){
+        fputs(name, stream);
+    } else {
+        fprintf(stream, "lambda@%p", (void *)code);
+    }
+}
+
+// Returns the count record for code, adding one if needed
+ProcedureCount *countFor(ProcedureCount *counts, size_t size, Value *code){
+    size_t index = hashCode(code, size);
+    while(counts[index].code != NULL && counts[index].code != code){
+        index = (index + 1) & (size - 1);
+    }
+    if(counts[index].code == NULL){
+        counts[index].code = code;
+        counts[index].lastSample = -1;
+    }
+    return &counts[index];
+}
+
+// Orders count records by self samples, then total, most first
+int compareSelf(const void *a, const void *b){
+    const ProcedureCount *x = a;
+    const ProcedureCount *y = b;
+    if(x->self != y->self){
+        return x->self < y->self ? 1 : -1;
+    }
+    return (x->total < y->total) - (x->total > y->total);
+}
+
+// Orders count records by total samples, most first
+int compareTotal(const void *a, const void *b){
+    const ProcedureCount *x = a;
+    const ProcedureCount *y = b;
+    return (x->total < y->total) - (x->total > y->total);
+}
+
+// Writes the sample starting at index at to stream as one collapsed stack,
+// without its count
+void writeCollapsed(FILE *stream, size_t at){
+    int depth = (int)(uintptr_t)sampleLog[at];
+    int kept = depth > SAMPLE_DEPTH ? SAMPLE_DEPTH : depth;
+    if(depth > SAMPLE_DEPTH){
+        fputs("[truncated];", stream);
+    }
+    if(kept == 0){
+        fputs("[top level]", stream);
+    }
+    for(int i = kept - 1; i >= 0; i--){
+        writeProcedureName(stream, sampleLog[at + 1 + i]);
+        if(i > 0){
+            fputc(';', stream);
+        }
+    }
+}
+
+// Returns whether the samples starting at a and b hold the same stack
+bool sameSample(size_t a, size_t b){
+    int depth = (int)(uintptr_t)sampleLog[a];
+    int kept = depth > SAMPLE_DEPTH ? SAMPLE_DEPTH : depth;
+    return sampleLog[a] == sampleLog[b]
+        && !memcmp(&sampleLog[a + 1], &sampleLog[b + 1], sizeof(Value *) * kept);
+}
+
+// Print a flat profile (samples in each procedure itself) and a cumulative
+// one (samples with the procedure anywhere on the stack) to stream. When
+// stacksPath is not NULL, also write every sampled stack to that file in
+// the collapsed format that flame graph tools read: procedure names from
+// outermost to innermost, separated by semicolons, then a sample count.
+void profileReport(FILE *stream, char *stacksPath){
+    size_t used = sampleLogUsed;
+    long samples = 0;
+    size_t size = 1024;
+    ProcedureCount *counts = calloc(size, sizeof(ProcedureCount));
+    size_t distinct = 0;
+    long topLevel = 0;
+
+    for(size_t at = 0; at < used; samples++){
+        int depth = (int)(uintptr_t)sampleLog[at];
+        int kept = depth > SAMPLE_DEPTH ? SAMPLE_DEPTH : depth;
+        if(kept == 0){
+            topLevel++;
+        }
+        for(int i = 0; i < kept; i++){
+            if((distinct + 1) * 2 > size){
+                // Grow the table, keeping every record
+                ProcedureCount *old = counts;
+                size_t oldSize = size;
+                size *= 2;
+                counts = calloc(size, sizeof(ProcedureCount));
+                for(size_t j = 0; j < oldSize; j++){
+                    if(old[j].code != NULL){
+                        *countFor(counts, size, old[j].code) = old[j];
+                    }
+                }
+                free(old);
+            }
+            ProcedureCount *count = countFor(counts, size, sampleLog[at + 1 + i]);
+            if(count->self == 0 && count->total == 0){
+                distinct++;
+            }
+            if(i == 0){
+                count->self++;
+            }
+            if(count->lastSample != samples){
+                count->total++;
+                count->lastSample = samples;
+            }
+        }
+        at += kept + 1;
+    }
+
+    ProcedureCount *sorted = malloc(sizeof(ProcedureCount) * (distinct + 1));
+    size_t n = 0;
+    for(size_t i = 0; i < size; i++){
+        if(counts[i].code != NULL){
+            sorted[n++] = counts[i];
+        }
+    }
+
+    fprintf(stream, "Profile: %ld samples, 1 ms each", samples);
+    if(droppedSamples > 0){
+        fprintf(stream, " (%ld more dropped)", (long)droppedSamples);
+    }
+    fprintf(stream, "\n\nFlat profile:\n%8s %7s  %s\n", "self", "%", "procedure");
+    qsort(sorted, n, sizeof(ProcedureCount), compareSelf);
+    for(size_t i = 0; i < n && sorted[i].self > 0; i++){
+        fprintf(stream, "%8ld %6.2f%%  ", sorted[i].self, 100.0 * sorted[i].self / samples);
+        writeProcedureName(stream, sorted[i].code);
+        fputc('\n', stream);
+    }
+    if(topLevel > 0){
+        fprintf(stream, "%8ld %6.2f%%  [top level]\n", topLevel, 100.0 * topLevel / samples);
+    }
+
+    fprintf(stream, "\nCumulative profile:\n%8s %7s  %s\n", "total", "%", "procedure");
+    qsort(sorted, n, sizeof(ProcedureCount), compareTotal);
+    for(size_t i = 0; i < n; i++){
+        fprintf(stream, "%8ld %6.2f%%  ", sorted[i].total, 100.0 * sorted[i].total / samples);
+        writeProcedureName(stream, sorted[i].code);
+        fputc('\n', stream);
+    }
+    free(sorted);
+    free(counts);
+
+    if(stacksPath != NULL){
+        FILE *stacks = fopen(stacksPath, "w");
+        if(stacks == NULL){
+            perror("Profiler error: cannot write stacks");
+            return;
+        }
+        // Runs of identical samples share one line
+        size_t at = 0;
+        while(at < used){
+            size_t next = at;
+            long run = 0;
+            while(next < used && sameSample(at, next)){
+                int depth = (int)(uintptr_t)sampleLog[next];
+                next += (depth > SAMPLE_DEPTH ? SAMPLE_DEPTH : depth) + 1;
+                run++;
+            }
+            writeCollapsed(stacks, at);
+            fprintf(stacks, " %ld\n", run);
+            at = next;
+        }
+        fclose(stacks);
+    }
+}
+
+#endif
@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include "value.h"
+
+#ifndef _PROFILER
+#define _PROFILER
+
+// Start sampling: every millisecond of CPU time, a SIGPROF handler records
+// the procedures that are active on the thread it interrupts.
+void profileStart();
+
+// Stop sampling. The samples taken so far are kept for profileReport.
+void profileStop();
+
+// Note that closure is being entered or left. apply calls these around every
+// closure call; they return at once unless procedures are being tracked.
+void profileEnter(Value *closure);
+void profileLeave();
+
+// Return how many closures are on this thread's shadow stack.
+int profileStackDepth();
+
+// Forget the closures on this thread's shadow stack above depth, for when
+// evaluation was abandoned without leaving them.
+void profileUnwindStack(int depth);
+
+// Make *stack, holding *depth closures, the shadow stack of this thread, and
+// store the one that was in place in *stack and *depth. Green threads keep
+// their own this way; a NULL stack is mapped when first needed.
+void profileSwapStack(Value ***stack, int *depth);
+
+// Free a shadow stack from profileSwapStack that no thread uses any more.
+void profileFreeStack(Value **stack);
+
+// Remember name as the name of closure's procedure, for reports. The first
+// name given to a procedure's code is the one kept.
+void profileName(Value *closure, char *name);
+
+// Keep the shadow stack and procedure names without sampling, for other
+// tools that attribute work to Scheme procedures.
+void profileTrackProcedures();
+
+// Return the code of the innermost closure this thread is inside, or NULL at
+// top level. Only meaningful while procedures are tracked.
+Value *profileCurrentProcedure();
+
+// Return the name recorded for the procedure with the given closure code, or
+// NULL if it was never named.
+char *profileProcedureName(Value *code);
+
+// Print a flat profile (samples in each procedure itself) and a cumulative
+// one (samples with the procedure anywhere on the stack) to stream. When
+// stacksPath is not NULL, also write every sampled stack to that file in
+// the collapsed format that flame graph tools read: procedure names from
+// outermost to innermost, separated by semicolons, then a sample count.
+void profileReport(FILE *stream, char *stacksPath);
+
+#endif
@@ -0,0 +1,70 @@
+#include <stdbool.h>
+#include "value.h"
+#include "talloc.h"
+#include "interpreter.h"
+#include "error.h"
+#include "seal.h"
+
+#ifndef _PROMISE
+#define _PROMISE
+
+// Return a new unforced PROMISE_TYPE Value for code, to be evaluated in frame
+// when first forced. If chained, code must evaluate to another promise,
+// whose value becomes this one's, as with delay-force; otherwise code's value
+// is the promise's value, as with delay.
+Value *makePromise(Value *code, Frame *frame, bool chained){
+    Promise *state = talloc(sizeof(Promise));
+    state->forced = false;
+    state->chained = chained;
+    state->value = NULL;
+    state->code = code;
+    state->frame = frame;
+    Value *promise = talloc(sizeof(Value));
+    promise->type = PROMISE_TYPE;
+    promise->pr = state;
+    return promise;
+}
+
+// Return a new promise already forced to value.
+Value *makeForcedPromise(Value *value){
+    Value *promise = makePromise(NULL, NULL, false);
+    promise->pr->forced = true;
+    promise->pr->value = value;
+    return promise;
+}
+
+// Return the value of a promise, forcing it first if needed. The value is
+// remembered, so the expression is evaluated at most once. A chain of
+// delay-force promises is forced iteratively, without growing the C stack.
+Value *forcePromise(Value *promise){
+    while(!promise->pr->forced){
+        checkUnsealed(promise, "force a promise made");
+        Promise *state = promise->pr;
+        Value *result = eval(state->code, state->frame);
+        if(state->forced){
+            // Evaluating the expression forced this promise already, and
+            // that first result stands
+            continue;
+        }
+        if(!state->chained){
+            state->forced = true;
+            state->value = result;
+        } else {
+            if(result->type != PROMISE_TYPE){
+                evaluationError("delay-force expression must return a promise");
+            }
+            // Take over the inner promise's state, then share it with the
+            // inner promise so forcing either one finishes both
+            checkUnsealed(result, "force a promise made");
+            *state = *result->pr;
+            result->pr = state;
+        }
+    }
+    Promise *state = promise->pr;
+    // The expression and its frame are no longer needed
+    state->code = NULL;
+    state->frame = NULL;
+    return state->value;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#include <stdbool.h>
+#include "value.h"
+
+#ifndef _PROMISE
+#define _PROMISE
+
+// Return a new unforced PROMISE_TYPE Value for code, to be evaluated in frame
+// when first forced. If chained, code must evaluate to another promise,
+// whose value becomes this one's, as with delay-force; otherwise code's value
+// is the promise's value, as with delay.
+Value *makePromise(Value *code, Frame *frame, bool chained);
+
+// Return a new promise already forced to value.
+Value *makeForcedPromise(Value *value);
+
+// Return the value of a promise, forcing it first if needed. The value is
+// remembered, so the expression is evaluated at most once. A chain of
+// delay-force promises is forced iteratively, without growing the C stack.
+Value *forcePromise(Value *promise);
+
+#endif
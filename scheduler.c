@@ -0,0 +1,424 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "value.h"
+#include "talloc.h"
+#include "linkedlist.h"
+#include "interpreter.h"
+#include "error.h"
+#include "output.h"
+#include "seal.h"
+
+#ifndef _SCHEDULER
+#define _SCHEDULER
+
+// Number of chunks parallelApply aims to give each worker, so that threads
+// that finish early have something left to steal
+#define CHUNKS_PER_WORKER 4
+
+// A unit of work. A future's task applies function to no arguments; a chunk
+// of parallelApply applies it to each of items[start..end). Tasks are
+// malloc'd, never talloc'd, so nothing the submitting thread releases or
+// unwinds can free one that is still running.
+typedef struct Task {
+    Value *function;
+    Value **items;
+    Value **results;
+    int start;
+    int end;
+    // Output stream of the interpreter that submitted the task
+    FILE *output;
+    // What the submitting form had used of its limits, see swapEvalBudget
+    EvalBudget budget;
+    // Count of unfinished tasks this one is part of, see submittedBy
+    atomic_int *submitted;
+    // Holders of a future's task: the thread running it, the future until
+    // it is first touched, and each thread waiting in touchFuture. The last
+    // one to let go frees it.
+    atomic_int references;
+    Value *result;
+    // The value raised by the task, or NULL if it finished normally
+    Value *error;
+    // Active list of everything the task allocated, handed to whoever
+    // collects the result
+    _Atomic(void *) heap;
+    atomic_bool done;
+} Task;
+
+// A worker's queue of tasks. The owner pushes and pops at the bottom, so it
+// works on its newest tasks first; other threads steal from the top, taking
+// the oldest and usually largest pieces of work.
+typedef struct Deque {
+    pthread_mutex_t lock;
+    Task **tasks;
+    int top;
+    int size;
+    int capacity;
+} Deque;
+
+Deque *deques = NULL;
+int workerCount = 0;
+pthread_once_t poolStarted = PTHREAD_ONCE_INIT;
+
+// Tasks queued but not yet taken, and where idle workers sleep until there are some
+atomic_int pendingTasks;
+// Tasks taken but not yet done
+atomic_int runningTasks;
+pthread_mutex_t idleLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t idleWakeup = PTHREAD_COND_INITIALIZER;
+
+// Held while a future's fields are read or its outcome is stored into it
+pthread_mutex_t touchLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Round-robin position for tasks submitted from threads that are not workers
+atomic_int nextDeque;
+
+// Index of the calling thread's deque, or -1 on threads outside the pool
+_Thread_local int workerIndex = -1;
+_Thread_local unsigned int stealSeed = 1;
+
+// Unfinished tasks submitted by the calling thread, outside of any task. A
+// task counts the tasks it submits along with itself, in the count of
+// whoever submitted it, so waitForSubmittedTasks also waits for futures
+// started by futures.
+_Thread_local atomic_int ownTasks;
+// The count that tasks submitted right now go into, or NULL for ownTasks
+_Thread_local atomic_int *submittedBy = NULL;
+
+// Pushes a task onto the bottom of a deque
+void pushTask(Deque *deque, Task *task){
+    pthread_mutex_lock(&deque->lock);
+    if(deque->size == deque->capacity){
+        int capacity = deque->capacity * 2 + 16;
+        Task **tasks = malloc(sizeof(Task *) * capacity);
+        for(int i = 0; i < deque->size; i++){
+            tasks[i] = deque->tasks[(deque->top + i) % deque->capacity];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->top = 0;
+        deque->capacity = capacity;
+    }
+    deque->tasks[(deque->top + deque->size) % deque->capacity] = task;
+    deque->size++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+// Takes the newest task from the bottom of the calling worker's own deque
+Task *popTask(Deque *deque){
+    Task *task = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if(deque->size > 0){
+        deque->size--;
+        task = deque->tasks[(deque->top + deque->size) % deque->capacity];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+// Takes the oldest task from the top of another thread's deque
+Task *stealTask(Deque *deque){
+    Task *task = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if(deque->size > 0){
+        task = deque->tasks[deque->top];
+        deque->top = (deque->top + 1) % deque->capacity;
+        deque->size--;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+// Finds a task for the calling thread: its own newest one if it is a worker,
+// otherwise one stolen from a deque picked at random
+Task *findTask(){
+    Task *task = NULL;
+    if(workerIndex >= 0){
+        task = popTask(&deques[workerIndex]);
+    }
+    if(task == NULL){
+        stealSeed = stealSeed * 1103515245 + 12345;
+        int first = (stealSeed >> 16) % workerCount;
+        for(int i = 0; i < workerCount && task == NULL; i++){
+            int victim = (first + i) % workerCount;
+            if(victim != workerIndex){
+                task = stealTask(&deques[victim]);
+            }
+        }
+    }
+    if(task != NULL){
+        // Counted as running before it stops counting as pending, so poolBusy
+        // never sees neither
+        atomic_fetch_add(&runningTasks, 1);
+        atomic_fetch_sub(&pendingTasks, 1);
+    }
+    return task;
+}
+
+// Drops one reference to a future's task, freeing it with the last one
+void releaseTask(Task *task){
+    if(atomic_fetch_sub(&task->references, 1) == 1){
+        free(task);
+    }
+}
+
+// Runs a task on the calling thread. Its allocations go to a fresh active
+// list, so the result outlives the thread's own work and can be handed over.
+// Its output goes to the stream of the interpreter that submitted it, and it
+// is held to what the submitting form had left of its limits. An error, or a
+// limit run past, stops the task and is kept for whoever collects the result.
+void runTask(Task *task){
+    void *previous = tswap(NULL);
+    FILE *previousOutput = currentOutput();
+    outputSetStream(task->output);
+    atomic_int *previousSubmitted = submittedBy;
+    submittedBy = task->submitted;
+    EvalBudget previousBudget = swapEvalBudget(task->budget);
+    Value *raised = NULL;
+    if(task->items == NULL){
+        task->result = applyCatchingLimits(task->function, makeNull(), &raised);
+    } else {
+        Value *end = makeNull();
+        Value *callArgs = cons(end, end);
+        for(int i = task->start; i < task->end && raised == NULL; i++){
+            callArgs->c.car = task->items[i];
+            task->results[i] = applyCatchingLimits(task->function, callArgs, &raised);
+        }
+    }
+    task->error = raised;
+    swapEvalBudget(previousBudget);
+    submittedBy = previousSubmitted;
+    outputSetStream(previousOutput);
+    atomic_store(&task->heap, tswap(previous));
+    // parallelApply may free a chunk as soon as it is done, so whatever is
+    // needed from the task is read before
+    bool future = task->items == NULL;
+    atomic_int *submitted = task->submitted;
+    atomic_store_explicit(&task->done, true, memory_order_release);
+    if(future){
+        releaseTask(task);
+    }
+    atomic_fetch_sub(&runningTasks, 1);
+    atomic_fetch_sub(submitted, 1);
+}
+
+// Worker thread: runs tasks, sleeping while there are none
+void *worker(void *arg){
+    workerIndex = (int)(long)arg;
+    stealSeed = workerIndex + 1;
+    while(1){
+        Task *task = findTask();
+        if(task != NULL){
+            runTask(task);
+            continue;
+        }
+        pthread_mutex_lock(&idleLock);
+        while(atomic_load(&pendingTasks) == 0){
+            pthread_cond_wait(&idleWakeup, &idleLock);
+        }
+        pthread_mutex_unlock(&idleLock);
+    }
+    return NULL;
+}
+
+// Starts the worker pool, once per process
+void startPool(){
+    workerCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(workerCount < 1){
+        workerCount = 1;
+    }
+    atomic_init(&pendingTasks, 0);
+    atomic_init(&runningTasks, 0);
+    atomic_init(&nextDeque, 0);
+    deques = malloc(sizeof(Deque) * workerCount);
+    for(int i = 0; i < workerCount; i++){
+        pthread_mutex_init(&deques[i].lock, NULL);
+        deques[i].tasks = NULL;
+        deques[i].top = 0;
+        deques[i].size = 0;
+        deques[i].capacity = 0;
+    }
+    for(int i = 0; i < workerCount; i++){
+        pthread_t thread;
+        pthread_create(&thread, NULL, worker, (void *)(long)i);
+        pthread_detach(thread);
+    }
+}
+
+// Queues tasks on the calling worker's deque, or spreads them over the
+// workers' deques when called from outside the pool, then wakes idle workers
+void submitTasks(Task **tasks, int count){
+    pthread_once(&poolStarted, startPool);
+    for(int i = 0; i < count; i++){
+        int target = workerIndex;
+        if(target < 0){
+            target = atomic_fetch_add(&nextDeque, 1) % workerCount;
+        }
+        atomic_fetch_add(tasks[i]->submitted, 1);
+        pushTask(&deques[target], tasks[i]);
+    }
+    atomic_fetch_add(&pendingTasks, count);
+    pthread_mutex_lock(&idleLock);
+    pthread_cond_broadcast(&idleWakeup);
+    pthread_mutex_unlock(&idleLock);
+}
+
+// Waits for a task to finish, running other tasks in the meantime so that
+// tasks waiting on tasks cannot starve the pool
+void waitForTask(Task *task){
+    while(!atomic_load_explicit(&task->done, memory_order_acquire)){
+        Task *other = findTask();
+        if(other != NULL){
+            runTask(other);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+// Fills in a task with nothing to do yet
+void initTask(Task *task, Value *function){
+    task->function = function;
+    task->items = NULL;
+    task->results = NULL;
+    task->start = 0;
+    task->end = 0;
+    task->output = currentOutput();
+    task->budget = evalBudget();
+    task->submitted = submittedBy != NULL ? submittedBy : &ownTasks;
+    atomic_init(&task->references, 1);
+    task->result = NULL;
+    task->error = NULL;
+    atomic_init(&task->heap, NULL);
+    atomic_init(&task->done, false);
+}
+
+// Start evaluating a thunk (a closure of no arguments) on the worker pool and
+// return a FUTURE_TYPE Value for its result. The pool is started on first use
+// with one worker per online CPU. The thunk must not mutate state it shares
+// with other threads. Its output goes to the calling thread's output stream.
+// A future that is never touched keeps its task and everything the task
+// allocated until the process exits.
+Value *makeFuture(Value *thunk){
+    Task *task = malloc(sizeof(Task));
+    initTask(task, thunk);
+    // One reference for the worker and one for the future
+    atomic_init(&task->references, 2);
+    Value *future = talloc(sizeof(Value));
+    future->type = FUTURE_TYPE;
+    future->fu.task = task;
+    future->fu.result = NULL;
+    future->fu.error = NULL;
+    submitTasks(&task, 1);
+    return future;
+}
+
+// Return the result of a future, waiting for it if needed. A thread waiting
+// here runs other queued tasks in the meantime. Everything the future's
+// evaluation allocated moves onto the talloc heap of the first thread to
+// touch it, and the task itself is freed. If the evaluation raised an error,
+// touching raises it again.
+Value *touchFuture(Value *future){
+    pthread_mutex_lock(&touchLock);
+    Task *task = future->fu.task;
+    bool sealed = task != NULL && isSealed(future);
+    if(task != NULL && !sealed){
+        atomic_fetch_add(&task->references, 1);
+    }
+    pthread_mutex_unlock(&touchLock);
+    if(sealed){
+        // The first touch stores the outcome into the future
+        checkUnsealed(future, "touch a future started");
+    }
+
+    if(task != NULL){
+        waitForTask(task);
+        pthread_mutex_lock(&touchLock);
+        if(future->fu.task == task){
+            tadopt(atomic_exchange(&task->heap, NULL));
+            future->fu.result = task->result;
+            future->fu.error = task->error;
+            future->fu.task = NULL;
+            releaseTask(task);
+        }
+        pthread_mutex_unlock(&touchLock);
+        releaseTask(task);
+    }
+
+    pthread_mutex_lock(&touchLock);
+    Value *result = future->fu.result;
+    Value *error = future->fu.error;
+    pthread_mutex_unlock(&touchLock);
+    if(error != NULL){
+        raiseError(error);
+    }
+    return result;
+}
+
+// Apply function to each of count items in parallel, storing the result for
+// items[i] in results[i]. The items are split into chunks that the workers
+// and the calling thread share out by work stealing. Returns once every
+// result is in; everything the calls allocated moves onto the calling
+// thread's talloc heap. If any call raised an error, the first one raised
+// among the chunks is raised again once all of them are done.
+void parallelApply(Value *function, Value **items, Value **results, int count){
+    if(count == 0){
+        return;
+    }
+    pthread_once(&poolStarted, startPool);
+    int chunks = workerCount * CHUNKS_PER_WORKER;
+    if(chunks > count){
+        chunks = count;
+    }
+    Task *tasks = malloc(sizeof(Task) * chunks);
+    Task **queued = malloc(sizeof(Task *) * chunks);
+    for(int i = 0; i < chunks; i++){
+        initTask(&tasks[i], function);
+        tasks[i].items = items;
+        tasks[i].results = results;
+        tasks[i].start = (int)((long)count * i / chunks);
+        tasks[i].end = (int)((long)count * (i + 1) / chunks);
+        queued[i] = &tasks[i];
+    }
+    submitTasks(queued, chunks);
+    Value *error = NULL;
+    for(int i = 0; i < chunks; i++){
+        waitForTask(&tasks[i]);
+        tadopt(atomic_load(&tasks[i].heap));
+        if(error == NULL){
+            error = tasks[i].error;
+        }
+    }
+    free(queued);
+    free(tasks);
+    if(error != NULL){
+        raiseError(error);
+    }
+}
+
+// Wait until every task submitted from the calling thread is done, including
+// the futures those tasks started in turn, running queued tasks in the
+// meantime. Call it before freeing the heap the tasks' closures live on; a
+// future that never finishes makes it wait forever.
+void waitForSubmittedTasks(){
+    while(atomic_load(&ownTasks) > 0){
+        Task *other = findTask();
+        if(other != NULL){
+            runTask(other);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+// Return whether any task is queued or running. The closures tasks run live
+// on the heap of the thread that submitted them, so that heap must not be
+// freed while this is true.
+bool poolBusy(){
+    return atomic_load(&pendingTasks) + atomic_load(&runningTasks) > 0;
+}
+
+#endif
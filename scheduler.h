@@ -0,0 +1,39 @@
+#include <stdbool.h>
+#include "value.h"
+
+#ifndef _SCHEDULER
+#define _SCHEDULER
+
+// Start evaluating a thunk (a closure of no arguments) on the worker pool and
+// return a FUTURE_TYPE Value for its result. The pool is started on first use
+// with one worker per online CPU. The thunk must not mutate state it shares
+// with other threads. Its output goes to the calling thread's output stream.
+// A future that is never touched keeps its task and everything the task
+// allocated until the process exits.
+Value *makeFuture(Value *thunk);
+
+// Return the result of a future, waiting for it if needed. A thread waiting
+// here runs other queued tasks in the meantime. Everything the future's
+// evaluation allocated moves onto the talloc heap of the first thread to
+// touch it, and the task itself is freed.
+Value *touchFuture(Value *future);
+
+// Apply function to each of count items in parallel, storing the result for
+// items[i] in results[i]. The items are split into chunks that the workers
+// and the calling thread share out by work stealing. Returns once every
+// result is in; everything the calls allocated moves onto the calling
+// thread's talloc heap.
+void parallelApply(Value *function, Value **items, Value **results, int count);
+
+// Wait until every task submitted from the calling thread is done, including
+// the futures those tasks started in turn, running queued tasks in the
+// meantime. Call it before freeing the heap the tasks' closures live on; a
+// future that never finishes makes it wait forever.
+void waitForSubmittedTasks();
+
+// Return whether any task is queued or running. The closures tasks run live
+// on the heap of the thread that submitted them, so that heap must not be
+// freed while this is true.
+bool poolBusy();
+
+#endif
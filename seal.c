@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "value.h"
+#include "error.h"
+
+#ifndef _SEAL
+#define _SEAL
+
+// Slots the sealed set starts with; always a power of two
+#define SEALED_CAPACITY 1024
+
+// Open-addressing set of the addresses of sealed Values and Frames. Filled in
+// before requests are served and only read afterwards, so threads share it
+// without locking.
+static void **sealedObjects = NULL;
+static size_t sealedCapacity = 0;
+static size_t sealedCount = 0;
+
+// Returns the first slot of an address's probe sequence
+size_t sealedSlot(void *object, size_t capacity){
+    uint64_t hash = (uint64_t)(uintptr_t)object * 11400714819323198485ULL;
+    return (hash ^ (hash >> 32)) & (capacity - 1);
+}
+
+// Puts an address into the first free slot of its probe sequence
+void placeSealed(void **slots, size_t capacity, void *object){
+    size_t slot = sealedSlot(object, capacity);
+    while(slots[slot] != NULL){
+        slot = (slot + 1) & (capacity - 1);
+    }
+    slots[slot] = object;
+}
+
+// Return whether object, a Value or Frame, has been sealed.
+bool isSealed(void *object){
+    if(sealedObjects == NULL){
+        return false;
+    }
+    size_t slot = sealedSlot(object, sealedCapacity);
+    while(sealedObjects[slot] != NULL){
+        if(sealedObjects[slot] == object){
+            return true;
+        }
+        slot = (slot + 1) & (sealedCapacity - 1);
+    }
+    return false;
+}
+
+// Adds an address to the sealed set, doubling the set when it is half full.
+// Returns false if it was there already.
+bool addSealed(void *object){
+    if(isSealed(object)){
+        return false;
+    }
+    if((sealedCount + 1) * 2 > sealedCapacity){
+        size_t capacity = sealedCapacity == 0 ? SEALED_CAPACITY : sealedCapacity * 2;
+        void **slots = calloc(capacity, sizeof(void *));
+        for(size_t i = 0; i < sealedCapacity; i++){
+            if(sealedObjects[i] != NULL){
+                placeSealed(slots, capacity, sealedObjects[i]);
+            }
+        }
+        free(sealedObjects);
+        sealedObjects = slots;
+        sealedCapacity = capacity;
+    }
+    placeSealed(sealedObjects, sealedCapacity, object);
+    sealedCount++;
+    return true;
+}
+
+// Objects still to be sealed. Frames are told apart from Values by a set low
+// bit, which the alignment of both leaves free.
+typedef struct SealStack {
+    uintptr_t *items;
+    size_t count;
+    size_t capacity;
+} SealStack;
+
+// Pushes a Value, or a Frame if frame, unless it is NULL
+void pushSeal(SealStack *stack, void *object, bool frame){
+    if(object == NULL){
+        return;
+    }
+    if(stack->count == stack->capacity){
+        stack->capacity = stack->capacity * 2 + 64;
+        stack->items = realloc(stack->items, sizeof(uintptr_t) * stack->capacity);
+    }
+    stack->items[stack->count++] = (uintptr_t)object | frame;
+}
+
+// Seals a Value and queues whatever it refers to
+void sealValue(SealStack *stack, Value *value){
+    if(!addSealed(value)){
+        return;
+    }
+    switch(value->type){
+        case CONS_TYPE:
+            pushSeal(stack, value->c.car, false);
+            pushSeal(stack, value->c.cdr, false);
+            break;
+        case CLOSURE_TYPE:
+            pushSeal(stack, value->cl.paramNames, false);
+            pushSeal(stack, value->cl.functionCode, false);
+            pushSeal(stack, value->cl.frame, true);
+            break;
+        case VECTOR_TYPE:
+            for(int i = 0; i < value->v.size; i++){
+                pushSeal(stack, value->v.items[i], false);
+            }
+            break;
+        case HASHTABLE_TYPE:
+            for(int i = 0; i < value->h->capacity; i++){
+                pushSeal(stack, value->h->entries[i].key, false);
+                pushSeal(stack, value->h->entries[i].value, false);
+            }
+            for(int i = 0; i < value->h->oldCapacity; i++){
+                pushSeal(stack, value->h->oldEntries[i].key, false);
+                pushSeal(stack, value->h->oldEntries[i].value, false);
+            }
+            break;
+        case PROMISE_TYPE:
+            pushSeal(stack, value->pr->value, false);
+            pushSeal(stack, value->pr->code, false);
+            pushSeal(stack, value->pr->frame, true);
+            break;
+        case FUTURE_TYPE:
+            pushSeal(stack, value->fu.result, false);
+            pushSeal(stack, value->fu.error, false);
+            break;
+        default:
+            break;
+    }
+}
+
+// Seals a Frame and queues its bindings and parent
+void sealFrame(SealStack *stack, Frame *frame){
+    if(!addSealed(frame)){
+        return;
+    }
+    pushSeal(stack, frame->bindings, false);
+    pushSeal(stack, frame->parent, true);
+}
+
+// Seal frame and every Value and Frame reachable from it. Meant to be called
+// once, before other threads use any of them.
+void sealReachable(Frame *frame){
+    SealStack stack = {NULL, 0, 0};
+    pushSeal(&stack, frame, true);
+    while(stack.count > 0){
+        uintptr_t item = stack.items[--stack.count];
+        if(item & 1){
+            sealFrame(&stack, (Frame *)(item & ~(uintptr_t)1));
+        } else {
+            sealValue(&stack, (Value *)item);
+        }
+    }
+    free(stack.items);
+}
+
+// Raise an evaluation error if object, a Value or Frame, has been sealed.
+// action completes "cannot ... before the server started taking requests".
+void checkUnsealed(void *object, const char *action){
+    if(isSealed(object)){
+        evaluationError("cannot %s before the server started taking requests", action);
+    }
+}
+
+#endif
@@ -0,0 +1,25 @@
+#include <stdbool.h>
+#include "value.h"
+
+#ifndef _SEAL
+#define _SEAL
+
+// Sealing protects a heap that outlives shorter-lived allocations made on top
+// of it, as the server's prelude heap outlives each request, whose
+// allocations are freed with trelease when it ends. Storing a request's value
+// into a prelude object would leave the object pointing at freed memory, so
+// once the prelude is sealed, every primitive that changes an object in
+// place refuses sealed ones with an evaluation error. Reading them is fine.
+
+// Seal frame and every Value and Frame reachable from it. Meant to be called
+// once, before other threads use any of them.
+void sealReachable(Frame *frame);
+
+// Return whether object, a Value or Frame, has been sealed.
+bool isSealed(void *object);
+
+// Raise an evaluation error if object, a Value or Frame, has been sealed.
+// action completes "cannot ... before the server started taking requests".
+void checkUnsealed(void *object, const char *action);
+
+#endif
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "value.h"
+#include "talloc.h"
+#include "linkedlist.h"
+#include "tokenizer.h"
+#include "parser.h"
+#include "interpreter.h"
+#include "seal.h"
+#include "scheduler.h"
+#include "greenthread.h"
+
+#ifndef _SERVER
+#define _SERVER
+
+// Evaluates the request on one accepted connection and writes the results
+// back to it. Everything the request allocates is freed at the end; the
+// sealed prelude heap under it cannot be made to point into that memory, and
+// nothing the request started may still be running on it. So the request's
+// futures are waited for, and its green threads that have not finished are
+// dropped, before the memory is freed.
+void serveRequest(int client, Frame *globalFrame){
+    void *mark = tmark();
+
+    FILE *input = fdopen(dup(client), "r");
+    if(input == NULL){
+        close(client);
+        return;
+    }
+    Frame *requestFrame = talloc(sizeof(Frame));
+    requestFrame->parent = globalFrame;
+    requestFrame->bindings = makeNull();
+
+    // Point stdout at the client for the length of the request, so results
+    // and error messages both go back to it through the usual output buffer.
+    // An error ends only the form that raised it.
+    fflush(stdout);
+    int savedStdout = dup(STDOUT_FILENO);
+    dup2(client, STDOUT_FILENO);
+    interpretStream(input, requestFrame);
+    waitForSubmittedTasks();
+    discardGreenThreads();
+    fclose(input);
+    fflush(stdout);
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+    close(client);
+
+    trelease(mark);
+}
+
+// Serve requests on a Unix domain socket at socketPath until the process is
+// killed. Each connection carries one request: the client writes Scheme
+// source and shuts down its side for writing, the server evaluates it in a
+// fresh child frame of globalFrame, writes back the printed results and
+// closes the connection. Everything the request allocated is freed before
+// the next one is accepted, so requests must not store new values into
+// anything made before serving started. define inside a request binds in its
+// own frame, which is fine. Everything reachable from globalFrame is sealed
+// (see seal.h) before the first request, so set! of a prelude variable,
+// vector-set! of a prelude vector, hash-table-set! of a prelude table and the
+// like are evaluation errors instead. Futures a request started are finished
+// before its reply is complete, touched or not; green threads it spawned that
+// have not finished by the end of the request never run. Returns nonzero if
+// the socket cannot be set up.
+int runServer(char *socketPath, Frame *globalFrame){
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(strlen(socketPath) >= sizeof(address.sun_path)){
+        fprintf(stderr, "Server error: socket path too long\n");
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listener < 0){
+        perror("Server error: socket");
+        return 1;
+    }
+    unlink(socketPath);
+    if(bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0){
+        perror("Server error: bind");
+        close(listener);
+        return 1;
+    }
+    if(listen(listener, 64) < 0){
+        perror("Server error: listen");
+        close(listener);
+        return 1;
+    }
+
+    // A client that hangs up early should not take the server down with it
+    signal(SIGPIPE, SIG_IGN);
+
+    sealReachable(globalFrame);
+
+    while(1){
+        int client = accept(listener, NULL, NULL);
+        if(client < 0){
+            continue;
+        }
+        serveRequest(client, globalFrame);
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,22 @@
+#include "value.h"
+
+#ifndef _SERVER
+#define _SERVER
+
+// Serve requests on a Unix domain socket at socketPath until the process is
+// killed. Each connection carries one request: the client writes Scheme
+// source and shuts down its side for writing, the server evaluates it in a
+// fresh child frame of globalFrame, writes back the printed results and
+// closes the connection. Everything the request allocated is freed before
+// the next one is accepted, so requests must not store new values into
+// anything made before serving started. define inside a request binds in its
+// own frame, which is fine. Everything reachable from globalFrame is sealed
+// (see seal.h) before the first request, so set! of a prelude variable,
+// vector-set! of a prelude vector, hash-table-set! of a prelude table and the
+// like are evaluation errors instead. Futures a request started are finished
+// before its reply is complete, touched or not; green threads it spawned that
+// have not finished by the end of the request never run. Returns nonzero if
+// the socket cannot be set up.
+int runServer(char *socketPath, Frame *globalFrame);
+
+#endif
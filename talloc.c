@@ -1,10 +1,14 @@
 #include <stdlib.h>
+#include <limits.h>
+#include <setjmp.h>
 #include "value.h"
 
 #ifndef _TALLOC
 #define _TALLOC
 
-Value *activeList = NULL;
+// Each thread has its own active list, see tswap
+_Thread_local Value *activeList = NULL;
+_Thread_local jmp_buf *exitHandler = NULL;
 
 // Create a new CONS_TYPE value node.
 Value *consTalloc(Value *newCar, Value *newCdr){
@@ -15,15 +19,82 @@ Value *consTalloc(Value *newCar, Value *newCdr){
     return consNode;
 }
 
+// Allocations made on this thread and the bytes they asked for, see tstats
+_Thread_local long allocationCount = 0;
+_Thread_local long allocationBytes = 0;
+
+// Value of allocationBytes past which heapLimitHandler is called, see
+// tsetHeapLimit
+_Thread_local long heapLimit = LONG_MAX;
+static void (*heapLimitHandler)() = NULL;
+
+// Allocation hooks, see tsetHooks
+static void (*allocatedHook)(void *block, size_t size, const char *site) = NULL;
+static void (*freedHook)(void *block) = NULL;
+
+// talloc with the name of the calling function attached, for the allocation
+// profiler. The talloc macro in talloc.h turns every call into one of these.
+void *tallocAt(size_t size, const char *site){
+    Value *newVal = malloc(size);
+    activeList = consTalloc(newVal, activeList);
+    allocationCount++;
+    allocationBytes += size;
+    if(allocatedHook != NULL){
+        allocatedHook(newVal, size, site);
+    }
+    if(allocationBytes > heapLimit){
+        heapLimit = LONG_MAX;
+        heapLimitHandler();
+    }
+    return newVal;
+}
+
 // Replacement for malloc that stores the pointers allocated. It should store
 // the pointers in a linked list, and you have license here to duplicate code
 // that you wrote for linkedlist.c. To be clear, don't actually call functions 
 // that are defined in linkedlist.h, because then you'll end up with circular
 // dependencies, since you'll be using talloc in linkedlist.c.
 void *talloc(size_t size){
-    Value *newVal = malloc(size);
-    activeList = consTalloc(newVal, activeList);
-    return newVal;
+    return tallocAt(size, "talloc");
+}
+
+// Have talloc call allocated with each new block, its size and the function
+// that asked for it, and have tfree and trelease call freed with each block
+// just before freeing it. Passing NULL for both turns the hooks off. Meant to
+// be set once at startup, before any other thread is running.
+void tsetHooks(void (*allocated)(void *block, size_t size, const char *site),
+        void (*freed)(void *block)){
+    allocatedHook = allocated;
+    freedHook = freed;
+}
+
+// Store how many times talloc has been called on this thread, and the total
+// bytes asked for, in count and bytes.
+void tstats(long *count, long *bytes){
+    *count = allocationCount;
+    *bytes = allocationBytes;
+}
+
+// Call exceeded once more than bytes have been allocated on this thread,
+// counting from now, or remove the limit if bytes is negative. exceeded is
+// called after the allocation that crossed the limit has been recorded, and
+// the limit is removed before it is called, so it may allocate or longjmp.
+void tsetHeapLimit(long bytes, void (*exceeded)()){
+    if(bytes < 0 || allocationBytes > LONG_MAX - bytes){
+        heapLimit = LONG_MAX;
+    } else {
+        heapLimit = allocationBytes + bytes;
+        heapLimitHandler = exceeded;
+    }
+}
+
+// Return how many more bytes may be allocated on this thread before the limit
+// set with tsetHeapLimit is passed, or -1 if there is no limit.
+long theapLimitLeft(){
+    if(heapLimit == LONG_MAX){
+        return -1;
+    }
+    return heapLimit > allocationBytes ? heapLimit - allocationBytes : 0;
 }
 
 // Free all pointers allocated by talloc, as well as whatever memory you
@@ -32,6 +103,9 @@ void *talloc(size_t size){
 void tfree(){
     while(activeList != NULL){
         Value *temp = activeList->c.cdr;
+        if(freedHook != NULL){
+            freedHook(activeList->c.car);
+        }
         free(activeList->c.car);
         free(activeList);
         activeList = temp;
@@ -39,13 +113,68 @@ void tfree(){
     activeList = NULL;
 }
 
+// Return a mark for everything talloc has handed out so far. Passing it to
+// trelease later frees exactly what was allocated after the mark.
+void *tmark(){
+    return activeList;
+}
+
+// Free every pointer allocated by talloc since the given mark was taken,
+// leaving older allocations alone. New allocations are pushed onto the front
+// of the active list, so they are exactly the nodes in front of the mark.
+void trelease(void *mark){
+    while(activeList != NULL && activeList != mark){
+        Value *temp = activeList->c.cdr;
+        if(freedHook != NULL){
+            freedHook(activeList->c.car);
+        }
+        free(activeList->c.car);
+        free(activeList);
+        activeList = temp;
+    }
+}
+
+// Make heap the active list talloc uses on this thread, and return the one
+// that was active before. Every thread starts with its own empty active
+// list, so threads never share allocations or contend for them.
+void *tswap(void *heap){
+    Value *previous = activeList;
+    activeList = heap;
+    return previous;
+}
+
+// Move every allocation on heap, an active list taken from another thread
+// with tswap, onto this thread's active list, so it is freed along with the
+// rest. heap must no longer be in use by its old owner.
+void tadopt(void *heap){
+    Value *last = heap;
+    if(last == NULL){
+        return;
+    }
+    while(last->c.cdr != NULL){
+        last = last->c.cdr;
+    }
+    last->c.cdr = activeList;
+    activeList = heap;
+}
+
+// Make texit on this thread jump to handler instead of ending the process,
+// or restore the default with NULL. texit still frees the thread's active
+// list first; the jump returns the status plus one from setjmp.
+void setExitHandler(jmp_buf *handler){
+    exitHandler = handler;
+}
+
 // Replacement for the C function 'exit' that consists of two lines: it calls
 // tfree before calling exit. It's useful to have later on, since you'll be able
 // to call it to clean up memory and exit your program whenever an error occurs.
 // Briefly look up exit to get a sense of what the 'status' parameter does.
 void texit(int status){
     tfree();
-    exit(0);
+    if(exitHandler != NULL){
+        longjmp(*exitHandler, status + 1);
+    }
+    exit(status);
 }
 
 #endif
\ No newline at end of file
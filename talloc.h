@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <setjmp.h>
 #include "value.h"
 
 #ifndef _TALLOC
@@ -11,11 +12,61 @@
 // dependencies, since you'll be using talloc in linkedlist.c.
 void *talloc(size_t size);
 
+// talloc with the name of the calling function attached, for the allocation
+// profiler. The talloc macro below turns every call into one of these.
+void *tallocAt(size_t size, const char *site);
+#define talloc(size) tallocAt((size), __func__)
+
+// Have talloc call allocated with each new block, its size and the function
+// that asked for it, and have tfree and trelease call freed with each block
+// just before freeing it. Passing NULL for both turns the hooks off. Meant to
+// be set once at startup, before any other thread is running.
+void tsetHooks(void (*allocated)(void *block, size_t size, const char *site),
+    void (*freed)(void *block));
+
+// Store how many times talloc has been called on this thread, and the total
+// bytes asked for, in count and bytes.
+void tstats(long *count, long *bytes);
+
+// Call exceeded once more than bytes have been allocated on this thread,
+// counting from now, or remove the limit if bytes is negative. exceeded is
+// called after the allocation that crossed the limit has been recorded, and
+// the limit is removed before it is called, so it may allocate or longjmp.
+void tsetHeapLimit(long bytes, void (*exceeded)());
+
+// Return how many more bytes may be allocated on this thread before the limit
+// set with tsetHeapLimit is passed, or -1 if there is no limit.
+long theapLimitLeft();
+
 // Free all pointers allocated by talloc, as well as whatever memory you
 // allocated for purposes of maintaining the active list. Hint: consider 
 // that talloc may be called again after tfree is called...
 void tfree();
 
+// Return a mark for everything talloc has handed out so far. Passing it to
+// trelease later frees exactly what was allocated after the mark.
+void *tmark();
+
+// Free every pointer allocated by talloc since the given mark was taken,
+// leaving older allocations alone. Marks must be released in the reverse
+// order they were taken.
+void trelease(void *mark);
+
+// Make heap the active list talloc uses on this thread, and return the one
+// that was active before. Every thread starts with its own empty active
+// list, so threads never share allocations or contend for them.
+void *tswap(void *heap);
+
+// Move every allocation on heap, an active list taken from another thread
+// with tswap, onto this thread's active list, so it is freed along with the
+// rest. heap must no longer be in use by its old owner.
+void tadopt(void *heap);
+
+// Make texit on this thread jump to handler instead of ending the process,
+// or restore the default with NULL. texit still frees the thread's active
+// list first; the jump returns the status plus one from setjmp.
+void setExitHandler(jmp_buf *handler);
+
 // Replacement for the C function 'exit' that consists of two lines: it calls
 // tfree before calling exit. It's useful to have later on, since you'll be able
 // to call it to clean up memory and exit your program whenever an error occurs.
@@ -0,0 +1,28 @@
+(define fact (lambda (n) (do ((i 1 (+ i 1)) (acc 1 (* acc i))) ((> i n) acc))))
+9223372036854775807
+(+ 9223372036854775807 1)
+(- -9223372036854775808 1)
+(* 4294967296 4294967296)
+(* -3037000500 3037000500)
+(- (+ 9223372036854775807 1) 1)
+(* 123456789012345678901234567890 -987654321098765432109876543210)
+(fact 30)
+(define big (fact 300))
+(define other (fact 280))
+(define product (* big other))
+product
+(= (/ product other) big)
+(/ product (* other 7))
+(modulo product 1000000007)
+(modulo (- 0 big) 1000000007)
+(/ big (fact 299))
+(/ (fact 40) 3)
+(/ 100000000000000000000 3)
+(modulo 100000000000000000000 -7)
+(< big product)
+(> (- 0 big) 5)
+(= (fact 25) (* (fact 24) 25))
+(string->number "-123456789012345678901234567890")
+(number->string (fact 25))
+(* 1.0 (fact 25))
+(/ big 0)
@@ -0,0 +1,15 @@
+(* 1.0 50000000000000000000)
+5e19
+6.02e23
+(/ 1.0 3)
+(* 1.0 2)
+0.1
+(+ 0.1 0.2)
+1e-7
+-2.5E-3
+1.5e-300
+(* 1.5 1e300)
+(* 1e200 1e200)
+(- 0.0 (* 1e200 1e200))
+12345678901234567890.0
+(+ 1 1e3)
@@ -0,0 +1,5 @@
+(define x 3)
+(car 5)
+(+ 7 7)
+(vector-ref (make-vector 2 0) 5)
+(+ x 1)
@@ -0,0 +1,12 @@
+;; Futures started in a do loop see the value the loop variable had when
+;; they were started, however late they run
+(define futures (make-vector 4 0))
+(do ((i 0 (+ i 1)))
+    ((= i 4))
+  (vector-set! futures i (future (* i 10))))
+(touch (vector-ref futures 0))
+(touch (vector-ref futures 3))
+(touch (vector-ref futures 0))
+(define failing (future (car 5)))
+(touch (vector-ref futures 1))
+(touch failing)
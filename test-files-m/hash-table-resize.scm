@@ -0,0 +1,30 @@
+(define t (make-hash-table))
+(define fill (lambda (from to) (do ((i from (+ i 1))) ((= i to) (hash-table-count t)) (hash-table-set! t i (* i i)))))
+(define drop (lambda (from to) (do ((i from (+ i 1))) ((= i to) (hash-table-count t)) (hash-table-delete! t i))))
+(define total (lambda (from to) (do ((i from (+ i 1)) (sum 0 (+ sum (hash-table-ref t i 0)))) ((= i to) sum))))
+(fill 0 100)
+(hash-table-ref t 99)
+(hash-table-ref t 0)
+(drop 0 10)
+(hash-table-ref t 5 (quote gone))
+(hash-table-set! t 5 500)
+(hash-table-ref t 5)
+(hash-table-set! t 50 -1)
+(hash-table-ref t 50)
+(drop 90 100)
+(total 0 100)
+(fill 100 300)
+(drop 100 300)
+(hash-table-count t)
+(total 0 300)
+(length (hash-table-keys t))
+(hash-table-set! t "key" 1)
+(hash-table-set! t (quote key) 2)
+(hash-table-ref t "key")
+(hash-table-ref t (quote key))
+(hash-table-count t)
+(hash-table-ref t 1000)
+(hash-table-ref t 1.5 0)
+(define sized (make-hash-table 1000))
+(hash-table-set! sized 1 2)
+(hash-table-count sized)
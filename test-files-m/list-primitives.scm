@@ -0,0 +1,26 @@
+(define nums (quote (1 2 3 4 5)))
+(length nums)
+(length (quote ()))
+(reverse nums)
+(reverse (quote ()))
+(append (quote (1 2)) (quote (3)) (quote ()) (quote (4 5)))
+(append)
+(append (quote ()) nums)
+(assoc 2 (quote ((1 one) (2 two))))
+(assoc "b" (quote (("a" 1) ("b" 2))))
+(assoc 3 (quote ((1 one) (2 two))))
+(map (lambda (x) (* x x)) nums)
+(map (lambda (x) x) (quote ()))
+(filter (lambda (x) (> x 2)) nums)
+(filter (lambda (x) #f) nums)
+(fold cons (quote ()) nums)
+(fold-left (lambda (acc x) (- acc x)) 0 nums)
+(fold-right (lambda (x acc) (- x acc)) 0 nums)
+(fold-right cons (quote ()) nums)
+(fold + 0 (quote ()))
+(length 5)
+(map car nums)
+(map 5 nums)
+(fold + 0)
+(assoc 1 (quote (1 2)))
+(length nums)
@@ -0,0 +1,38 @@
+(define iota (lambda (n) (do ((i n (- i 1)) (acc (quote ()) (cons i acc))) ((= i 0) acc))))
+(define f (lambda (n) (list->f64vector (iota n))))
+(define s (lambda (n) (list->s64vector (iota n))))
+(define last (lambda (n) (list->f64vector (reverse (iota n)))))
+(f64vector-sum (f 0))
+(f64vector-sum (f 1))
+(f64vector-sum (f 3))
+(f64vector-sum (f 13))
+(f64vector-sum (f 35))
+(f64vector-dot (f 7) (f 7))
+(f64vector-dot (f 17) (f 17))
+(f64vector->list (f64vector-add (f 5) (f 5)))
+(f64vector->list (f64vector-mul (f 9) (f 9)))
+(f64vector->list (f64vector-scale (f 6) 0.5))
+(f64vector->list (f64vector-prefix-sum (f 11)))
+(f64vector-max (f 13))
+(f64vector-min (last 13))
+(f64vector-max (f64vector 1 2 3 4 5 6 7 8 -1 99))
+(f64vector-min (f64vector 1 2 3 4 5 6 7 8 9 -99))
+(s64vector-sum (s 0))
+(s64vector-sum (s 3))
+(s64vector-sum (s 13))
+(s64vector-sum (s 35))
+(s64vector-dot (s 9) (s 9))
+(s64vector->list (s64vector-add (s 7) (s 7)))
+(s64vector->list (s64vector-mul (s 5) (s 5)))
+(s64vector->list (s64vector-scale (s 6) -3))
+(s64vector->list (s64vector-prefix-sum (s 9)))
+(s64vector-max (s 13))
+(s64vector-min (list->s64vector (reverse (iota 13))))
+(s64vector-max (s64vector 1 2 3 4 5 6 7 8 -1 99))
+(s64vector-min (s64vector 1 2 3 4 5 6 7 8 9 -99))
+(s64vector-sum (s64vector 1 2 3 4 5 9223372036854775807))
+(s64vector->list (s64vector-add (s64vector 1 2 3 4 5) (s64vector 0 0 0 0 9223372036854775807)))
+(s64vector->list (s64vector-prefix-sum (s64vector 1 1 1 1 9223372036854775807)))
+(f64vector-add (f 5) (f 6))
+(s64vector-min (s 0))
+(f64vector-ref (f 5) 5)
@@ -0,0 +1,27 @@
+;; Promises made in a do loop or named let keep the value each iteration
+;; had, not the value the loop variable ends with
+(define promises (make-vector 3 0))
+(do ((i 0 (+ i 1)))
+    ((= i 3))
+  (vector-set! promises i (delay i)))
+(force (vector-ref promises 0))
+(force (vector-ref promises 2))
+
+(define chained (make-vector 3 0))
+(do ((i 0 (+ i 1)))
+    ((= i 3))
+  (vector-set! chained i (delay-force (make-promise (* i 10)))))
+(force (vector-ref chained 0))
+(force (vector-ref chained 1))
+
+(define streams (make-vector 3 0))
+(do ((i 0 (+ i 1)))
+    ((= i 3))
+  (vector-set! streams i (cons-stream i (+ i 100))))
+(stream-car (vector-ref streams 0))
+(stream-cdr (vector-ref streams 0))
+
+(let loop ((k 0) (acc (quote ())))
+  (if (= k 3)
+      (force (car (cdr (cdr acc))))
+      (loop (+ k 1) (cons (delay k) acc))))
@@ -0,0 +1,43 @@
+(define s "hello world")
+(string-length s)
+(string-length "")
+(string-append "foo" "" "bar" "baz")
+(string-append)
+(substring s 6 11)
+(substring s 3 3)
+(string-ref s 4)
+(string=? "abc" "abc" "abc")
+(string=? "abc" "abd")
+(string<? "abc" "abd" "b")
+(string<? "abc" "ab")
+(string<? "" "a")
+(string->symbol "sym")
+(symbol->string (quote sym))
+(number->string 255)
+(number->string 255 16)
+(number->string -10 2)
+(number->string 2.5)
+(string->number "ff" 16)
+(string->number "-101" 2)
+(string->number "1e3")
+(string->number "12abc")
+(string->number "99999999999999999999")
+(define port (open-output-string))
+(get-output-string port)
+(write-string "abc" port)
+(write-string "" port)
+(write-string "defghijklmnopqrstuvwxyz0123456789ABCDEFGHIJ" port)
+(get-output-string port)
+(string-length (get-output-string port))
+(define grow (lambda (n) (do ((i 0 (+ i 1))) ((= i n) (string-length (get-output-string port))) (write-string (number->string i) port))))
+(grow 1000)
+(substring (get-output-string port) 40 60)
+(substring s 5 20)
+(substring s 6 5)
+(string-ref s 11)
+(string-length 5)
+(write-string 5 port)
+(write-string "x" 5)
+(number->string 2.5 16)
+(string-append "a" 1)
+(string-length s)
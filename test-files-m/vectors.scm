@@ -0,0 +1,23 @@
+#(1 #(2 3) "x")
+(vector-ref #(10 20 30) 1)
+(define v (make-vector 3 0))
+v
+(vector-set! v 0 (quote a))
+(vector-set! v 2 (+ 1 2))
+v
+(vector-ref v 2)
+(vector-length v)
+(vector 1 2.5 "s")
+(vector-length (vector))
+(vector->list (vector 1 2 3))
+(list->vector (quote (4 5 6)))
+(vector-fill! v 7)
+v
+(vector-ref v 3)
+(vector-ref v -1)
+(vector-set! v 3 0)
+(vector-ref v 1.5)
+(vector-ref 5 0)
+(make-vector -1 0)
+(vector-length (make-vector 0 0))
+(vector-ref v 2)
@@ -0,0 +1,5 @@
+(define f (future (make-vector 100000 (quote x))))
+(touch (future (make-vector 10 0)))
+(touch f)
+(guard (e (#t 99)) (touch (future (make-vector 100000 0))))
+(+ 1 1)
@@ -0,0 +1,8 @@
+(define fib (lambda (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))))
+(define v (parallel-map fib (quote (9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9 9))))
+(car v)
+(touch (future (fib 10)))
+(touch (future (fib 10)))
+(touch (future (fib 25)))
+(guard (e (#t 99)) (touch (future (fib 25))))
+(+ 1 1)
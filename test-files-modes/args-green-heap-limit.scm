@@ -0,0 +1,8 @@
+(define deep (lambda (n) (if (= n 0) 0 (+ 1 (deep (- n 1))))))
+(define c (make-channel 1))
+(define t1 (spawn (lambda () (deep 100000))))
+(yield)
+(define t2 (spawn (lambda () (channel-put! c 42))))
+(yield)
+(channel-get c)
+(+ 1 2)
@@ -0,0 +1,8 @@
+(define fib
+  (lambda (n)
+    (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))))
+(define f (future (fib 22)))
+(define c (make-channel 1))
+(define t (spawn (lambda () (channel-get c))))
+(define g (future (make-vector 3 (fib 18))))
+(fib 10)
@@ -0,0 +1,19 @@
+(define fib
+  (lambda (n)
+    (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))))
+(define counter
+  (let ((n 0))
+    (lambda () (begin (set! n (+ n 1)) n))))
+(define items (cons 1 (cons 2.5 (cons "three" (cons (quote four) (quote ()))))))
+(define v (make-vector 3 (quote x)))
+(vector-set! v 1 items)
+(define empty (make-vector 0 0))
+(define table (make-hash-table))
+(hash-table-set! table "key" 42)
+(hash-table-set! table 7 (quote seven))
+(define big (* 123456789012345678901234567890 98765432109876543210))
+(define negative -98765432109876543210)
+(define p (delay (+ 40 2)))
+(define forced (delay (* 6 7)))
+(force forced)
+(define check car)
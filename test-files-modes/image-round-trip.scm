@@ -0,0 +1,15 @@
+(fib 15)
+(counter)
+(counter)
+items
+v
+(vector-length empty)
+(hash-table-ref table "key")
+(hash-table-ref table 7)
+big
+negative
+(force p)
+(force forced)
+(check (cons 5 6))
+(define local (+ (fib 10) 1))
+local
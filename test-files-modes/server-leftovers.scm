@@ -0,0 +1,16 @@
+(define waiting (spawn (lambda () (fib 10))))
+(define untouched (future (fib 22)))
+(+ 1 2)
+;;; request
+(define c (make-channel 1))
+(define blocked (spawn (lambda () (channel-get c))))
+(define started (future (begin (fib 20) (make-vector 3 (fib 5)))))
+5
+;;; request
+(yield)
+(touch (future (fib 15)))
+;;; request
+(define done (make-channel 1))
+(define t (spawn (lambda () (channel-put! done (fib 12)))))
+(channel-get done)
+(fib 10)
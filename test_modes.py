@@ -0,0 +1,194 @@
+import os
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+import tester
+
+# Tests of the modes that take more than a script on stdin. Each test is a
+# NAME.scm in TEST_DIR plus the files its kind needs, chosen by the prefix of
+# NAME, and its expected output in NAME.output:
+#
+#   server-NAME  NAME.prelude.scm is loaded with --prelude and the server is
+#                started; NAME.scm holds requests separated by lines reading
+#                ";;; request", sent one connection each. The output is the
+#                replies, one after another.
+#   batch-NAME   NAME.scm is run with --batch, next to a script that takes a
+#                while so that the batch outlives it. The output is what
+#                NAME.scm wrote, then its status from the report.
+#   image-NAME   NAME.prelude.scm is saved with --save-image, and NAME.scm is
+#                run on stdin with the image loaded. The output is what it
+#                printed, then what loading a corrupt copy of the image
+#                printed.
+#   args-NAME    NAME.scm is run on stdin with the options in NAME.args. The
+#                output is what it printed, then its exit status.
+
+TEST_DIR = "test-files-modes"
+# Set INTERPRETER to test another build, such as one with sanitizers
+EXECUTABLE = os.environ.get('INTERPRETER', './interpreter')
+REQUEST_SEPARATOR = ";;; request\n"
+
+
+def read_file(path) -> str:
+    with open(path, 'r') as f:
+        return f.read()
+
+
+def send_request(socket_path, source) -> str:
+    '''Sends one request to the server and returns its reply.'''
+    client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    client.settimeout(10)
+    client.connect(socket_path)
+    client.sendall(source.encode('utf-8'))
+    client.shutdown(socket.SHUT_WR)
+    reply = b''
+    while True:
+        data = client.recv(4096)
+        if not data:
+            break
+        reply += data
+    client.close()
+    return reply.decode('utf-8')
+
+
+def run_server_test(name, scratch) -> str:
+    socket_path = os.path.join(scratch, 'server.sock')
+    prelude_path = os.path.join(TEST_DIR, name + '.prelude.scm')
+    server = subprocess.Popen([EXECUTABLE, '--prelude', prelude_path,
+                               '--server', socket_path],
+                              stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    output = ''
+    try:
+        for _ in range(100):
+            if os.path.exists(socket_path) or server.poll() is not None:
+                break
+            time.sleep(0.05)
+        requests = read_file(os.path.join(TEST_DIR, name + '.scm'))
+        for request in requests.split(REQUEST_SEPARATOR):
+            output += send_request(socket_path, request)
+    except (OSError, socket.timeout) as error:
+        output += 'Server failed: %s\n' % error
+    if server.poll() is not None:
+        output += 'Server exited with status %d\n' % server.returncode
+    server.kill()
+    # Anything the server printed itself, such as a sanitizer report
+    output += server.communicate()[0].decode('utf-8')
+    return output
+
+
+def run_batch_test(name, scratch) -> str:
+    # Keeps the process running after the script under test is done
+    slow_path = os.path.join(scratch, 'slow.scm')
+    with open(slow_path, 'w') as slow:
+        slow.write('(do ((i 0 (+ i 1))) ((= i 300000) i))\n')
+    script_path = os.path.join(TEST_DIR, name + '.scm')
+    try:
+        process = subprocess.run([EXECUTABLE, '--batch', '--jobs', '1',
+                                  '--output-dir', scratch, script_path,
+                                  slow_path],
+                                 stdout=subprocess.PIPE,
+                                 stderr=subprocess.STDOUT, timeout=10)
+    except subprocess.TimeoutExpired:
+        return 'Timed out\n'
+    output_path = os.path.join(scratch, name + '.out')
+    output = read_file(output_path) if os.path.exists(output_path) else ''
+    for line in process.stdout.decode('utf-8').splitlines():
+        if line.startswith(script_path + '\t'):
+            output += line.split('\t')[1] + '\n'
+        elif not line.startswith(slow_path) and ' scripts, ' not in line:
+            # Anything else, such as a sanitizer report
+            output += line + '\n'
+    return output
+
+
+def run_args_test(name, scratch) -> str:
+    options = read_file(os.path.join(TEST_DIR, name + '.args')).split()
+    try:
+        with open(os.path.join(TEST_DIR, name + '.scm'), 'r') as input_file:
+            process = subprocess.run([EXECUTABLE] + options, stdin=input_file,
+                                     stdout=subprocess.PIPE,
+                                     stderr=subprocess.STDOUT, timeout=10)
+    except subprocess.TimeoutExpired:
+        return 'Timed out\n'
+    return (process.stdout.decode('utf-8') +
+            'exit status %d\n' % process.returncode)
+
+
+def run_image_test(name, scratch) -> str:
+    image_path = os.path.join(scratch, 'prelude.image')
+    prelude_path = os.path.join(TEST_DIR, name + '.prelude.scm')
+    try:
+        save = subprocess.run([EXECUTABLE, '--prelude', prelude_path,
+                               '--save-image', image_path],
+                              stdout=subprocess.PIPE,
+                              stderr=subprocess.STDOUT, timeout=10)
+        output = save.stdout.decode('utf-8')
+        with open(os.path.join(TEST_DIR, name + '.scm'), 'r') as input_file:
+            load = subprocess.run([EXECUTABLE, '--load-image', image_path],
+                                  stdin=input_file, stdout=subprocess.PIPE,
+                                  stderr=subprocess.STDOUT, timeout=10)
+        output += load.stdout.decode('utf-8')
+
+        # Point the last stored pointer past the end of the objects, which
+        # loading has to refuse rather than follow
+        with open(image_path, 'rb') as image_file:
+            image = bytearray(image_file.read())
+        objects_end, _, relocation_count = struct.unpack_from('<3Q', image, 16)
+        last = objects_end + 8 * (relocation_count - 1)
+        struct.pack_into('<Q', image, last, objects_end + 4096)
+        corrupt_path = os.path.join(scratch, 'corrupt.image')
+        with open(corrupt_path, 'wb') as corrupt_file:
+            corrupt_file.write(image)
+        corrupt = subprocess.run([EXECUTABLE, '--load-image', corrupt_path],
+                                 input=b'(+ 1 2)\n', stdout=subprocess.PIPE,
+                                 stderr=subprocess.STDOUT, timeout=10)
+        output += corrupt.stdout.decode('utf-8').replace(corrupt_path, 'IMAGE')
+        return output
+    except subprocess.TimeoutExpired:
+        return 'Timed out\n'
+
+
+RUNNERS = {
+    'server': run_server_test,
+    'batch': run_batch_test,
+    'args': run_args_test,
+    'image': run_image_test,
+}
+
+
+def run_test(name) -> str:
+    kind = name.split('-')[0]
+    with tempfile.TemporaryDirectory() as scratch:
+        return RUNNERS[kind](name, scratch)
+
+
+def runModes(test_dir=TEST_DIR) -> bool:
+    '''Runs every test in test_dir, returning whether any failed.'''
+    error_encountered = False
+    test_names = [test_name[:-len('.scm')]
+                  for test_name in sorted(os.listdir(test_dir))
+                  if test_name.endswith('.scm')
+                  and test_name.count('.') == 1]
+    for test_name in test_names:
+        print('------Test', test_name, '------')
+        student_output = tester.clean_output(run_test(test_name))
+        correct_output = tester.clean_output(
+            read_file(os.path.join(test_dir, test_name + '.output')))
+        if student_output != correct_output:
+            error_encountered = True
+            print("---OUTPUT INCORRECT---")
+            print('Correct output:')
+            print(correct_output)
+            print('Student output:')
+            print(student_output)
+        else:
+            print("---OUTPUT CORRECT---")
+    return error_encountered
+
+
+if __name__ == '__main__':
+    if tester.buildCode() != 0:
+        sys.exit(1)
+    sys.exit(runModes())
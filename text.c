@@ -0,0 +1,83 @@
+#include <stddef.h>
+#include <string.h>
+#include "value.h"
+#include "talloc.h"
+#include "output.h"
+
+#ifndef _TEXT
+#define _TEXT
+
+// Room a string port starts with
+#define STRING_PORT_CAPACITY 32
+
+// Create a new STR_TYPE Value holding a copy of the length characters at
+// chars, NUL-terminated.
+Value *makeString(const char *chars, size_t length){
+    Value *string = talloc(sizeof(Value));
+    string->type = STR_TYPE;
+    string->s = talloc(length + 1);
+    memcpy(string->s, chars, length);
+    string->s[length] = '\0';
+    string->length = length;
+    return string;
+}
+
+// Return a negative number, zero or a positive number as string a sorts
+// before, the same as or after string b, comparing bytes.
+int compareStrings(Value *a, Value *b){
+    // Equal literals share one Value
+    if(a == b){
+        return 0;
+    }
+    size_t shorter = a->length < b->length ? a->length : b->length;
+    int order = memcmp(a->s, b->s, shorter);
+    if(order != 0){
+        return order;
+    }
+    return (a->length > b->length) - (a->length < b->length);
+}
+
+// Write a string the way the printer shows it, in double quotes.
+void writeQuotedString(Value *string){
+    writeChar('"');
+    writeBytes(string->s, string->length);
+    writeChar('"');
+}
+
+// Create a new, empty output string port.
+Value *makeStringPort(){
+    StringPort *port = talloc(sizeof(StringPort));
+    port->chars = talloc(STRING_PORT_CAPACITY);
+    port->length = 0;
+    port->capacity = STRING_PORT_CAPACITY;
+    Value *portValue = talloc(sizeof(Value));
+    portValue->type = STRINGPORT_TYPE;
+    portValue->sp = port;
+    return portValue;
+}
+
+// Append the length characters at chars to a string port. A full buffer is
+// replaced by one at least twice its size; talloc has no realloc, and the
+// old buffers together are never larger than the new one.
+void stringPortWrite(Value *port, const char *chars, size_t length){
+    StringPort *p = port->sp;
+    if(p->length + length > p->capacity){
+        size_t capacity = p->capacity * 2;
+        while(capacity < p->length + length){
+            capacity *= 2;
+        }
+        char *grown = talloc(capacity);
+        memcpy(grown, p->chars, p->length);
+        p->chars = grown;
+        p->capacity = capacity;
+    }
+    memcpy(p->chars + p->length, chars, length);
+    p->length += length;
+}
+
+// Return a new string holding everything written to a string port so far.
+Value *stringPortContents(Value *port){
+    return makeString(port->sp->chars, port->sp->length);
+}
+
+#endif
@@ -0,0 +1,27 @@
+#include <stddef.h>
+#include "value.h"
+
+#ifndef _TEXT
+#define _TEXT
+
+// Create a new STR_TYPE Value holding a copy of the length characters at
+// chars, NUL-terminated.
+Value *makeString(const char *chars, size_t length);
+
+// Return a negative number, zero or a positive number as string a sorts
+// before, the same as or after string b, comparing bytes.
+int compareStrings(Value *a, Value *b);
+
+// Write a string the way the printer shows it, in double quotes.
+void writeQuotedString(Value *string);
+
+// Create a new, empty output string port.
+Value *makeStringPort();
+
+// Append the length characters at chars to a string port.
+void stringPortWrite(Value *port, const char *chars, size_t length);
+
+// Return a new string holding everything written to a string port so far.
+Value *stringPortContents(Value *port);
+
+#endif
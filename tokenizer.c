@@ -6,11 +6,21 @@
 #include <stdio.h>
 #include "talloc.h"
 #include "linkedlist.h"
+#include "output.h"
+#include "error.h"
+#include "bignum.h"
+#include "text.h"
+#include "constpool.h"
 #include <ctype.h>
+#include <errno.h>
 
 #ifndef _TOKENIZER
 #define _TOKENIZER
 
+// Bytes the text of the token being read starts with; appendTokenChar grows
+// it for longer tokens
+#define TOKEN_CAPACITY 301
+
 
 // Returns whether a char is a digit
 bool isDigit(char token){
@@ -66,9 +76,28 @@ bool isInteger(char *token){
     return true;
 }
 
-// Returns whether a token is an double
+// Returns whether the text after the e of a double is an exponent: an
+// optional sign followed by digits only
+bool isExponent(char *text){
+    if(*text == '-' || *text == '+'){
+        text++;
+    }
+    if(*text == '\0'){
+        return false;
+    }
+    for(; *text != '\0'; text++){
+        if(!isDigit(*text)){
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns whether a token is an double, optionally ending in an exponent as
+// in 6.02e23
 bool isDouble(char *token){
     bool dotFound = false;
+    bool digitFound = isDigit(token[0]);
 
     //Allows for first character to be a sign
     if(!(isDigit(token[0]) || token[0] == '-' || token[0] == '+')){
@@ -82,9 +111,15 @@ bool isDouble(char *token){
 
     int length = strlen(token);
     for(int i = 1; i < length; i++){
+        if((token[i] == 'e' || token[i] == 'E') && digitFound){
+            return isExponent(token + i + 1);
+        }
         if(!(isDigit(token[i]) || token[i] == '.')){
             return false;
         }
+        if(isDigit(token[i])){
+            digitFound = true;
+        }
         if(token[i] == '.'){
             if (dotFound == true){
                 return false;
@@ -184,45 +219,58 @@ void assignTypeAndValue(char *tokenString, Value *valToken){
         valToken->type = BOOL_TYPE;
     }
     else if(isInteger(tokenString)){
-        char *end = talloc(sizeof(char) * 301);
-        valToken->i = strtol(tokenString, &end, 10);
+        errno = 0;
+        valToken->i = strtoll(tokenString, NULL, 10);
         valToken->type = INT_TYPE;
+        // Literals past the fixnum range become bignums
+        if(errno == ERANGE){
+            valToken->type = BIGNUM_TYPE;
+            valToken->b = parseInteger(tokenString)->b;
+        }
     }
     else if(isDouble(tokenString)){
-        char *end = talloc(sizeof(char) * 301);
-        valToken->d = strtod(tokenString, &end);
+        valToken->d = strtod(tokenString, NULL);
         valToken->type = DOUBLE_TYPE;
     }
     else if(isSymbol(tokenString)){
-        valToken->s = talloc(sizeof(char) * 301);
-        strcpy(valToken->s, tokenString);
+        // Points at the token text; the pooled copy gets text of its own
+        valToken->s = tokenString;
         valToken->type = SYMBOL_TYPE;
     }
     else {
-        printf("Syntax error: cannot tokenize\n");
-        texit(0);
+        syntaxError("cannot tokenize");
     }
 }
 
+// Appends c to the token text being built up in *current, which has room for
+// *capacity bytes, moving the text to a buffer twice the size when it is full
+void appendTokenChar(char **current, int *capacity, char c){
+    int length = strlen(*current);
+    if(length + 1 == *capacity){
+        char *bigger = talloc(sizeof(char) * *capacity * 2);
+        memcpy(bigger, *current, length);
+        memset(bigger + length, '\0', *capacity * 2 - length);
+        *current = bigger;
+        *capacity *= 2;
+    }
+    (*current)[length] = c;
+    (*current)[length + 1] = '\0';
+}
 
-// Read source code that is input via stdin, and return a linked list consisting of the
-// tokens in the source code. Each token is represented as a Value struct instance, where
-// the Value's type is set to represent the token type, while the Value's actual value
-// matches the type of value, if applicable. For instance, an integer token should have
-// a Value struct of type INT_TYPE, with an integer value stored in struct variable i.
-// See the assignment instructions for more details. 
-Value *tokenize() {
+// Tokenize the stream, sharing repeated literals and symbols through pool.
+// Kept apart from tokenizeStream so the setjmp there does not slow this loop.
+Value *tokenizePooled(FILE *input, ConstantPool *pool) {
 
     // Prepare list of tokens
     Value *tokensList = makeNull();
 
     // Prepare the character stream
     char nextChar;
-    nextChar = (char)fgetc(stdin);
+    nextChar = (char)fgetc(input);
 
-    char *current = talloc(sizeof(char) * 301); // current string being built up
-    strcpy(current, "");
-    for(int i = 0; i < 301; i++){
+    int currentCapacity = TOKEN_CAPACITY;
+    char *current = talloc(sizeof(char) * currentCapacity); // current string being built up
+    for(int i = 0; i < currentCapacity; i++){
         current[i] = '\0';
     } // initializes string
 
@@ -232,9 +280,9 @@ Value *tokenize() {
         //if character is the newline character
         if(nextChar == '\n'){
             if(current[0] != '\0'){
-                Value *newValCurrent = talloc(sizeof(Value));
-                assignTypeAndValue(current, newValCurrent);
-                tokensList = cons(newValCurrent, tokensList);
+                Value newValCurrent;
+                assignTypeAndValue(current, &newValCurrent);
+                tokensList = cons(internConstant(pool, &newValCurrent), tokensList);
 
                 int length = strlen(current);
                 for(int i = 0; i < length; i++){
@@ -246,9 +294,9 @@ Value *tokenize() {
         else if(nextChar == ';'){
 
             if(current[0] != '\0'){
-                Value *newValCurrent = talloc(sizeof(Value));
-                assignTypeAndValue(current, newValCurrent);
-                tokensList = cons(newValCurrent, tokensList);
+                Value newValCurrent;
+                assignTypeAndValue(current, &newValCurrent);
+                tokensList = cons(internConstant(pool, &newValCurrent), tokensList);
                 int length = strlen(current);
 
                 for(int i = 0; i < length; i++){
@@ -256,32 +304,29 @@ Value *tokenize() {
                 } //reset current
             }
 
-            while(nextChar != '\n'){
-                nextChar = (char)fgetc(stdin);
+            while(nextChar != '\n' && nextChar != EOF){
+                nextChar = (char)fgetc(input);
             }
 
         }
         //if next character is the start of a string
         else if(current[0] == '\0' && nextChar == '\"'){
-            current[strlen(current)] = nextChar;
-            current[strlen(current)] = '\0';
-            nextChar = (char)fgetc(stdin);
+            appendTokenChar(&current, &currentCapacity, nextChar);
+            nextChar = (char)fgetc(input);
             while(nextChar != '\"'){
-                current[strlen(current)] = nextChar;
-                current[strlen(current)] = '\0';
-                nextChar = (char)fgetc(stdin);
-                if(nextChar == '\n'){
-                    printf("Syntax error: string started but not ended\n");
-                    texit(0);
+                appendTokenChar(&current, &currentCapacity, nextChar);
+                nextChar = (char)fgetc(input);
+                if(nextChar == '\n' || nextChar == EOF){
+                    syntaxError("string started but not ended");
                 }
             }
-            current[strlen(current)] = '\"';
-            current[strlen(current)] = '\0';
-            Value *newValString = talloc(sizeof(Value));
-            newValString->type = STR_TYPE;
-            newValString->s = talloc(sizeof(char) * 301);
-            strcpy(newValString->s, current);
-            tokensList = cons(newValString, tokensList);
+            appendTokenChar(&current, &currentCapacity, '\"');
+            // The string keeps its characters, not its quotes
+            Value newValString;
+            newValString.type = STR_TYPE;
+            newValString.s = current + 1;
+            newValString.length = strlen(current) - 2;
+            tokensList = cons(internConstant(pool, &newValString), tokensList);
 
             int length = strlen(current);
             for(int i = 0; i < length; i++){
@@ -294,9 +339,9 @@ Value *tokenize() {
         else if(nextChar == ' '){
             //assign current string to a token if it isn't emtpy
             if(current[0] != '\0'){
-                Value *newValCurrent = talloc(sizeof(Value));
-                assignTypeAndValue(current, newValCurrent);
-                tokensList = cons(newValCurrent, tokensList);
+                Value newValCurrent;
+                assignTypeAndValue(current, &newValCurrent);
+                tokensList = cons(internConstant(pool, &newValCurrent), tokensList);
             }
 
             int length = strlen(current);
@@ -304,13 +349,22 @@ Value *tokenize() {
                 current[i] = '\0';
             } //reset current
         }
+        // if next character opens a vector literal, i.e. #(
+        else if (isOpen(nextChar) && !strcmp(current, "#")){
+            Value *newValOpenVector = talloc(sizeof(Value));
+            newValOpenVector->type = OPENVECTOR_TYPE;
+            newValOpenVector->s = talloc(sizeof(char) * 3);
+            strcpy(newValOpenVector->s, "#(");
+            tokensList = cons(newValOpenVector, tokensList);
+            current[0] = '\0'; //reset current
+        }
         // if next character is a open parentheses
         else if (isOpen(nextChar)){
             //assign current string to a token if it isn't empty
             if(current[0] != '\0'){
-                Value *newValCurrent = talloc(sizeof(Value));
-                assignTypeAndValue(current, newValCurrent);
-                tokensList = cons(newValCurrent, tokensList);
+                Value newValCurrent;
+                assignTypeAndValue(current, &newValCurrent);
+                tokensList = cons(internConstant(pool, &newValCurrent), tokensList);
                 int length = strlen(current);
 
                 for(int i = 0; i < length; i++){
@@ -335,9 +389,9 @@ Value *tokenize() {
         else if (isClose(nextChar)){
             //assign current string to a token if it isn't emtpy
             if(current[0] != '\0'){
-                Value *newValCurrent = talloc(sizeof(Value));
-                assignTypeAndValue(current, newValCurrent);
-                tokensList = cons(newValCurrent, tokensList);
+                Value newValCurrent;
+                assignTypeAndValue(current, &newValCurrent);
+                tokensList = cons(internConstant(pool, &newValCurrent), tokensList);
                 
                 int length = strlen(current);
                 for(int i = 0; i < length; i++){
@@ -358,12 +412,11 @@ Value *tokenize() {
                 current[i] = '\0';
             } //reset current
         } else {
-            current[strlen(current)] = nextChar;
-            current[strlen(current)] = '\0';
+            appendTokenChar(&current, &currentCapacity, nextChar);
         }
 
         // Read next char
-        nextChar = (char)fgetc(stdin);
+        nextChar = (char)fgetc(input);
     }
 
     // Reverse the tokens list, to put it back in order
@@ -371,38 +424,75 @@ Value *tokenize() {
     return reversedList;
 }
 
+// Read source code from the given stream until end of file, and return a linked list
+// of its tokens, the same way tokenize does for stdin.
+Value *tokenizeStream(FILE *input) {
+    // Repeated literals and symbols share one Value. The pool's table is
+    // freed on the way out, including when a syntax error is raised.
+    ConstantPool pool;
+    initConstantPool(&pool);
+    ErrorHandler handler;
+    pushErrorHandler(&handler);
+    if(setjmp(handler.jump) != 0){
+        freeConstantPool(&pool);
+        raiseValue(handler.raised);
+    }
+    Value *tokens = tokenizePooled(input, &pool);
+    popErrorHandler(&handler);
+    freeConstantPool(&pool);
+    return tokens;
+}
+
+// Read source code that is input via stdin, and return a linked list consisting of the
+// tokens in the source code. Each token is represented as a Value struct instance, where
+// the Value's type is set to represent the token type, while the Value's actual value
+// matches the type of value, if applicable. For instance, an integer token should have
+// a Value struct of type INT_TYPE, with an integer value stored in struct variable i.
+// See the assignment instructions for more details. 
+Value *tokenize() {
+    return tokenizeStream(stdin);
+}
+
 // Display the contents of the list of tokens, along with associated type information.
 // The tokens are displayed one on each line, in the format specified in the instructions.
 void displayTokens(Value *list){
     while(list->type != NULL_TYPE){
         switch (list->c.car->type) {
             case INT_TYPE:
-                printf("%i:integer\n", list->c.car->i);
+                writeFormat("%lld:integer\n", (long long)list->c.car->i);
+                break;
+            case BIGNUM_TYPE:
+                writeInteger(list->c.car);
+                writeString(":integer\n");
                 break;
             case DOUBLE_TYPE:
-                printf("%f:double\n", list->c.car->d);
+                writeFormat("%f:double\n", list->c.car->d);
                 break;
             case STR_TYPE:
-                printf("%s:string\n", list->c.car->s);
+                writeQuotedString(list->c.car);
+                writeString(":string\n");
                 break;
             case OPEN_TYPE:
-                printf("(:open\n");
+                writeFormat("(:open\n");
+                break;
+            case OPENVECTOR_TYPE:
+                writeFormat("#(:openvector\n");
                 break;
             case CLOSE_TYPE:
-                printf("):close\n");
+                writeFormat("):close\n");
                 break;
             case BOOL_TYPE:
                 if(list->c.car->i == 1){
-                    printf("#t:boolean\n");
+                    writeFormat("#t:boolean\n");
                 } else {
-                    printf("#f:boolean\n");
+                    writeFormat("#f:boolean\n");
                 }
                 break;
             case SYMBOL_TYPE:
-                printf("%s:symbol\n", list->c.car->s);
+                writeFormat("%s:symbol\n", list->c.car->s);
                 break;
             default:
-                printf("\n");
+                writeFormat("\n");
         }
         list = list->c.cdr;
     }
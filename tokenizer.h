@@ -1,3 +1,5 @@
+#include <stdio.h>
+#include <stdbool.h>
 #include "value.h"
 
 #ifndef _TOKENIZER
@@ -11,6 +13,17 @@
 // See the assignment instructions for more details. 
 Value *tokenize();
 
+// Read source code from the given stream until end of file, and return a linked list
+// of its tokens, the same way tokenize does for stdin.
+Value *tokenizeStream(FILE *input);
+
+// Returns whether a token is an integer, written in decimal
+bool isInteger(char *token);
+
+// Returns whether a token is a double, written in decimal with at most one
+// decimal point
+bool isDouble(char *token);
+
 // Display the contents of the list of tokens, along with associated type information.
 // The tokens are displayed one on each line, in the format specified in the instructions.
 void displayTokens(Value *list);
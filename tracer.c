@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "value.h"
+#include "profiler.h"
+
+#ifndef _TRACER
+#define _TRACER
+
+// Events each thread can buffer before the flusher catches up; a power of two
+#define RING_SIZE 65536
+// How often the flusher drains the rings, in milliseconds
+#define FLUSH_INTERVAL 10
+
+// One complete span. name is NULL for an anonymous procedure, which is shown
+// by the address of its code instead.
+typedef struct TraceEvent {
+    const char *name;
+    const void *code;
+    long long start;
+    long long duration;
+} TraceEvent;
+
+// A single-producer, single-consumer ring of events. Only the owning thread
+// advances head and only the flusher advances tail, so neither ever waits.
+typedef struct TraceRing {
+    TraceEvent events[RING_SIZE];
+    atomic_size_t head;
+    atomic_size_t tail;
+    atomic_long dropped;
+    int tid;
+    struct TraceRing *next;
+} TraceRing;
+
+static atomic_bool tracing = false;
+static long long threshold = 0;
+static long long origin = 0;
+static FILE *traceFile = NULL;
+static bool firstEvent = true;
+
+// Every thread's ring, guarded by ringsLock; rings are never freed, so the
+// flusher can still drain one after its thread has exited
+static pthread_mutex_t ringsLock = PTHREAD_MUTEX_INITIALIZER;
+static TraceRing *rings = NULL;
+static int nextTid = 1;
+
+static pthread_t flusher;
+static atomic_bool stopping = false;
+
+_Thread_local TraceRing *threadRing = NULL;
+
+// Returns the monotonic clock in nanoseconds
+long long traceClock(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Returns this thread's ring, registering a new one the first time
+TraceRing *ringForThread(){
+    if(threadRing == NULL){
+        TraceRing *ring = calloc(1, sizeof(TraceRing));
+        pthread_mutex_lock(&ringsLock);
+        ring->tid = nextTid++;
+        ring->next = rings;
+        rings = ring;
+        pthread_mutex_unlock(&ringsLock);
+        threadRing = ring;
+    }
+    return threadRing;
+}
+
+// Appends an event to this thread's ring, dropping it if the ring is full
+void recordEvent(const char *name, const void *code, long long start, long long end){
+    TraceRing *ring = ringForThread();
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if(head - tail == RING_SIZE){
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    TraceEvent *event = &ring->events[head & (RING_SIZE - 1)];
+    event->name = name;
+    event->code = code;
+    event->start = start;
+    event->duration = end - start;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Writes a string as a JSON string literal
+void writeJsonString(const char *text){
+    fputc('"', traceFile);
+    for(; *text != '\0'; text++){
+        if(*text == '"' || *text == '\\'){
+            fputc('\\', traceFile);
+        }
+        if((unsigned char)*text >= ' '){
+            fputc(*text, traceFile);
+        }
+    }
+    fputc('"', traceFile);
+}
+
+// Writes out every event buffered in every ring. Only the flusher thread, or
+// traceStop once it has finished, calls this.
+void drainRings(){
+    pthread_mutex_lock(&ringsLock);
+    TraceRing *ring = rings;
+    pthread_mutex_unlock(&ringsLock);
+    for(; ring != NULL; ring = ring->next){
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        for(; tail != head; tail++){
+            TraceEvent *event = &ring->events[tail & (RING_SIZE - 1)];
+            fputs(firstEvent ? "\n" : ",\n", traceFile);
+            firstEvent = false;
+            fputs("{\"name\":", traceFile);
+            if(event->name != NULL){
+                writeJsonString(event->name);
+            } else {
+                fprintf(traceFile, "\"lambda@%p\"", event->code);
+            }
+            fprintf(traceFile, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                (event->start - origin) / 1000.0, event->duration / 1000.0,
+                (int)getpid(), ring->tid);
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+}
+
+// Body of the flusher thread: drains the rings every few milliseconds until
+// tracing stops
+void *flushRings(void *unused){
+    (void)unused;
+    struct timespec interval = {0, FLUSH_INTERVAL * 1000000L};
+    while(!atomic_load(&stopping)){
+        nanosleep(&interval, NULL);
+        drainRings();
+    }
+    return NULL;
+}
+
+// Start writing a Chrome trace-event JSON file at path, viewable in
+// chrome://tracing or Perfetto. Closure applications are recorded when they
+// take at least thresholdMicroseconds. Returns nonzero if the file cannot be
+// created.
+int traceStart(char *path, long thresholdMicroseconds){
+    traceFile = fopen(path, "w");
+    if(traceFile == NULL){
+        perror("Trace error: cannot create trace");
+        return 1;
+    }
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", traceFile);
+    threshold = thresholdMicroseconds * 1000LL;
+    origin = traceClock();
+    // Closures are named the way the profiler names them
+    profileTrackProcedures();
+    atomic_store(&stopping, false);
+    pthread_create(&flusher, NULL, flushRings, NULL);
+    atomic_store(&tracing, true);
+    return 0;
+}
+
+// Write out every event still buffered and finish the file.
+void traceStop(){
+    if(!atomic_load(&tracing)){
+        return;
+    }
+    atomic_store(&tracing, false);
+    atomic_store(&stopping, true);
+    pthread_join(flusher, NULL);
+    drainRings();
+
+    long dropped = 0;
+    for(TraceRing *ring = rings; ring != NULL; ring = ring->next){
+        dropped += atomic_load(&ring->dropped);
+    }
+    fputs("\n]}\n", traceFile);
+    fclose(traceFile);
+    traceFile = NULL;
+    if(dropped > 0){
+        fprintf(stderr, "Trace: %ld events dropped because a buffer was full\n", dropped);
+    }
+}
+
+// Return the time a span begins, to pass to traceEnd, or 0 when tracing is
+// off, in which case traceEnd does nothing.
+long long traceBegin(){
+    if(!atomic_load_explicit(&tracing, memory_order_relaxed)){
+        return 0;
+    }
+    return traceClock();
+}
+
+// Record a span called name, a string that outlives the trace, from start
+// until now.
+void traceEnd(const char *name, long long start){
+    if(start == 0 || !atomic_load_explicit(&tracing, memory_order_relaxed)){
+        return;
+    }
+    recordEvent(name, NULL, start, traceClock());
+}
+
+// Record the application of closure that began at start, if it took long
+// enough, named after the procedure it was defined as.
+void traceApplication(Value *closure, long long start){
+    if(start == 0 || !atomic_load_explicit(&tracing, memory_order_relaxed)){
+        return;
+    }
+    long long end = traceClock();
+    if(end - start < threshold){
+        return;
+    }
+    Value *code = closure->cl.functionCode;
+    recordEvent(profileProcedureName(code), code, start, end);
+}
+
+#endif
@@ -0,0 +1,27 @@
+#include "value.h"
+
+#ifndef _TRACER
+#define _TRACER
+
+// Start writing a Chrome trace-event JSON file at path, viewable in
+// chrome://tracing or Perfetto. Closure applications are recorded when they
+// take at least thresholdMicroseconds. Returns nonzero if the file cannot be
+// created.
+int traceStart(char *path, long thresholdMicroseconds);
+
+// Write out every event still buffered and finish the file.
+void traceStop();
+
+// Return the time a span begins, to pass to traceEnd, or 0 when tracing is
+// off, in which case traceEnd does nothing.
+long long traceBegin();
+
+// Record a span called name, a string that outlives the trace, from start
+// until now.
+void traceEnd(const char *name, long long start);
+
+// Record the application of closure that began at start, if it took long
+// enough, named after the procedure it was defined as.
+void traceApplication(Value *closure, long long start);
+
+#endif
@@ -1,21 +1,38 @@
 #ifndef _VALUE
 #define _VALUE
 
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <setjmp.h>
+
 typedef enum {
     INT_TYPE, DOUBLE_TYPE, STR_TYPE, CONS_TYPE, NULL_TYPE, PTR_TYPE,
     OPEN_TYPE, CLOSE_TYPE, BOOL_TYPE, SYMBOL_TYPE, VOID_TYPE, CLOSURE_TYPE, PRIMITIVE_TYPE,
-    UNSPECIFIED_TYPE,
+    UNSPECIFIED_TYPE, VECTOR_TYPE, HASHTABLE_TYPE, FUTURE_TYPE,
+    THREAD_TYPE, CHANNEL_TYPE, ERROR_TYPE, BIGNUM_TYPE,
+    F64VECTOR_TYPE, S64VECTOR_TYPE, STRINGPORT_TYPE, PROMISE_TYPE,
     
     // Types below are only for bonus work (feel free to comment them out)
-    OPENBRACKET_TYPE, CLOSEBRACKET_TYPE, DOT_TYPE, SINGLEQUOTE_TYPE
+    OPENBRACKET_TYPE, CLOSEBRACKET_TYPE, DOT_TYPE, SINGLEQUOTE_TYPE,
+    OPENVECTOR_TYPE
 } valueType;
 
 struct Value {
     valueType type;
     union {
-        int i;
+        // Fixnums; integers outside this range are BIGNUM_TYPE
+        int64_t i;
         double d;
-        char *s;
+
+        // Text of a string or symbol, NUL-terminated. A string holds just
+        // its characters, without the quotes, and also keeps its length so
+        // string primitives never scan for the end. See text.h.
+        struct {
+            char *s;
+            size_t length;
+        };
+
         void *p;
         struct ConsCell {
             struct Value *car;
@@ -30,6 +47,57 @@ struct Value {
             // Active frame when function was defined
             struct Frame *frame;
         } cl;
+
+        struct Vector {
+            // Number of elements
+            int size;
+            // Element pointers, stored in the same block as the vector itself
+            struct Value **items;
+        } v;
+
+        // Unboxed f64vector or s64vector, see numvector.h
+        struct NumericVector {
+            // Number of elements
+            int size;
+            // Elements, stored in the same block as the vector itself
+            union {
+                double *f64;
+                int64_t *s64;
+            };
+        } nv;
+
+        // Open-addressing table, see struct HashTable below
+        struct HashTable *h;
+
+        // Integer too large for a fixnum, see struct Bignum below
+        struct Bignum *b;
+
+        // Output string port, see struct StringPort below
+        struct StringPort *sp;
+
+        // Promise made by delay, delay-force or make-promise, see struct
+        // Promise below
+        struct Promise *pr;
+
+        // Future started by future, see scheduler.h. task is NULL once the
+        // future has been touched, and its outcome is kept here instead
+        struct Future {
+            struct Task *task;
+            struct Value *result;
+            // The value the evaluation raised, or NULL
+            struct Value *error;
+        } fu;
+
+        // A raised error, see error.h
+        struct ErrorObject {
+            char *message;
+            // Whether the error came from the tokenizer or parser
+            bool syntax;
+            // Whether the error is an evaluation limit being exceeded, see
+            // setEvalLimits
+            bool limit;
+        } e;
+
         // The 'pf' variable can hold a pointer to a C function with the 
         // right signature
         struct Value *(*pf)(struct Value *);
@@ -51,5 +119,115 @@ struct Frame {
 
 typedef struct Frame Frame;
 
+// One slot of a hash table. An empty slot has a NULL key; a deleted slot keeps
+// its place in the probe sequence until the table is resized.
+typedef struct HashEntry {
+    struct Value *key;
+    struct Value *value;
+    unsigned int hash;
+    bool deleted;
+} HashEntry;
+
+// An open-addressing hash table keyed by integers, strings and symbols. When
+// the table grows, the old slot array is kept and migrated a few slots at a
+// time on each later operation, so no single insert pays for a full rehash.
+typedef struct HashTable {
+    HashEntry *entries;
+    int capacity;
+    // Slots in entries that are live or deleted
+    int used;
+    // Live keys across both slot arrays
+    int count;
+
+    // Slot array still being migrated into entries, or NULL
+    HashEntry *oldEntries;
+    int oldCapacity;
+    // Index of the next old slot to migrate
+    int migrated;
+} HashTable;
+
+// An integer outside the int64_t range, as a sign and a magnitude. The
+// magnitude is in base 2^32 digits, least significant first, stored in the
+// same block, with no leading zero digits. See bignum.h.
+typedef struct Bignum {
+    bool negative;
+    int size;
+    uint32_t digits[];
+} Bignum;
+
+// The text written so far to an output string port. The buffer doubles when
+// it fills, so a run of writes costs time linear in the text it produces.
+typedef struct StringPort {
+    char *chars;
+    size_t length;
+    size_t capacity;
+} StringPort;
+
+// The state of a promise. delay-force hands the state of the promise its
+// expression returns over to the promise being forced and points both at it,
+// so a chain of promises is forced in a loop rather than by recursion. See
+// promise.h.
+typedef struct Promise {
+    bool forced;
+    // Whether forcing evaluates code to another promise to force in turn, as
+    // for delay-force, rather than to the value itself, as for delay
+    bool chained;
+    // The result, once forced
+    struct Value *value;
+    // The expression and the frame to evaluate it in, until forced
+    struct Value *code;
+    struct Frame *frame;
+} Promise;
+
+// How much of the limits on a top-level form has been used on a thread, see
+// swapEvalBudget
+typedef struct EvalBudget {
+    // Steps taken and the depth evaluation is at
+    long steps;
+    long depth;
+    // Bytes left to allocate, or -1 for no limit
+    long heapBytes;
+} EvalBudget;
+
+// A place that evaluation unwinds to when an error is raised, see
+// pushErrorHandler. Handlers form a stack, innermost first.
+typedef struct ErrorHandler {
+    jmp_buf jump;
+    // The value that was raised, once the handler has been jumped to
+    struct Value *raised;
+    struct ErrorHandler *outer;
+} ErrorHandler;
+
+// An independent interpreter instance. Each one owns its own talloc heap,
+// global frame and input and output streams, so several can run at once on
+// different threads. Only one thread may run a given instance at a time.
+typedef struct Interpreter {
+    // The instance's talloc active list while it is not running
+    void *heap;
+    // Global frame with the built-in bindings, allocated in heap
+    Frame *globalFrame;
+    FILE *input;
+    FILE *output;
+    // Status passed to texit if evaluation ended with an error, otherwise 0
+    int status;
+} Interpreter;
+
+// One constant in a constant pool, with its hash so growing the pool does not
+// recompute it
+typedef struct PoolEntry {
+    struct Value *value;
+    uint64_t hash;
+} PoolEntry;
+
+// The constants the tokenizer or parser has made so far, kept so each
+// distinct one is allocated once and shared. An open-addressing table that
+// only grows; the table itself is malloc'd and freed when the pass ends. See
+// constpool.h.
+typedef struct ConstantPool {
+    PoolEntry *entries;
+    int capacity;
+    int count;
+} ConstantPool;
+
 
 #endif
@@ -0,0 +1,47 @@
+#include "value.h"
+#include <assert.h>
+#include <stdlib.h>
+#include "talloc.h"
+#include "linkedlist.h"
+
+#ifndef _VECTOR
+#define _VECTOR
+
+// Create a pointer to a new VECTOR_TYPE Value with room for size elements,
+// each initialized to fill. The element array lives in the same talloc'd
+// block as the Value, so walking a vector touches contiguous memory.
+Value *makeVector(int size, Value *fill){
+    assert(size >= 0 && "Error (makeVector): negative size");
+    Value *vector = talloc(sizeof(Value) + sizeof(Value *) * size);
+    vector->type = VECTOR_TYPE;
+    vector->v.size = size;
+    vector->v.items = (Value **)(vector + 1);
+    for(int i = 0; i < size; i++){
+        vector->v.items[i] = fill;
+    }
+    return vector;
+}
+
+// Create a new vector holding the car values of the given linked list, in
+// order. The car values themselves are not copied.
+Value *listToVector(Value *list){
+    Value *vector = makeVector(length(list), NULL);
+    int i = 0;
+    while(list->type != NULL_TYPE){
+        vector->v.items[i] = list->c.car;
+        list = list->c.cdr;
+        i++;
+    }
+    return vector;
+}
+
+// Return a new linked list holding the elements of the given vector, in order.
+Value *vectorToList(Value *vector){
+    Value *list = makeNull();
+    for(int i = vector->v.size - 1; i >= 0; i--){
+        list = cons(vector->v.items[i], list);
+    }
+    return list;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#include "value.h"
+
+#ifndef _VECTOR
+#define _VECTOR
+
+// Create a pointer to a new VECTOR_TYPE Value with room for size elements,
+// each initialized to fill. The element array lives in the same talloc'd
+// block as the Value, so walking a vector touches contiguous memory.
+Value *makeVector(int size, Value *fill);
+
+// Create a new vector holding the car values of the given linked list, in
+// order. The car values themselves are not copied.
+Value *listToVector(Value *list);
+
+// Return a new linked list holding the elements of the given vector, in order.
+Value *vectorToList(Value *vector);
+
+#endif